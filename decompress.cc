@@ -0,0 +1,525 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "decompress.h"
+#include "errno_str.h"
+#include "seek_index.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#define fseeko _fseeki64
+#endif
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef USE_LZMA
+#include <lzma.h>
+#endif
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+    /// a compressed input file, which is read in blocks.
+    class compressed_file
+    {
+	FILE* f_;
+    public:
+	unsigned char buf_[65536];
+	/// offset of the end of buf_ in the file.
+	uint64_t offset_;
+
+	explicit compressed_file(const std::string& filename) :
+	    f_(fopen(filename.c_str(), "rb")),
+	    offset_(0)
+	{
+	    if (! f_) {
+		throw std::runtime_error("could not open " + filename + ": " + errno_str());
+	    }
+	}
+
+	~compressed_file() { fclose(f_); }
+
+	/// read the next block into buf_. @return number of bytes read; 0 at the end of the file.
+	size_t fill()
+	{
+	    const size_t r = fread(buf_, 1, sizeof(buf_), f_);
+	    if (r == 0 && ferror(f_)) {
+		throw std::runtime_error(errno_str());
+	    }
+	    offset_ += r;
+	    return r;
+	}
+
+	/// continue reading at offset.
+	void seek(const uint64_t offset)
+	{
+	    if (fseeko(f_, offset, SEEK_SET) != 0) {
+		throw std::runtime_error(errno_str());
+	    }
+	    offset_ = offset;
+	}
+    };
+
+    /// the deflate format refers to at most 32 KiB of previous data.
+    const size_t deflate_window = 32768;
+
+#ifdef USE_ZLIB
+    class gzip_reader
+    {
+	compressed_file in_;
+	z_stream zs_;
+	/// true while a gzip member is decompressed.
+	bool in_member_;
+	/// seek points are added to the index, if it is not null.
+	const std::shared_ptr<seek_index> index_;
+	/// number of decompressed bytes.
+	uint64_t out_;
+	/// the last decompressed bytes, the window of the next seek point.
+	std::string window_;
+
+	/// add the decompressed data [beg, end) to window_ and add a seek point at a deflate block boundary.
+	void index_output(const Bytef* beg, const Bytef* end)
+	{
+	    out_ += end - beg;
+	    window_.append(reinterpret_cast<const char*>(beg), end - beg);
+	    if (window_.size() > 2 * deflate_window) {
+		window_.erase(0, window_.size() - deflate_window);
+	    }
+	    // bit 7 is set at the end of a block or of the gzip header, bit 6 in the last block
+	    if ((zs_.data_type & 128) && !(zs_.data_type & 64) && index_->wants_point(out_)) {
+		seek_point p;
+		p.in_ = in_.offset_ - zs_.avail_in;
+		p.out_ = out_;
+		p.bits_ = zs_.data_type & 7;
+		p.window_ = window_.substr(window_.size() - std::min(window_.size(), deflate_window));
+		index_->add(std::move(p));
+	    }
+	}
+
+    public:
+	gzip_reader(const std::string& filename, std::shared_ptr<seek_index> index) :
+	    in_(filename),
+	    in_member_(false),
+	    index_(index),
+	    out_(0)
+	{
+	    memset(&zs_, 0, sizeof(zs_));
+	    // 15 is the maximum window size, +16 decodes the gzip format
+	    if (inflateInit2(&zs_, 15 + 16) != Z_OK) {
+		throw std::runtime_error("could not initialize zlib");
+	    }
+	}
+
+	~gzip_reader() { inflateEnd(&zs_); }
+
+	size_t read(char* buf, const size_t len)
+	{
+	    zs_.next_out = reinterpret_cast<Bytef*>(buf);
+	    zs_.avail_out = static_cast<uInt>(len);
+	    while(zs_.avail_out == len) {
+		if (zs_.avail_in == 0) {
+		    zs_.avail_in = static_cast<uInt>(in_.fill());
+		    zs_.next_in = in_.buf_;
+		    if (zs_.avail_in == 0) {
+			if (in_member_) {
+			    throw std::runtime_error("unexpected end of file");
+			}
+			break;
+		    }
+		}
+		// a gzip file can consist of several members
+		if (! in_member_) {
+		    inflateReset(&zs_);
+		    in_member_ = true;
+		}
+		const Bytef* const out = zs_.next_out;
+		// Z_BLOCK stops at the deflate block boundaries, where the seek points are
+		const int r = inflate(&zs_, index_ ? Z_BLOCK : Z_NO_FLUSH);
+		if (r == Z_STREAM_END) {
+		    in_member_ = false;
+		} else if (r != Z_OK) {
+		    throw std::runtime_error(zs_.msg ? zs_.msg : "invalid compressed data");
+		}
+		if (index_) {
+		    index_output(out, zs_.next_out);
+		}
+	    }
+	    const size_t n = len - zs_.avail_out;
+	    if (n == 0 && index_ && ! index_->complete()) {
+		index_->finish(out_);
+	    }
+	    return n;
+	}
+    };
+#endif
+
+#ifdef USE_LZMA
+    class xz_reader
+    {
+	compressed_file in_;
+	lzma_stream s_;
+	bool eof_;
+	bool end_;
+    public:
+	explicit xz_reader(const std::string& filename) :
+	    in_(filename),
+	    s_(LZMA_STREAM_INIT),
+	    eof_(false),
+	    end_(false)
+	{
+	    if (lzma_stream_decoder(&s_, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+		throw std::runtime_error("could not initialize liblzma");
+	    }
+	}
+
+	~xz_reader() { lzma_end(&s_); }
+
+	size_t read(char* buf, const size_t len)
+	{
+	    s_.next_out = reinterpret_cast<uint8_t*>(buf);
+	    s_.avail_out = len;
+	    while(s_.avail_out == len && ! end_) {
+		if (s_.avail_in == 0 && ! eof_) {
+		    s_.avail_in = in_.fill();
+		    s_.next_in = in_.buf_;
+		    eof_ = s_.avail_in == 0;
+		}
+		const lzma_ret r = lzma_code(&s_, eof_ ? LZMA_FINISH : LZMA_RUN);
+		if (r == LZMA_STREAM_END) {
+		    end_ = true;
+		} else if (r == LZMA_BUF_ERROR) {
+		    throw std::runtime_error("unexpected end of file");
+		} else if (r == LZMA_FORMAT_ERROR || r == LZMA_DATA_ERROR) {
+		    throw std::runtime_error("invalid compressed data");
+		} else if (r != LZMA_OK) {
+		    throw std::runtime_error("liblzma error " + std::to_string(r));
+		}
+	    }
+	    return len - s_.avail_out;
+	}
+    };
+#endif
+
+#ifdef USE_ZSTD
+    class zstd_reader
+    {
+	compressed_file in_;
+	ZSTD_DStream* ds_;
+	ZSTD_inBuffer in_buf_;
+	/// true while a zstd frame is decompressed.
+	bool in_frame_;
+	/// seek points are added to the index at the start of the frames, if it is not null.
+	const std::shared_ptr<seek_index> index_;
+	/// number of decompressed bytes before the current read().
+	uint64_t out_;
+    public:
+	zstd_reader(const std::string& filename, std::shared_ptr<seek_index> index) :
+	    in_(filename),
+	    ds_(ZSTD_createDStream()),
+	    in_frame_(false),
+	    index_(index),
+	    out_(0)
+	{
+	    if (! ds_ || ZSTD_isError(ZSTD_initDStream(ds_))) {
+		ZSTD_freeDStream(ds_);
+		throw std::runtime_error("could not initialize libzstd");
+	    }
+	    in_buf_.src = in_.buf_;
+	    in_buf_.size = 0;
+	    in_buf_.pos = 0;
+	    if (index_) {
+		index_->add(seek_point());
+	    }
+	}
+
+	~zstd_reader() { ZSTD_freeDStream(ds_); }
+
+	size_t read(char* buf, const size_t len)
+	{
+	    ZSTD_outBuffer out = { buf, len, 0 };
+	    while(out.pos == 0) {
+		bool eof = false;
+		if (in_buf_.pos == in_buf_.size) {
+		    in_buf_.size = in_.fill();
+		    in_buf_.pos = 0;
+		    eof = in_buf_.size == 0;
+		    if (eof && ! in_frame_) {
+			break;
+		    }
+		}
+		// the decompressor may still flush data of the last frame at the end of the file
+		const size_t r = ZSTD_decompressStream(ds_, &out, &in_buf_);
+		if (ZSTD_isError(r)) {
+		    throw std::runtime_error(ZSTD_getErrorName(r));
+		}
+		// a zstd file can consist of several frames, r is 0 at the end of a frame
+		in_frame_ = r != 0;
+		if (eof && in_frame_ && out.pos == 0) {
+		    throw std::runtime_error("unexpected end of file");
+		}
+		if (index_ && ! in_frame_ && index_->wants_point(out_ + out.pos)) {
+		    seek_point p;
+		    p.in_ = in_.offset_ - (in_buf_.size - in_buf_.pos);
+		    p.out_ = out_ + out.pos;
+		    index_->add(std::move(p));
+		}
+	    }
+	    out_ += out.pos;
+	    if (out.pos == 0 && index_ && ! index_->complete()) {
+		index_->finish(out_);
+	    }
+	    return out.pos;
+	}
+    };
+#endif
+
+#ifdef USE_ZLIB
+    std::string inflate_window(const std::string& filename, const seek_point& p, const uint64_t len)
+    {
+	compressed_file in(filename);
+	in.seek(p.in_ - (p.bits_ ? 1 : 0));
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	// the window starts within a deflate stream, without a gzip header
+	if (inflateInit2(&zs, -15) != Z_OK) {
+	    throw std::runtime_error("could not initialize zlib");
+	}
+	std::unique_ptr<z_stream, int(*)(z_streamp)> end(&zs, inflateEnd);
+	auto fill = [&]() {
+	    zs.avail_in = static_cast<uInt>(in.fill());
+	    zs.next_in = in.buf_;
+	    if (zs.avail_in == 0) {
+		throw std::runtime_error("unexpected end of file");
+	    }
+	};
+	if (p.bits_) {
+	    fill();
+	    inflatePrime(&zs, p.bits_, *zs.next_in >> (8 - p.bits_));
+	    ++zs.next_in;
+	    --zs.avail_in;
+	}
+	if (! p.window_.empty()) {
+	    inflateSetDictionary(&zs, reinterpret_cast<const Bytef*>(p.window_.data()), static_cast<uInt>(p.window_.size()));
+	}
+
+	std::string out(len, '\0');
+	zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+	zs.avail_out = static_cast<uInt>(len);
+	bool raw = true;
+	while(zs.avail_out > 0) {
+	    if (zs.avail_in == 0) {
+		fill();
+	    }
+	    const int r = inflate(&zs, Z_NO_FLUSH);
+	    if (r == Z_STREAM_END) {
+		// the window continues in the next gzip member
+		if (raw) {
+		    // skip the trailer of the member, the next member starts with a gzip header
+		    for(unsigned trailer = 8; trailer > 0; ) {
+			if (zs.avail_in == 0) {
+			    fill();
+			}
+			const unsigned n = std::min(trailer, zs.avail_in);
+			zs.next_in += n;
+			zs.avail_in -= n;
+			trailer -= n;
+		    }
+		    inflateReset2(&zs, 15 + 16);
+		    raw = false;
+		} else {
+		    inflateReset(&zs);
+		}
+	    } else if (r != Z_OK) {
+		throw std::runtime_error(zs.msg ? zs.msg : "invalid compressed data");
+	    }
+	}
+	return out;
+    }
+#endif
+
+#ifdef USE_ZSTD
+    std::string zstd_window(const std::string& filename, const seek_point& p, const uint64_t len)
+    {
+	compressed_file in(filename);
+	in.seek(p.in_);
+	std::unique_ptr<ZSTD_DStream, size_t(*)(ZSTD_DStream*)> ds(ZSTD_createDStream(), ZSTD_freeDStream);
+	if (! ds || ZSTD_isError(ZSTD_initDStream(ds.get()))) {
+	    throw std::runtime_error("could not initialize libzstd");
+	}
+	std::string out(len, '\0');
+	ZSTD_outBuffer o = { &out[0], out.size(), 0 };
+	ZSTD_inBuffer i = { in.buf_, 0, 0 };
+	while(o.pos < o.size) {
+	    if (i.pos == i.size) {
+		i.size = in.fill();
+		i.pos = 0;
+		if (i.size == 0) {
+		    throw std::runtime_error("unexpected end of file");
+		}
+	    }
+	    const size_t r = ZSTD_decompressStream(ds.get(), &o, &i);
+	    if (ZSTD_isError(r)) {
+		throw std::runtime_error(ZSTD_getErrorName(r));
+	    }
+	}
+	return out;
+    }
+#endif
+
+    /**
+     * decompress the windows of an indexed file in parallel threads.
+     * The windows are returned in order, only a window per thread is decompressed ahead.
+     */
+    class window_reader
+    {
+	const std::string filename_;
+	const std::shared_ptr<const seek_index> index_;
+	const size_t num_threads_;
+	/// the next window to decompress.
+	size_t next_;
+	/// the windows which are decompressed in the background, in order.
+	std::deque<std::future<std::string>> ahead_;
+	/// the current window.
+	std::string window_;
+	/// read position in window_.
+	size_t pos_;
+    public:
+	window_reader(const std::string& filename, std::shared_ptr<const seek_index> index) :
+	    filename_(filename),
+	    index_(index),
+	    num_threads_(std::max(1u, std::thread::hardware_concurrency())),
+	    next_(0),
+	    pos_(0)
+	{
+	}
+
+	size_t read(char* buf, const size_t len)
+	{
+	    while(pos_ == window_.size()) {
+		while(next_ < index_->windows() && ahead_.size() < num_threads_) {
+		    // the index is kept alive by this object, which waits for the futures in its destructor
+		    ahead_.push_back(std::async(std::launch::async, decompress_window, filename_, std::cref(*index_), next_++));
+		}
+		if (ahead_.empty()) {
+		    return 0;
+		}
+		window_ = ahead_.front().get();
+		ahead_.pop_front();
+		pos_ = 0;
+	    }
+	    const size_t n = std::min(len, window_.size() - pos_);
+	    memcpy(buf, window_.data() + pos_, n);
+	    pos_ += n;
+	    return n;
+	}
+    };
+
+    template <typename R, typename... A>
+    stream_read_t make_reader(A&&... args)
+    {
+	// the reader is destroyed with the last copy of the function
+	auto r = std::make_shared<R>(std::forward<A>(args)...);
+	return [r](char* buf, const size_t len) { return r->read(buf, len); };
+    }
+}
+
+compression_t detect_compression(const std::string& filename)
+{
+    unsigned char m[6];
+    size_t len = 0;
+    if (FILE* f = fopen(filename.c_str(), "rb")) {
+	len = fread(m, 1, sizeof(m), f);
+	fclose(f);
+    }
+    if (len >= 2 && m[0] == 0x1f && m[1] == 0x8b) {
+	return compression_gzip;
+    }
+    if (len >= 6 && memcmp(m, "\xfd" "7zXZ\0", 6) == 0) {
+	return compression_xz;
+    }
+    // a zstd file can start with a skippable frame, its magic numbers are 0x184D2A50 to 0x184D2A5F
+    if (len >= 4 && (memcmp(m, "\x28\xb5\x2f\xfd", 4) == 0 || ((m[0] & 0xf0) == 0x50 && memcmp(m + 1, "\x2a\x4d\x18", 3) == 0))) {
+	return compression_zstd;
+    }
+    return compression_none;
+}
+
+const char* compression_name(const compression_t c)
+{
+    switch(c) {
+    case compression_none: return "uncompressed";
+    case compression_gzip: return "gzip";
+    case compression_xz: return "xz";
+    case compression_zstd: return "zstd";
+    }
+    return "unknown";
+}
+
+bool decompression_supported(const compression_t c)
+{
+    switch(c) {
+#ifdef USE_ZLIB
+    case compression_gzip: return true;
+#endif
+#ifdef USE_LZMA
+    case compression_xz: return true;
+#endif
+#ifdef USE_ZSTD
+    case compression_zstd: return true;
+#endif
+    default: return false;
+    }
+}
+
+stream_read_t open_decompressor(const std::string& filename, const compression_t c, std::shared_ptr<seek_index> index)
+{
+    if (index && index->compression() != c) {
+	index = nullptr;
+    }
+    if (index && index->complete() && seek_index::supported(c) && decompression_supported(c)) {
+	return make_reader<window_reader>(filename, index);
+    }
+    switch(c) {
+#ifdef USE_ZLIB
+    case compression_gzip: return make_reader<gzip_reader>(filename, index);
+#endif
+#ifdef USE_LZMA
+    case compression_xz: return make_reader<xz_reader>(filename);
+#endif
+#ifdef USE_ZSTD
+    case compression_zstd: return make_reader<zstd_reader>(filename, index);
+#endif
+    default: break;
+    }
+    throw std::runtime_error(std::string(compression_name(c)) + " compressed files are not supported");
+}
+
+std::string decompress_window(const std::string& filename, const seek_index& index, const size_t i)
+{
+    if (i >= index.windows() || ! index.complete()) {
+	throw std::runtime_error("no window " + std::to_string(i) + " in the seek index of " + filename);
+    }
+    const seek_point& p = index.point(i);
+    const uint64_t len = index.window_end(i) - p.out_;
+    switch(index.compression()) {
+#ifdef USE_ZLIB
+    case compression_gzip: return inflate_window(filename, p, len);
+#endif
+#ifdef USE_ZSTD
+    case compression_zstd: return zstd_window(filename, p, len);
+#endif
+    default: break;
+    }
+    throw std::runtime_error(std::string(compression_name(index.compression())) + " compressed files can not be indexed");
+}
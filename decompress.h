@@ -0,0 +1,53 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "stream_reader.h"
+#include <memory>
+#include <string>
+
+class seek_index;
+
+/// compression formats of files.
+enum compression_t {
+    compression_none,
+    compression_gzip,
+    compression_xz,
+    compression_zstd,
+};
+
+/**
+ * detect the compression format of a file by its magic number.
+ * @return compression_none if the file is not compressed or can not be read.
+ */
+compression_t detect_compression(const std::string& filename);
+
+/// @return name of the compression format.
+const char* compression_name(const compression_t c);
+
+/// @return true if files with compression format c can be decompressed by this build of the program.
+bool decompression_supported(const compression_t c);
+
+/**
+ * open a compressed file.
+ * Concatenated compressed streams are decompressed as one stream, like the gzip and xz programs do.
+ * @param filename name of the compressed file.
+ * @param c compression format of the file, see detect_compression().
+ * @param index if the index is complete, the windows of the file are decompressed in parallel threads.
+ * Otherwise the seek points of a gzip or zstd file are added to the index while the file is read,
+ * and the index is complete once the function returned 0. See seek_index.
+ * @return function which reads the decompressed data, see read_in_background().
+ * @throws std::runtime_error if the file could not be opened or the format is not supported.
+ */
+stream_read_t open_decompressor(const std::string& filename, const compression_t c, std::shared_ptr<seek_index> index = nullptr);
+
+/**
+ * decompress a window of a compressed file without the data before it.
+ * @param filename name of the compressed file.
+ * @param index complete seek index of the file.
+ * @param i number of the window, see seek_index::find().
+ * @return the decompressed data of window i.
+ * @throws std::runtime_error if the file could not be read or does not match the index.
+ */
+std::string decompress_window(const std::string& filename, const seek_index& index, const size_t i);
@@ -0,0 +1,305 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "decompress.h"
+#include "seek_index.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <fstream>
+#include <stdexcept>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef USE_LZMA
+#include <lzma.h>
+#endif
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+    void write_file(const std::string& filename, const std::string& s)
+    {
+	std::ofstream os(filename, std::ios::binary);
+	os << s;
+    }
+
+    /// @return all data of the decompressor.
+    std::string read_all(stream_read_t read)
+    {
+	std::string s;
+	char buf[1000];
+	while(size_t r = read(buf, sizeof(buf))) {
+	    s.append(buf, r);
+	}
+	return s;
+    }
+
+    /// @return some lines of text, which are larger than the buffers of the decompressor.
+    std::string make_text()
+    {
+	std::string s;
+	for(unsigned u = 0; u < 20000; ++u) {
+	    s += "line " + std::to_string(u) + "\n";
+	}
+	return s;
+    }
+
+#ifdef USE_ZLIB
+    std::string gzip(const std::string& s)
+    {
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+	    throw std::runtime_error("deflateInit2");
+	}
+	std::string out(deflateBound(&zs, s.size()), '\0');
+	zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(s.data()));
+	zs.avail_in = s.size();
+	zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+	zs.avail_out = out.size();
+	if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+	    throw std::runtime_error("deflate");
+	}
+	out.resize(zs.total_out);
+	deflateEnd(&zs);
+	return out;
+    }
+#endif
+
+#ifdef USE_LZMA
+    std::string xz(const std::string& s)
+    {
+	std::string out(lzma_stream_buffer_bound(s.size()), '\0');
+	size_t pos = 0;
+	if (lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, nullptr, reinterpret_cast<const uint8_t*>(s.data()), s.size(),
+				    reinterpret_cast<uint8_t*>(&out[0]), &pos, out.size()) != LZMA_OK) {
+	    throw std::runtime_error("lzma_easy_buffer_encode");
+	}
+	out.resize(pos);
+	return out;
+    }
+#endif
+
+#ifdef USE_ZSTD
+    std::string zstd(const std::string& s)
+    {
+	std::string out(ZSTD_compressBound(s.size()), '\0');
+	const size_t r = ZSTD_compress(&out[0], out.size(), s.data(), s.size(), 3);
+	if (ZSTD_isError(r)) {
+	    throw std::runtime_error("ZSTD_compress");
+	}
+	out.resize(r);
+	return out;
+    }
+#endif
+}
+
+TEST(decompress, detects_the_compression_by_the_magic_number)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    write_file(fn, "\x1f\x8b\x08");
+    ASSERT_EQ(compression_gzip, detect_compression(fn));
+    write_file(fn, std::string("\xfd" "7zXZ\0\0", 7));
+    ASSERT_EQ(compression_xz, detect_compression(fn));
+    write_file(fn, "\x28\xb5\x2f\xfd\x00");
+    ASSERT_EQ(compression_zstd, detect_compression(fn));
+    write_file(fn, "plain text\n");
+    ASSERT_EQ(compression_none, detect_compression(fn));
+    write_file(fn, "");
+    ASSERT_EQ(compression_none, detect_compression(fn));
+    ASSERT_EQ(compression_none, detect_compression(fn + ".does_not_exist"));
+}
+
+TEST(decompress, reports_unsupported_formats)
+{
+    ASSERT_FALSE(decompression_supported(compression_none));
+    ASSERT_THROW(open_decompressor("file", compression_none), std::runtime_error);
+#ifndef USE_ZSTD
+    ASSERT_FALSE(decompression_supported(compression_zstd));
+    ASSERT_THROW(open_decompressor("file.zst", compression_zstd), std::runtime_error);
+#endif
+}
+
+#ifdef USE_ZLIB
+TEST(decompress, decompresses_gzip_files)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string s = make_text();
+    // a gzip file can consist of several members, e.g. if files were concatenated
+    write_file(fn, gzip(s) + gzip("last line\n"));
+    ASSERT_TRUE(decompression_supported(compression_gzip));
+    ASSERT_EQ(s + "last line\n", read_all(open_decompressor(fn, compression_gzip)));
+}
+
+TEST(decompress, reports_truncated_gzip_files)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string z = gzip(make_text());
+    write_file(fn, z.substr(0, z.size() / 2));
+    ASSERT_THROW(read_all(open_decompressor(fn, compression_gzip)), std::runtime_error);
+}
+#endif
+
+#ifdef USE_LZMA
+TEST(decompress, decompresses_xz_files)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string s = make_text();
+    write_file(fn, xz(s) + xz("last line\n"));
+    ASSERT_TRUE(decompression_supported(compression_xz));
+    ASSERT_EQ(s + "last line\n", read_all(open_decompressor(fn, compression_xz)));
+}
+
+TEST(decompress, reports_truncated_xz_files)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string z = xz(make_text());
+    write_file(fn, z.substr(0, z.size() / 2));
+    ASSERT_THROW(read_all(open_decompressor(fn, compression_xz)), std::runtime_error);
+}
+#endif
+
+#ifdef USE_ZSTD
+TEST(decompress, decompresses_zstd_files)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string s = make_text();
+    // the decompressed data of a frame is larger than the buffer of the reader
+    write_file(fn, zstd(s) + zstd("last line\n"));
+    ASSERT_TRUE(decompression_supported(compression_zstd));
+    ASSERT_EQ(s + "last line\n", read_all(open_decompressor(fn, compression_zstd)));
+}
+
+TEST(decompress, reports_truncated_zstd_files)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string z = zstd(make_text());
+    write_file(fn, z.substr(0, z.size() / 2));
+    ASSERT_THROW(read_all(open_decompressor(fn, compression_zstd)), std::runtime_error);
+}
+#endif
+
+#ifdef USE_ZSTD
+TEST(decompress, skips_skippable_zstd_frames)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string s = make_text();
+    // a skippable frame has a magic number 0x184D2A5?, a 32 bit length and the skipped data, e.g. of pzstd
+    const std::string skippable = std::string("\x50\x2a\x4d\x18\x05\x00\x00\x00" "skip!", 13);
+    write_file(fn, skippable + zstd(s) + skippable + zstd("last line\n"));
+    ASSERT_EQ(compression_zstd, detect_compression(fn));
+    ASSERT_EQ(s + "last line\n", read_all(open_decompressor(fn, compression_zstd)));
+}
+
+TEST(decompress, reports_corrupted_zstd_frames)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string s = make_text();
+    std::string z = zstd(s);
+    const std::string first = zstd("first line\n");
+    // overwrite data in the middle of the second frame
+    for(size_t i = z.size() / 2; i < z.size() / 2 + 16; ++i) {
+	z[i] = '\xff';
+    }
+    write_file(fn, first + z);
+    stream_read_t read = open_decompressor(fn, compression_zstd);
+    std::string out;
+    char buf[1000];
+    try {
+	while(size_t r = read(buf, sizeof(buf))) {
+	    out.append(buf, r);
+	}
+	FAIL() << "the corrupted frame was decompressed";
+    } catch (const std::runtime_error&) {
+    }
+    // the data before the error was read
+    ASSERT_EQ("first line\n", out.substr(0, 11));
+    ASSERT_EQ(0, (std::string("first line\n") + s).compare(0, out.size(), out));
+}
+#endif
+
+namespace {
+    /**
+     * decompress a file and build its seek index, then decompress the windows one by one and in parallel.
+     * @param data the decompressed data of the file.
+     * @return the seek index.
+     */
+    std::shared_ptr<seek_index> check_seek_index(const std::string& fn, const compression_t c, const std::string& data, const uint64_t span)
+    {
+	auto index = std::make_shared<seek_index>(c, span);
+	EXPECT_EQ(data, read_all(open_decompressor(fn, c, index)));
+	EXPECT_TRUE(index->complete());
+	EXPECT_EQ(data.size(), index->size());
+	for(size_t i = 0; i < index->windows(); ++i) {
+	    const uint64_t beg = index->point(i).out_;
+	    EXPECT_EQ(data.substr(beg, index->window_end(i) - beg), decompress_window(fn, *index, i)) << "window " << i;
+	    EXPECT_EQ(i, index->find(beg));
+	}
+	// the windows of a complete index are decompressed in parallel
+	EXPECT_EQ(data, read_all(open_decompressor(fn, c, index)));
+	return index;
+    }
+}
+
+#ifdef USE_ZLIB
+TEST(decompress, indexes_gzip_files)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string s = make_text();
+    std::string r;
+    for(unsigned u = 0; u < 20000; ++u) {
+	r += std::to_string(u * 7919 % 10007) + " random line\n";
+    }
+    // a window can continue in the next gzip member
+    write_file(fn, gzip(s) + gzip(r) + gzip("last line\n"));
+    auto index = check_seek_index(fn, compression_gzip, s + r + "last line\n", 16*1024);
+    ASSERT_LT(4u, index->windows());
+    // some seek points are not at a byte boundary and have a dictionary
+    bool bits = false;
+    for(size_t i = 1; i < index->windows(); ++i) {
+	bits |= index->point(i).bits_ != 0;
+	ASSERT_EQ(32768u, index->point(i).window_.size());
+    }
+    ASSERT_TRUE(bits);
+
+    // a seek point of a file that changed meanwhile
+    write_file(fn, gzip(s).substr(0, 1000));
+    ASSERT_THROW(decompress_window(fn, *index, index->windows() - 1), std::runtime_error);
+}
+#endif
+
+#ifdef USE_ZSTD
+TEST(decompress, indexes_zstd_frames)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string s = make_text();
+    const std::string skippable = std::string("\x50\x2a\x4d\x18\x00\x00\x00\x00", 8);
+    write_file(fn, zstd(s) + skippable + zstd("middle line\n") + zstd(s) + zstd("last line\n"));
+    // a frame is a window if it is larger than the span
+    auto index = check_seek_index(fn, compression_zstd, s + "middle line\n" + s + "last line\n", 1000);
+    ASSERT_EQ(3u, index->windows());
+    ASSERT_EQ(s.size(), index->point(1).out_);
+    ASSERT_EQ(2 * s.size() + 12, index->point(2).out_);
+
+    // a file of a single frame has a single window
+    write_file(fn, zstd(s));
+    ASSERT_EQ(1u, check_seek_index(fn, compression_zstd, s, 1000)->windows());
+}
+#endif
@@ -10,56 +10,103 @@
 #include <fstream>
 
 DisplayInfo::DisplayInfo() :
-    topLineIt(displayedLineNum.end()),
-    bottomLineIt(displayedLineNum.end())
+    lines_(std::make_shared<line_bitmap>()),
+    size_(0),
+    top_(0),
+    bottom_(0)
 { }
 
 void
 DisplayInfo::go_to_approx(const line_number_t line_num)
 {
-    if (line_num == 0 || displayedLineNum.empty()) {
+    if (line_num == 0 || size_ == 0) {
 	top();
+    } else if (lines_->contains(line_num)) {
+	top_ = line_num;
     } else {
-	topLineIt = std::lower_bound(displayedLineNum.begin(), displayedLineNum.end(), line_num);
-	if (topLineIt == displayedLineNum.begin()) {
-	    // do nothing
-	} else if (topLineIt == displayedLineNum.end()) {
-	    --topLineIt;
-	} else if (*topLineIt == line_num) {
-	    // do nothing
-	} else {
-	    --topLineIt;
+	// the previous line; the first line if line_num is before it
+	top_ = lines_->prev(line_num);
+	if (top_ == 0) {
+	    top();
 	}
     }
 }
 
 void
-DisplayInfo::assign(lineNum_vector_t&& v)
+DisplayInfo::assign(line_bitmap&& b)
 {
-    unsigned old_line_num = 0;
-    if (topLineIt != displayedLineNum.end()) {
-	old_line_num = *topLineIt;
-    }
+    const line_number_t old_line_num = top_;
 
-    displayedLineNum = std::move(v);
-    topLineIt = bottomLineIt = displayedLineNum.begin();
+    // a snapshot keeps the old lines
+    lines_ = std::make_shared<line_bitmap>(std::move(b));
+    size_ = lines_->cardinality();
+    top_ = bottom_ = lines_->min();
     go_to_approx(old_line_num);
 }
 
+void
+DisplayInfo::assign(const lineNum_vector_t& v)
+{
+    line_bitmap b;
+    for(auto n : v) {
+	b.add(n);
+    }
+    b.optimize();
+    assign(std::move(b));
+}
+
+template <typename F>
+void
+DisplayInfo::append_lines(F add)
+{
+    if (lines_.use_count() > 1) {
+	// a snapshot uses the lines, they are copied before they are modified
+	lines_ = std::make_shared<line_bitmap>(*lines_);
+    }
+    const bool was_empty = size_ == 0;
+    add();
+    if (was_empty) {
+	top_ = bottom_ = lines_->min();
+    }
+}
+
+void
+DisplayInfo::append_range(const line_number_t first, const line_number_t last)
+{
+    assert(first > lastLineNum());
+    if (first > last) {
+	return;
+    }
+    append_lines([&]() {
+	    lines_->add_range(first, last);
+	    size_ += last - first + 1;
+	});
+}
+
+void
+DisplayInfo::append(const line_bitmap& b)
+{
+    if (b.empty()) {
+	return;
+    }
+    assert(b.min() > lastLineNum());
+    append_lines([&]() {
+	    lines_->append(line_bitmap(b));
+	    size_ += b.cardinality();
+	});
+}
+
 bool
 DisplayInfo::start()
 {
-    bottomLineIt = topLineIt;
-    return bottomLineIt != displayedLineNum.end();
+    bottom_ = top_;
+    return bottom_ != 0;
 }
 
 line_number_t
 DisplayInfo::current() const
 {
-    if (bottomLineIt == displayedLineNum.end()) {
-	return 0;
-    }
-    return *bottomLineIt;
+    return bottom_;
 }
 
 bool
@@ -68,97 +115,88 @@ DisplayInfo::next()
     if (isLastLineDisplayed()) {
 	return false;
     }
-    ++bottomLineIt;
+    bottom_ = lines_->next(bottom_);
     return true;
 }
 
 bool
 DisplayInfo::prev()
 {
-    if (bottomLineIt == displayedLineNum.begin()) {
+    const line_number_t p = lines_->prev(bottom_);
+    if (p == 0) {
 	return false;
     }
-    --bottomLineIt;
+    bottom_ = p;
     return true;
 }
 
 bool
 DisplayInfo::isFirstLineDisplayed() const
 {
-    return topLineIt == displayedLineNum.begin();
+    return top_ == lines_->min();
 }
 
 bool
 DisplayInfo::isLastLineDisplayed() const
 {
-    displayedLineNum_t::iterator i = bottomLineIt;
-    return ++i == displayedLineNum.end();
+    return bottom_ == lastLineNum();
 }
 
 void
 DisplayInfo::down()
 {
-    auto it = topLineIt;
-    if (it == displayedLineNum.end()) {
-	return;
-    }
-    if (++it != displayedLineNum.end()) {
-	topLineIt = it;
+    const line_number_t n = lines_->next(top_);
+    if (top_ != 0 && n != 0) {
+	top_ = n;
     }
 }
 
 void
 DisplayInfo::up()
 {
-    if (topLineIt != displayedLineNum.begin()) {
-	--topLineIt;
+    const line_number_t p = lines_->prev(top_);
+    if (p != 0) {
+	top_ = p;
     }
 }
 
 void
 DisplayInfo::top()
 {
-    topLineIt = displayedLineNum.begin();
+    top_ = lines_->min();
 }
 
 void
 DisplayInfo::page_down()
 {
-    topLineIt = bottomLineIt;
+    top_ = bottom_;
 }
 
 line_number_t
 DisplayInfo::bottomLineNum() const
 {
-    if (bottomLineIt == displayedLineNum.end()) {
-	return 0;
-    }
-    return *bottomLineIt;
+    return bottom_;
 }
 
 std::string
 DisplayInfo::info() const
 {
-    return "top #" + std::to_string(*topLineIt) + " bottom #" + std::to_string(*bottomLineIt);
+    return "top #" + std::to_string(top_) + " bottom #" + std::to_string(bottom_);
 }
 
 line_number_t
 DisplayInfo::lastLineNum() const
 {
-    if (displayedLineNum.size() == 0) {
-	return 0;
-    }
-    return displayedLineNum[displayedLineNum.size() - 1];
+    return lines_->max();
 }
 
 bool
 DisplayInfo::go_to(const line_number_t lineNum)
 {
-    displayedLineNum_t::iterator i = std::find(displayedLineNum.begin(), displayedLineNum.end(), lineNum);
-    if (i == displayedLineNum.end()) {
+    if (lineNum == 0 || ! lines_->contains(lineNum)) {
 	return false;
     }
-    bottomLineIt = topLineIt = i;
+    bottom_ = top_ = lineNum;
     return true;
 }
 
@@ -172,16 +210,14 @@ DisplayInfo::go_to_perc(unsigned p)
     if (p > 100) {
 	p = 100;
     }
-    go_to_approx(static_cast<uint64_t>(lastLineNum()) * static_cast<uint64_t>(p) / static_cast<uint64_t>(100u) + 1u);
+    const uint64_t l = static_cast<uint64_t>(lastLineNum()) * static_cast<uint64_t>(p) / static_cast<uint64_t>(100u) + 1u;
+    go_to_approx(static_cast<line_number_t>(std::min<uint64_t>(l, max_line_number)));
 }
 
 line_number_t
 DisplayInfo::topLineNum() const
 {
-    if (topLineIt == displayedLineNum.end()) {
-	return 0;
-    }
-    return *topLineIt;
+    return top_;
 }
 
 bool
@@ -192,7 +228,7 @@ DisplayInfo::save(const std::string& filename, file_index& fi)
     }
 
     // if this object does not manage lines, create an empty file
-    if (displayedLineNum.empty()) {
+    if (size_ == 0) {
 	std::ofstream os(filename);
 	if (! os) {
 	    return false;
@@ -200,11 +236,9 @@ DisplayInfo::save(const std::string& filename, file_index& fi)
 	return true;
     }
 
-    assert(displayedLineNum.size() > 0);
-
     // check that the last (highest) line number managed by this
     // object is included in fi.
-    if (displayedLineNum[displayedLineNum.size()-1] >= fi.size()) {
+    if (lastLineNum() >= fi.size()) {
 	return false;
     }
 
@@ -212,7 +246,7 @@ DisplayInfo::save(const std::string& filename, file_index& fi)
     if (! os) {
 	return false;
     }
-    for(auto n : displayedLineNum) {
+    for(auto n : *lines_) {
 	os << fi.line(n) << std::endl;
     }
 
@@ -5,6 +5,7 @@
 
 #pragma once
 #include "types.h"
+#include "line_bitmap.h"
 #include <vector>
 #include <string>
 #include <memory>
@@ -13,11 +14,18 @@ class file_index;
 
 class DisplayInfo
 {
-    typedef lineNum_vector_t displayedLineNum_t;
-
-    displayedLineNum_t displayedLineNum;
-    displayedLineNum_t::iterator topLineIt;
-    displayedLineNum_t::iterator bottomLineIt;
+    /// the lines, they are shared with snapshots, see snapshot().
+    std::shared_ptr<line_bitmap> lines_;
+    /// number of lines, cached because line_bitmap::cardinality() visits every container.
+    line_number_t size_;
+    /// the top line on the display; 0 if there are no lines.
+    line_number_t top_;
+    /// the bottom line on the display, see start().
+    line_number_t bottom_;
+
+    /// call add, which appends lines to lines_, and keep the displayed lines.
+    template <typename F>
+    void append_lines(F add);
 
 public:
 
@@ -25,10 +33,36 @@ public:
 
     DisplayInfo();
 
-    void assign(lineNum_vector_t&& v);
+    /// replace the lines managed by this object, the top line stays if it is in b.
+    void assign(line_bitmap&& b);
+
+    /// replace the lines managed by this object with the sorted line numbers v.
+    void assign(const lineNum_vector_t& v);
+
+    /**
+     * add the lines [first, last] to the lines managed by this object.
+     * The displayed lines do not change.
+     * @param first line number, has to be larger than lastLineNum().
+     * @param last line number.
+     */
+    void append_range(const line_number_t first, const line_number_t last);
+
+    /**
+     * add the lines b to the lines managed by this object.
+     * The displayed lines do not change.
+     * @param b line numbers, which have to be larger than lastLineNum().
+     */
+    void append(const line_bitmap& b);
 
     /// @return the number of lines managed by this object.
-    unsigned size() const { return displayedLineNum.size(); }
+    line_number_t size() const { return size_; }
+
+    /**
+     * @return the lines managed by this object. The returned lines do not change when this object changes,
+     * so a background job can use them while the user browses and filters.
+     * The lines are only copied if they are changed while a snapshot exists.
+     */
+    std::shared_ptr<const line_bitmap> snapshot() const { return lines_; }
 
     /**
      * start an iteration over the lines.
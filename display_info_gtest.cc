@@ -209,3 +209,82 @@ TEST(DisplayInfo, save_with_2_lines)
     fi2.parse_all();
     ASSERT_EQ(2u, fi2.size());
 }
+
+TEST(DisplayInfo, append_range_keeps_the_displayed_lines)
+{
+    DisplayInfo i; i.assign(s());
+    i.go_to(50);
+    i.start();
+    i.next();
+    i.append_range(101, 100000);
+    ASSERT_EQ(100000u, i.size());
+    ASSERT_EQ(100000u, i.lastLineNum());
+    ASSERT_EQ(50u, i.topLineNum());
+    ASSERT_EQ(51u, i.bottomLineNum());
+
+    DisplayInfo e; e.assign(lineNum_vector_t());
+    e.append_range(1, 10);
+    ASSERT_TRUE(e.start());
+    ASSERT_EQ(1u, e.current());
+}
+
+TEST(DisplayInfo, append_keeps_the_displayed_lines)
+{
+    DisplayInfo i; i.assign(s());
+    i.go_to(50);
+    i.start();
+    i.next();
+    line_bitmap b;
+    b.add(200);
+    b.add_range(300, 301);
+    i.append(b);
+    i.append(line_bitmap());
+    ASSERT_EQ(103u, i.size());
+    ASSERT_EQ(301u, i.lastLineNum());
+    ASSERT_EQ(50u, i.topLineNum());
+    ASSERT_EQ(51u, i.bottomLineNum());
+    ASSERT_TRUE(i.go_to(300));
+}
+
+TEST(DisplayInfo, append_range_up_to_the_largest_line_number)
+{
+    DisplayInfo i; i.assign(lineNum_vector_t());
+    i.append_range(max_line_number - 2, max_line_number);
+    ASSERT_EQ(3u, i.size());
+    ASSERT_EQ(max_line_number, i.lastLineNum());
+    ASSERT_TRUE(i.go_to(max_line_number - 1));
+    i.go_to_perc(100);
+    ASSERT_EQ(max_line_number, i.topLineNum());
+}
+
+#ifdef LINE_NUMBER_64
+TEST(DisplayInfo, manages_line_numbers_beyond_32bit)
+{
+    DisplayInfo i; i.assign(lineNum_vector_t({ 1, 0xfffffffe }));
+    i.append_range(0xffffffff, 0x100000002);
+    ASSERT_EQ(6u, i.size());
+    ASSERT_EQ(0x100000002u, i.lastLineNum());
+    i.go_to_approx(0x100000000);
+    ASSERT_EQ(0x100000000u, i.topLineNum());
+    i.start();
+    ASSERT_TRUE(i.next());
+    ASSERT_EQ(0x100000001u, i.current());
+}
+#endif
+
+TEST(DisplayInfo, snapshot_does_not_change)
+{
+    DisplayInfo i; i.assign(lineNum_vector_t({ 1, 2, 3 }));
+    ASSERT_TRUE(i.go_to(2));
+    auto s = i.snapshot();
+    i.append_range(4, 5);
+    ASSERT_EQ(lineNum_vector_t({ 1, 2, 3 }), s->to_vector());
+    ASSERT_EQ(5u, i.size());
+    ASSERT_EQ(2u, i.topLineNum());
+
+    auto t = i.snapshot();
+    i.assign(lineNum_vector_t({ 2, 4 }));
+    ASSERT_EQ(lineNum_vector_t({ 1, 2, 3, 4, 5 }), t->to_vector());
+    ASSERT_EQ(lineNum_vector_t({ 1, 2, 3 }), s->to_vector());
+    ASSERT_EQ(2u, i.size());
+}
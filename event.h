@@ -17,12 +17,35 @@ struct event
     /// the index into the regex vector for ri_
     const unsigned ri_idx_;
 
-    explicit event(const std::string& i) : info_(i), ri_idx_(0) {}
-    explicit event(std::shared_ptr<regex_index> ri, const unsigned idx) : ri_(ri), ri_idx_(idx) {}
+    /// number of indexed lines, sent by the background indexing job; 0 otherwise.
+    const line_number_t indexed_;
+
+    /// true if the followed file changed, sent by a file_watcher.
+    const bool file_changed_;
+
+    /// id of the background search which sent the event, see search_in_background(); 0 otherwise.
+    /// If info_ is empty the search finished, otherwise info_ is its progress.
+    const unsigned search_id_;
+
+    /// line number found by the finished background search; 0 if no line matched.
+    const line_number_t search_line_;
+
+    /// tag type of the file changed event.
+    struct file_changed_t {};
+
+    /// tag type of the events of a background search.
+    struct search_t {};
+
+    explicit event(const std::string& i) : info_(i), ri_idx_(0), indexed_(0), file_changed_(false), search_id_(0), search_line_(0) {}
+    explicit event(std::shared_ptr<regex_index> ri, const unsigned idx) : ri_(ri), ri_idx_(idx), indexed_(0), file_changed_(false), search_id_(0), search_line_(0) {}
+    event(const std::string& i, const line_number_t indexed) : info_(i), ri_idx_(0), indexed_(indexed), file_changed_(false), search_id_(0), search_line_(0) {}
+    explicit event(file_changed_t) : ri_idx_(0), indexed_(0), file_changed_(true), search_id_(0), search_line_(0) {}
+    event(search_t, const unsigned id, const line_number_t line, const std::string& i = std::string()) : info_(i), ri_idx_(0), indexed_(0), file_changed_(false), search_id_(id), search_line_(line) {}
 
     bool operator== (const event& r) const
     {
-	return info_ == r.info_ && ri_ == r.ri_ && ri_idx_ == r.ri_idx_;
+	return info_ == r.info_ && ri_ == r.ri_ && ri_idx_ == r.ri_idx_ && indexed_ == r.indexed_ && file_changed_ == r.file_changed_
+	    && search_id_ == r.search_id_ && search_line_ == r.search_line_;
     }
 };
 
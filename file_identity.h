@@ -0,0 +1,48 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <string>
+#include <stdint.h>
+
+/**
+ * identifies a version of a file.
+ * If a file is modified, replaced or rotated at least one of the members changes.
+ */
+struct file_identity
+{
+    /// absolute path name.
+    std::string path_;
+    /// inode number or file index.
+    uint64_t inode_;
+    /// file size in bytes.
+    uint64_t size_;
+    /// modification time in nanoseconds.
+    uint64_t mtime_;
+
+    file_identity() : inode_(0), size_(0), mtime_(0) {}
+
+    /// @return a string that is unique for this version of the file.
+    std::string key() const
+    {
+	return path_ + '\n' + std::to_string(inode_) + '\n' + std::to_string(size_) + '\n' + std::to_string(mtime_);
+    }
+};
+
+/**
+ * get the identity of a file.
+ * @param[in] filename file name.
+ * @param[out] id identity of the file if the function returns true.
+ * @return true upon success; false if the file does not exist or is not a regular file.
+ */
+bool get_file_identity(const std::string& filename, file_identity& id);
+
+/**
+ * create a directory and all its missing parent directories.
+ * @return true if the directory exists.
+ */
+bool create_directories(const std::string& dir);
+
+/// @return the directory for cache files of the few program; empty string if it can not be determined.
+std::string default_cache_dir();
@@ -5,134 +5,476 @@
 #include "file_index.h"
 #include "error.h"
 #include "event.h"
+#include "find_newlines.h"
+#include "index_cache.h"
+#include "multi_matcher.h"
+#include "prefetcher.h"
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <thread>
 #include <sysexits.h>
 
 std::atomic_int file_index::abortBackgroundParse_s(-1);
+std::atomic<uint64_t> file_index::prefetchDistance_s(64*1024*1024);
+std::atomic_bool file_index::populate_s(false);
 
-file_index::file_index(const std::string& filename) :
-    file_(filename),
-    has_parsed_all_(false)
+namespace {
+    /**
+     * address space reserved past the end of a followed file, see follow().
+     * If the file grows beyond it, it has to be opened again.
+     */
+    const uint64_t follow_reserve = (sizeof(void*) >= 8) ? (4llu << 30) : (256llu << 20);
+}
+
+class file_index::scan_guard
 {
-    if (file_.empty()) {
+    const file_index& f_;
+public:
+    explicit scan_guard(const file_index& f) : f_(f)
+    {
+	std::lock_guard<std::mutex> lock(f_.scans_mutex_);
+	if (f_.scans_++ == 0) {
+	    f_.file_.advise(doj::memorymap_sequential);
+	}
+    }
+
+    ~scan_guard()
+    {
+	std::lock_guard<std::mutex> lock(f_.scans_mutex_);
+	if (--f_.scans_ == 0) {
+	    f_.file_.advise(doj::memorymap_random);
+	}
+    }
+};
+
+file_index::file_index(const std::string& filename, const bool follow) :
+    file_(filename, true, follow ? follow_reserve : 0, populate_s && ! follow),
+    filename_(filename),
+    follow_(follow),
+    has_parsed_all_(false),
+    stop_indexing_(false),
+    use_cache_(false),
+    loaded_from_cache_(false),
+    scans_(0)
+{
+    // a followed file can be empty, it is mapped into the reserved address space
+    if (! file_ || (file_.empty() && ! follow_)) {
 	throw error("could not memory map: " + filename, EX_NOINPUT);
     }
 
-    // we start counting lines with number 1. So add an invalid pointer to index 0.
-    line_.push_back(line_t(nullptr, nullptr, nullptr, 0));
+    if (follow_) {
+	// the offsets of all lines the file can grow to, so the table is not moved while it is read
+	offset_.reserve(file_.size() + follow_reserve + 2);
+    }
+
+    // only use the cache if the file did not change while it was mapped.
+    // A followed file changes, so its index is not cached.
+    if (get_file_identity(filename, id_) && id_.size_ == file_.size() && ! follow_) {
+	use_cache_ = index_cache_enabled(id_);
+	if (use_cache_) {
+	    loaded_from_cache_ = load_line_cache();
+	    has_parsed_all_ = loaded_from_cache_;
+	}
+    }
+}
+
+file_index::~file_index()
+{
+    if (indexed_.valid()) {
+	stop_indexing_ = true;
+	indexed_.wait();
+    }
+}
+
+std::string
+file_index::cache_name() const
+{
+    return "few line index\n" + id_.path_;
+}
+
+std::string
+file_index::cache_key() const
+{
+    return "few line index\n" + id_.key();
 }
 
 bool
-file_index::parse_line(const line_number_t num_)
+file_index::load_line_cache()
 {
-    if (file_.empty()) {
-	has_parsed_all_ = true;
+    auto c = std::make_shared<index_cache_file>(cache_name(), cache_key(), ".lines");
+    if (! c->valid()) {
 	return false;
     }
 
-    if (num_ <= size()) {
-	return true;
+    // validate the payload: the offsets of all lines have to cover the file
+    const uint64_t entries = c->size() / sizeof(line_offset_table::offset_t);
+    if (c->size() % sizeof(line_offset_table::offset_t) != 0 || entries < 2) {
+	return false;
+    }
+    const line_offset_table::offset_t* o = static_cast<const line_offset_table::offset_t*>(c->data());
+    if (o[0] != 0 || o[entries - 1] != file_.size()) {
+	return false;
+    }
+    // a corrupted cache file must not yield lines outside of the file: every line has at least one byte
+    for(uint64_t i = 1; i < entries; ++i) {
+	if (o[i] <= o[i-1]) {
+	    return false;
+	}
     }
 
-    line_number_t num = 0;
-    const c_t* it = nullptr;
-    if (num_ > 1 && size() > 0) {
-	line_t current_line = line_[size()];
-	it = current_line.next_;
-	num = current_line.num_;
-    } else {
-	it = file_.begin();
+    offset_.assign(o, entries, c);
+    return true;
+}
+
+void
+file_index::save_line_cache() const
+{
+    const uint64_t bytes = offset_.entries() * sizeof(line_offset_table::offset_t);
+    index_cache_writer w(cache_name(), cache_key(), ".lines", bytes);
+    bool ok = true;
+    offset_.for_each_block([&](const line_offset_table::offset_t* data, uint64_t num) {
+	    ok = ok && w.write(data, num * sizeof(line_offset_table::offset_t));
+	});
+    if (ok) {
+	w.commit();
     }
+}
 
-    const c_t* const end = file_.end();
-    if (it == end) {
+bool
+file_index::parse_line(const line_number_t num_)
+{
+    if (num_ <= size()) {
+	return true;
+    }
+    if (has_parsed_all_) {
 	return false;
     }
-    if (it == nullptr) {
+    if (indexed_.valid()) {
+	// the background indexing job adds the lines
+	return false;
+    }
+    if (file_.empty()) {
+	has_parsed_all_ = true;
 	return false;
     }
 
-    assert(it);
-    const c_t* beg = it;
-    while(num < num_) {
-	if (*it == '\n') {
-	    const c_t* next = it + 1;
-	    push_line(beg, it, next, ++num);
-	    beg = next;
+    line_number_t num = size();
+    const c_t* it = file_.begin() + offset_.back();
+    const c_t* const end = file_.end();
+
+    const size_t batch = 256;
+    const c_t* nl[batch];
+    while(num < num_ && it < end) {
+	const size_t max = (num_ - num < batch) ? num_ - num : batch;
+	const size_t n = find_newlines(it, end, nl, nullptr, max);
+	for(size_t i = 0; i < n; ++i) {
+	    it = nl[i] + 1;
+	    offset_.push_back(it - file_.begin());
+	    ++num;
 	}
-	++it;
-	if (it == end) {
-	    if (it != beg) {
-		push_line(beg, it, nullptr, ++num);
+	if (n < max) {
+	    // there are no more newline characters in the file
+	    if (it != end && ! follow_) {
+		offset_.push_back(end - file_.begin());
+		++num;
 	    }
-	    has_parsed_all_ = true;
-	    break;
+	    it = end;
 	}
     }
+    if (it == end) {
+	has_parsed_all_ = true;
+    }
 
     return num == num_;
 }
 
-void
-file_index::push_line(const c_t* beg, const c_t* end, const c_t* next, const line_number_t num)
+line_t
+file_index::make_line(const line_number_t num) const
 {
-    while(beg < end) {
-	if (*(end - 1) == '\n') {
-	    --end;
-	    continue;
-	}
-	if (*(end - 1) == '\r') {
-	    --end;
-	    continue;
-	}
-	break;
+    assert(num > 0);
+    assert(num <= size());
+    const c_t* const begin = file_.begin();
+    const c_t* beg = begin + offset_.at(num - 1);
+    const c_t* next = begin + offset_.at(num);
+    // strip newline and carriage return characters
+    const c_t* end = next;
+    while(beg < end && (*(end - 1) == '\n' || *(end - 1) == '\r')) {
+	--end;
+    }
+    // only the last line can miss a newline character, it does not have a next line
+    if (*(next - 1) != '\n') {
+	next = nullptr;
     }
-    line_.push_back(line_t(beg, end, next, num));
+    return line_t(beg, end, next, num);
 }
 
 line_t file_index::line(const line_number_t num)
 {
+    // line number 0 is invalid
+    if (num == 0) {
+	return line_t();
+    }
     if (num > size()) {
 	if (! parse_line(num)) {
 	    throw std::runtime_error("file_index::line(" + std::to_string(num) + "): number too large, file only contains " + std::to_string(size()));
 	}
     }
-    line_t l = line_[num];
-    assert(l.num_ == num);
-    return l;
+    return make_line(num);
 }
 
 lineNum_vector_t
 file_index::lineNum_vector()
 {
     const line_number_t s = size();
-    lineNum_vector_t v(s);
-    for(line_number_t i = 0; i < s; ++i) {
-	v[i] = i + 1;
+    lineNum_vector_t v;
+    v.reserve(s);
+    for(line_number_t i = 1; i <= s && i != 0; ++i) {
+	v.push_back(i);
     }
     return v;
 }
 
+void
+file_index::scan_chunk(const c_t* beg, const c_t* end, std::vector<line_offset_table::offset_t>& next) const
+{
+    const size_t batch = 256;
+    const c_t* nl[batch];
+    while(beg < end) {
+	const size_t n = find_newlines(beg, end, nl, nullptr, batch);
+	for(size_t i = 0; i < n; ++i) {
+	    beg = nl[i] + 1;
+	    next.push_back(beg - file_.begin());
+	}
+	if (n < batch) {
+	    if (beg != end && ! follow_) {
+		// only the last line of the file can miss the newline character
+		assert(end == file_.end());
+		next.push_back(end - file_.begin());
+	    }
+	    break;
+	}
+    }
+}
+
+void
+file_index::index_range(const c_t* beg, const c_t* end, unsigned num_threads, uint64_t min_chunk_size)
+{
+    // split the range into chunks
+    if (num_threads == 0) {
+	num_threads = std::thread::hardware_concurrency();
+    }
+    if (min_chunk_size == 0) {
+	min_chunk_size = 1;
+    }
+    const uint64_t bytes = end - beg;
+    uint64_t num_chunks = bytes / min_chunk_size;
+    if (num_chunks > num_threads) {
+	num_chunks = num_threads;
+    }
+    if (num_chunks < 1) {
+	num_chunks = 1;
+    }
+
+    // every chunk starts at the beginning of a line
+    std::vector<const c_t*> chunk(num_chunks + 1);
+    chunk[0] = beg;
+    chunk[num_chunks] = end;
+    for(uint64_t i = 1; i < num_chunks; ++i) {
+	const c_t* p = beg + bytes * i / num_chunks;
+	if (p < chunk[i-1]) {
+	    p = chunk[i-1];
+	}
+	const c_t* nl = static_cast<const c_t*>(memchr(p, '\n', end - p));
+	chunk[i] = nl ? nl + 1 : end;
+    }
+
+    // find the lines of each chunk in parallel
+    std::vector<std::vector<line_offset_table::offset_t>> chunk_lines(num_chunks);
+    std::vector<std::thread> threads;
+    for(uint64_t i = 1; i < num_chunks; ++i) {
+	threads.push_back(std::thread(&file_index::scan_chunk, this, chunk[i], chunk[i+1], std::ref(chunk_lines[i])));
+    }
+    scan_chunk(chunk[0], chunk[1], chunk_lines[0]);
+    for(auto& t : threads) {
+	t.join();
+    }
+
+    // stitch the chunks together. The offsets are absolute, so the line number of a line is
+    // the sum of the line counts of all previous chunks plus its chunk relative number.
+    for(auto& v : chunk_lines) {
+	for(auto o : v) {
+	    offset_.push_back(o);
+	}
+	std::vector<line_offset_table::offset_t>().swap(v);
+    }
+}
+
+void
+file_index::index_all(unsigned num_threads, uint64_t min_chunk_size)
+{
+    if (indexed_.valid()) {
+	indexed_.wait();
+	return;
+    }
+    if (has_parsed_all_) {
+	return;
+    }
+    if (file_.empty()) {
+	has_parsed_all_ = true;
+	return;
+    }
+
+    // find the first character that has not been indexed yet
+    const c_t* beg = file_.begin() + offset_.back();
+    const c_t* const end = file_.end();
+    if (beg >= end) {
+	has_parsed_all_ = true;
+	return;
+    }
+
+    {
+	scan_guard scan(*this);
+	index_range(beg, end, num_threads, min_chunk_size);
+    }
+    has_parsed_all_ = true;
+
+    if (use_cache_) {
+	save_line_cache();
+    }
+}
+
+void
+file_index::index_in_background(const line_number_t first_lines, const unsigned num_threads)
+{
+    if (indexed_.valid()) {
+	return;
+    }
+    parse_line(first_lines);
+    if (has_parsed_all_) {
+	return;
+    }
+    // every character could be a newline, so this is the maximum number of offsets
+    offset_.reserve(file_.size() + 2);
+    indexed_ = std::async(std::launch::async, &file_index::index_segments, this, num_threads).share();
+}
+
+void
+file_index::index_segments(const unsigned num_threads)
+{
+    // the first segments are small, so the first lines are shown quickly
+    const uint64_t min_segment_size = 1024*1024;
+    const uint64_t max_segment_size = 64*1024*1024;
+    uint64_t segment_size = min_segment_size;
+
+    scan_guard scan(*this);
+    const auto start = std::chrono::steady_clock::now();
+    const c_t* const begin = file_.begin() + offset_.back();
+    const c_t* const end = file_.end();
+    const c_t* beg = begin;
+    prefetcher pf(beg, end, prefetchDistance_s);
+    while(beg < end) {
+	if (stop_indexing_) {
+	    return;
+	}
+	pf.advance(beg);
+
+	// a segment ends at the beginning of a line
+	const c_t* seg_end = end;
+	if (static_cast<uint64_t>(end - beg) > segment_size) {
+	    const c_t* nl = static_cast<const c_t*>(memchr(beg + segment_size, '\n', end - beg - segment_size));
+	    seg_end = nl ? nl + 1 : end;
+	}
+	index_range(beg, seg_end, num_threads, 4*1024*1024);
+	beg = seg_end;
+	if (beg == end) {
+	    has_parsed_all_ = true;
+	}
+	if (segment_size < max_segment_size) {
+	    segment_size *= 2;
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const uint64_t mb_per_s = (seconds > 0) ? static_cast<uint64_t>((beg - begin) / seconds / (1024*1024)) : 0;
+	const unsigned perc = static_cast<uint64_t>(beg - file_.begin()) * 100llu / file_.size();
+	eventAdd(event("indexed " + std::to_string(size()) + " lines " + std::to_string(perc) + "% " + std::to_string(mb_per_s) + " MB/s", size()));
+    }
+
+    has_parsed_all_ = true;
+    if (use_cache_) {
+	save_line_cache();
+    }
+}
+
+namespace {
+    /**
+     * number of lines a thread of file_index::parse_all() and file_index::parse_all_in_background() match at once.
+     * After each block the abort flag is checked and progress is reported.
+     */
+    const line_number_t match_block_lines = 16384;
+}
+
 void
 file_index::parse_all(regex_index_vec_t& regex_index_vec, ProgressFunctor *func)
 {
-    for(line_number_t num = 1; true; ++num) {
-	if (num > size()) {
-	    if (! parse_line(num)) {
-		break;
+    index_all();
+
+    scan_guard scan(*this);
+    prefetcher pf(file_.begin(), file_.end(), prefetchDistance_s);
+    const line_number_t s = size();
+    if (regex_index_vec.size() == 1) {
+	// a single regular expression is matched in blocks of lines, see match_range()
+	auto ri = regex_index_vec[0];
+	for(line_number_t first = 1; first <= s; first += match_block_lines) {
+	    const line_number_t last = (s - first < match_block_lines) ? s : first + match_block_lines - 1;
+	    pf.advance(file_.begin() + offset_.at(first - 1));
+	    line_bitmap v;
+	    match_range(*ri, first, last, v);
+	    ri->append(std::move(v));
+	    if (func) {
+		func->progress(last, static_cast<unsigned>(offset_.at(last) * 100llu / file_.size()));
 	    }
 	}
+	ri->optimize();
+	if (use_cache_) {
+	    ri->save_cache(id_);
+	}
+	ri->set_matched(s);
+	return;
+    }
+
+    // match several regular expressions in one pass over each line
+    std::unique_ptr<multi_matcher> mm;
+    if (regex_index_vec.size() > 1) {
+	mm.reset(new multi_matcher(regex_index_vec));
+    }
 
-	const line_t& line = line_[num];
-	for(auto ri : regex_index_vec) {
-	    ri->match(line);
+    for(line_number_t num = 1; num <= s; ++num) {
+	const line_t line = make_line(num);
+	if (mm) {
+	    mm->match(line);
+	} else {
+	    for(auto ri : regex_index_vec) {
+		ri->match(line);
+	    }
 	}
 
+	if ((num % match_block_lines) == 0) {
+	    pf.advance(line.end_);
+	}
 	if (func && (num % 10000) == 0) {
-	    const uint64_t pos = line.end_ - line_[1].beg_;
+	    const uint64_t pos = line.end_ - file_.begin();
 	    func->progress(num, static_cast<unsigned>(pos * 100llu / file_.size()));
 	}
     }
+
+    for(auto ri : regex_index_vec) {
+	ri->optimize();
+	if (use_cache_) {
+	    ri->save_cache(id_);
+	}
+	ri->set_matched(s);
+    }
 }
 
 void
@@ -153,13 +495,51 @@ unsigned
 file_index::perc(const line_number_t num)
 {
     const line_number_t s = size();
-    if (num > s) { return 100u; }
+    if (num > s || s == 0) { return 100u; }
     return static_cast<uint64_t>(num) * 100llu / s;
 }
 
+void
+file_index::match_range(const regex_index& ri, const line_number_t first, const line_number_t last, line_bitmap& v) const
+{
+    const literal_prefilter& p = ri.prefilter();
+    if (p.literal().empty()) {
+	for(line_number_t i = first; i <= last; ++i) {
+	    if (ri.matches(make_line(i))) {
+		v.add(i);
+	    }
+	}
+	return;
+    }
+
+    // search the literal in the buffer of all lines and only match the lines that contain it.
+    // lines without the literal only match if the '!' flag was used.
+    const bool add_missing = ! ri.positive_match();
+    const c_t* const end = file_.begin() + offset_.at(last);
+    const c_t* pos = file_.begin() + offset_.at(first - 1);
+    line_number_t next = first;
+    while(pos < end && (pos = p.find(pos, end)) != nullptr) {
+	const line_number_t num = offset_.upper_bound(pos - file_.begin(), next, last);
+	if (add_missing && next < num) {
+	    v.add_range(next, num - 1);
+	}
+	if (ri.matches(make_line(num))) {
+	    v.add(num);
+	}
+	next = num + 1;
+	pos = file_.begin() + offset_.at(num);
+    }
+    if (add_missing && next <= last) {
+	v.add_range(next, last);
+    }
+}
+
 bool
-file_index::parse_all_in_background(std::shared_ptr<regex_index> ri, const unsigned idx) const
+file_index::parse_all_in_background(std::shared_ptr<regex_index> ri, const unsigned idx, unsigned num_threads, const std::string& name) const
 {
+    if (indexed_.valid()) {
+	indexed_.wait();
+    }
     if (! has_parsed_all_) {
 	return false;
     }
@@ -167,22 +547,125 @@ file_index::parse_all_in_background(std::shared_ptr<regex_index> ri, const unsig
     // reset the variable, so background jobs are not aborted.
     abortBackgroundParse_s = -1;
 
-    // iterator over all lines
-    const unsigned line_size = line_.size();
-    for(unsigned i = 1; i < line_size; ++i) {
-	ri->match(line_[i]);
-	// every 10000 lines do bookkeeping
-	if ((i % 10000) == 0) {
+    scan_guard scan(*this);
+    prefetcher pf(file_.begin(), file_.end(), prefetchDistance_s);
+
+    const line_number_t s = size();
+    const uint64_t num_blocks = (static_cast<uint64_t>(s) + match_block_lines - 1) / match_block_lines;
+    if (num_threads == 0) {
+	num_threads = std::thread::hardware_concurrency();
+    }
+    if (num_threads > num_blocks) {
+	num_threads = num_blocks;
+    }
+    if (num_threads < 1) {
+	num_threads = 1;
+    }
+
+    // the threads take the next unmatched block until all blocks are matched
+    std::vector<line_bitmap> block_lines(num_blocks);
+    std::atomic<uint64_t> next_block(0);
+    std::atomic<uint64_t> matched_lines(0);
+    std::atomic_bool aborted(false);
+    auto match_blocks = [&](std::shared_ptr<regex_index> rgx, const bool report_progress) {
+	uint64_t b;
+	while(!aborted && (b = next_block++) < num_blocks) {
+	    const line_number_t first = b * match_block_lines + 1;
+	    const line_number_t last = (s - first < match_block_lines) ? s : first + match_block_lines - 1;
+	    // the blocks are taken in file order, so the first line of the block is the scan position
+	    pf.advance(file_.begin() + offset_.at(first - 1));
+	    match_range(*rgx, first, last, block_lines[b]);
+
 	    // check if we should abort
 	    const int aBP_s = abortBackgroundParse_s;
 	    if (aBP_s == -2 || aBP_s == static_cast<int>(idx)) {
-		return false;
+		aborted = true;
+		return;
 	    }
+	    const uint64_t m = matched_lines += last - first + 1;
 	    // report progress to main window
-	    const unsigned perc = static_cast<double>(i) / static_cast<double>(line_size) * 100.0;
-	    eventAdd(event("#" + std::to_string(idx+1u) + " matching line " + std::to_string(i) + " " + std::to_string(perc) + "%"));
+	    if (report_progress) {
+		const unsigned perc = static_cast<double>(m) / static_cast<double>(s) * 100.0;
+		eventAdd(event((name.empty() ? "#" + std::to_string(idx+1u) : name) + " matching line " + std::to_string(m) + " " + std::to_string(perc) + "%"));
+	    }
 	}
+    };
+
+    std::vector<std::thread> threads;
+    for(unsigned t = 1; t < num_threads; ++t) {
+	threads.push_back(std::thread(match_blocks, ri->clone(), false));
+    }
+    match_blocks(ri, true);
+    for(auto& t : threads) {
+	t.join();
+    }
+    if (aborted) {
+	return false;
+    }
+
+    // the blocks are in line number order, so the concatenated line numbers are sorted
+    for(auto& v : block_lines) {
+	ri->append(std::move(v));
+    }
+    ri->optimize();
+    ri->set_matched(s);
+
+    if (use_cache_) {
+	ri->save_cache(id_);
     }
 
     return true;
 }
+
+file_index::follow_status
+file_index::follow()
+{
+    if (! follow_ || ! has_parsed_all_) {
+	return file_unchanged;
+    }
+
+    // a file that was truncated and grew again has different lines
+    if (file_.truncated()) {
+	return file_replaced;
+    }
+    file_identity id;
+    if (! get_file_identity(filename_, id)) {
+	// the file may be rotated right now, check again later
+	return file_unchanged;
+    }
+    const uint64_t mapped = file_.size();
+    if (id.inode_ != id_.inode_ || id.size_ < mapped) {
+	return file_replaced;
+    }
+    if (id.size_ == mapped) {
+	return file_unchanged;
+    }
+    if (file_.grow() < id.size_) {
+	return file_replaced;
+    }
+
+    // only index complete lines, an incomplete last line is indexed once it is terminated
+    const c_t* const beg = file_.begin() + offset_.back();
+    const c_t* end = file_.end();
+    while(end > beg && *(end - 1) != '\n') {
+	--end;
+    }
+    if (end == beg) {
+	return file_unchanged;
+    }
+    index_range(beg, end, 0, 4*1024*1024);
+    return file_grew;
+}
+
+line_bitmap
+file_index::match_new_lines(regex_index& ri) const
+{
+    line_bitmap v;
+    const line_number_t s = size();
+    if (follow_ && ri.matched() < s) {
+	match_range(ri, ri.matched() + 1, s, v);
+	ri.append(line_bitmap(v));
+	ri.set_matched(s);
+    }
+    return v;
+}
@@ -6,9 +6,13 @@
 #include "memorymap.h"
 #include "progress_functor.h"
 #include "regex_index.h"
+#include "line_offset_table.h"
+#include "file_identity.h"
 #include <vector>
 #include <cassert>
 #include <atomic>
+#include <future>
+#include <mutex>
 
 class file_index
 {
@@ -17,15 +21,50 @@ class file_index
 
     doj::memorymap_ptr<c_t> file_;
 
+    /// name of the mapped file.
+    const std::string filename_;
+
+    /// true if the file is followed, see follow().
+    const bool follow_;
+
     /**
-     * all lines, indexed by their line number.
-     * The first line in the file has line number 1.
-     * The entry with index 0 is invalid and should not be used.
+     * offsets of all lines. The first line in the file has line number 1.
+     * The line_t objects are created on demand by make_line().
      */
-    std::vector<line_t> line_;
+    line_offset_table offset_;
 
     /// true if the entire file has been parsed.
-    bool has_parsed_all_;
+    std::atomic_bool has_parsed_all_;
+
+    /// the background indexing job, see index_in_background().
+    std::shared_future<void> indexed_;
+
+    /// set to stop the background indexing job.
+    std::atomic_bool stop_indexing_;
+
+    /// identity of the file, used to look up the index cache.
+    file_identity id_;
+
+    /// true if the index of id_ should be cached.
+    bool use_cache_;
+
+    /// true if the line index was loaded from the index cache.
+    bool loaded_from_cache_;
+
+    /// @return name of the line index in the index cache, which is the same for all versions of the file.
+    std::string cache_name() const;
+
+    /// @return key of the line index of this version of the file in the index cache.
+    std::string cache_key() const;
+
+    /**
+     * try to load the line index from the index cache.
+     * @return true if a valid cached line index was found.
+     */
+    bool load_line_cache();
+
+    /// write the line index to the index cache.
+    void save_line_cache() const;
 
     /**
      * parse line number num from the file.
@@ -34,12 +73,62 @@ class file_index
      */
     bool parse_line(const line_number_t num);
 
-    void push_line(const c_t* beg, const c_t* end, const c_t* next, const line_number_t num);
+    /**
+     * create the line_t object for an indexed line.
+     * @param num line number, has to be <= size().
+     */
+    line_t make_line(const line_number_t num) const;
+
+    /**
+     * find all lines in the chunk [beg, end).
+     * @param beg first character of the chunk, has to be the first character of a line.
+     * @param end one past the last character of the chunk. Has to be the first character of a line or the end of the file.
+     * @param[out] next vector which the offsets following each line are appended to.
+     */
+    void scan_chunk(const c_t* beg, const c_t* end, std::vector<line_offset_table::offset_t>& next) const;
+
+    /**
+     * index the lines in [beg, end) with several threads and add them to offset_.
+     * @param beg first character that is not indexed yet.
+     * @param end one past the last character to index. Has to be the first character of a line or the end of the file.
+     * @param num_threads number of threads to use; 0 uses one thread per core.
+     * @param min_chunk_size minimum size of the part of a thread in bytes.
+     */
+    void index_range(const c_t* beg, const c_t* end, unsigned num_threads, uint64_t min_chunk_size);
+
+    /// index the remaining lines in segments and report the progress with events. Runs in the background indexing job.
+    void index_segments(const unsigned num_threads);
+
+    /**
+     * match the lines [first, last] with ri.
+     * If ri has a required literal, the literal is searched in the buffer of all lines and only
+     * the lines containing the literal are matched with the regular expression. The line number
+     * of a found literal is looked up with a binary search in the line offset table.
+     * Otherwise every line is matched.
+     * @param[out] v the matching line numbers are added to v.
+     */
+    void match_range(const regex_index& ri, const line_number_t first, const line_number_t last, line_bitmap& v) const;
+
+    /// number of running scans of the entire file, see scan_guard.
+    mutable unsigned scans_;
+    mutable std::mutex scans_mutex_;
+
+    /**
+     * advises the memory map to be read sequentially while a scan of the entire file runs.
+     * When the last scan finishes the file is only browsed, so the memory map is advised to be read randomly.
+     */
+    class scan_guard;
 
     /// control if background jobs should be aborted.
     /// see abort_background_parse() for a description what different values accomplish.
     static std::atomic_int abortBackgroundParse_s;
 
+    /// number of bytes read ahead of a scan of the entire file, see set_prefetch_distance().
+    static std::atomic<uint64_t> prefetchDistance_s;
+
+    /// true if files are read into memory when they are mapped, see set_populate().
+    static std::atomic_bool populate_s;
+
 public:
 
     /**
@@ -48,6 +137,20 @@ public:
      */
     static void abort_background_parse(const int idx = -2) { abortBackgroundParse_s = idx; }
 
+    /**
+     * set the number of bytes, which a background thread reads ahead of the indexing and matching threads, see prefetcher.
+     * @param distance number of bytes; 0 disables the read ahead thread.
+     */
+    static void set_prefetch_distance(const uint64_t distance) { prefetchDistance_s = distance; }
+
+    /**
+     * read the whole file into memory when a file_index is constructed, see doj::memorymap().
+     * The file is indexed without page faults, but the first lines are shown after the whole file was read.
+     * A followed file is not read into memory.
+     * @param populate true to map files with MAP_POPULATE.
+     */
+    static void set_populate(const bool populate) { populate_s = populate; }
+
     typedef std::shared_ptr<file_index> ptr_t;
 
     typedef std::vector<std::shared_ptr<regex_index>> regex_index_vec_t;
@@ -55,15 +158,39 @@ public:
     /**
      * construct and initialize the file_index with the contents of filename.
      * @param filename file name to initialize lines from.
+     * @param follow if true the file can grow, see follow(). The index cache is not used and
+     *        an incomplete last line is only indexed once it is terminated by a newline character.
      */
-    explicit file_index(const std::string& filename);
+    explicit file_index(const std::string& filename, const bool follow = false);
+
+    /// stop the background indexing job.
+    ~file_index();
 
-    /// @return the number of currently parsed lines. This could be less than the total number of lines in the file.
+    /**
+     * @return the number of currently parsed lines. This could be less than the total number of lines in the file.
+     * At most max_line_number lines are used.
+     */
     line_number_t size() const
     {
-	return line_.size() - 1;
+	const uint64_t s = offset_.size();
+	return (s < max_line_number) ? s : max_line_number;
     }
 
+    /// @return number of bytes used by the line index.
+    uint64_t memory_usage() const { return offset_.memory_usage(); }
+
+    /// @return true if the line index was loaded from the index cache, see index_cache_setup().
+    bool loaded_from_cache() const { return loaded_from_cache_; }
+
+    /**
+     * load the matching lines of ri from the index cache.
+     * @return true if the result of ri for this file was found in the index cache.
+     */
+    bool load_cache(regex_index& ri) const { return use_cache_ && ri.load_cache(id_); }
+
+    /// @return the identity of the file when it was opened.
+    const file_identity& identity() const { return id_; }
+
     /**
      * get line number num.
      * @throws std::runtime_error if the line does not exist.
@@ -74,6 +201,42 @@ public:
     unsigned perc(const line_number_t num);
 
     /**
+     * index all remaining lines of the file.
+     * The file is split into chunks on line boundaries and each chunk is indexed by its own thread.
+     * The line offsets are identical to indexing the file line by line.
+     * @param num_threads number of threads to use; 0 uses one thread per core.
+     * @param min_chunk_size minimum size of a chunk in bytes. Small files are indexed by a single thread.
+     */
+    void index_all(unsigned num_threads = 0, uint64_t min_chunk_size = 4*1024*1024);
+
+    /**
+     * index the first lines of the file and start a background job, which indexes the remaining lines.
+     * Other threads can read the indexed lines, size() grows while the job runs.
+     * The job sends an event with the number of indexed lines and the indexing rate after each segment of the file.
+     * index_all() and parse_all() wait for the job to finish.
+     * @param first_lines number of lines that are indexed before this function returns.
+     * @param num_threads number of threads of the job; 0 uses one thread per core.
+     */
+    void index_in_background(const line_number_t first_lines, const unsigned num_threads = 0);
+
+    /// @return true if all lines of the file are indexed.
+    bool indexed() const { return has_parsed_all_; }
+
+    /// @return true if the file can grow, see follow().
+    bool following() const { return follow_; }
+
+    /**
+     * check if the followed file was truncated in place, e.g. by logrotate's copytruncate.
+     * Reading a line past the new end of the file raises SIGBUS, so the main thread checks the file
+     * before it reads lines and opens it again, see doj::memorymaptruncated(). A background job
+     * that reads the lines while the file is truncated is not protected.
+     * @return true if the file has to be opened again.
+     */
+    bool truncated() const { return follow_ && file_.truncated(); }
+
+    /**
+     * index the entire file and match all lines with the regex_index objects.
+     * Several regex_index objects are matched in one pass over each line, see multi_matcher.
      * @param os output stream to print progress information on, can be nullptr.
      */
     void parse_all(regex_index_vec_t& regex_index_vec, ProgressFunctor *func = nullptr);
@@ -84,14 +247,46 @@ public:
 
     /**
      * allow a background thread to parse the entire file and match with a regex_index object.
-     * This function is only valid if parse_all() has been called before and the entire file is indexed.
+     * This function is only valid if the entire file is indexed, see index_all().
+     * It waits for the background indexing job of index_in_background().
+     * The lines are split into blocks which are matched by num_threads threads,
+     * each thread uses its own clone of ri.
      * @param[in,out] ri regex_index object.
      * @param[in] idx regular expression index of the job.
+     * @param[in] num_threads number of threads; if 0 use one thread per core.
+     * @param[in] name name of the job in the progress events; if empty the regular expression index is used.
      * @return true if parsing finished.
      * @return false if parse was aborted.
      */
-    bool parse_all_in_background(std::shared_ptr<regex_index> ri, const unsigned idx) const;
+    bool parse_all_in_background(std::shared_ptr<regex_index> ri, const unsigned idx, unsigned num_threads = 0, const std::string& name = std::string()) const;
 
     /// @return the line number vector of all lines in the file.
     lineNum_vector_t lineNum_vector();
+
+    /// return values of the follow() function.
+    enum follow_status {
+	/// no new lines were indexed.
+	file_unchanged,
+	/// lines were appended to the file and indexed.
+	file_grew,
+	/// the file was rotated, truncated or grew beyond the reserved address space and has to be opened again.
+	file_replaced,
+    };
+
+    /**
+     * check if the followed file changed and index the appended lines.
+     * The file is not mapped again, the map grows into address space which was reserved when the file was opened.
+     * Only complete lines are indexed. The new lines are the lines after size() before the call.
+     * This function does nothing until the file is indexed, see indexed().
+     * @return file_grew if new lines were indexed.
+     */
+    follow_status follow();
+
+    /**
+     * match the lines which were added by follow() with ri and add the matching lines to ri.
+     * This function does nothing if the file is not followed.
+     * @param[in,out] ri regex_index object, which has matched the lines [1, ri.matched()].
+     * @return the new matching lines.
+     */
+    line_bitmap match_new_lines(regex_index& ri) const;
 };
@@ -5,8 +5,15 @@
 
 #include "gtest/gtest.h"
 #include "file_index.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include "getRSS.h"
+#include "event.h"
 #include <stdexcept>
 #include <memory>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 
 TEST(file_index, counts_lines_correctly)
 {
@@ -32,3 +39,349 @@ TEST(file_index, can_get_10th_line)
     auto f_idx = std::make_shared<file_index>("test.txt");
     ASSERT_EQ(std::string("This is line #10."), f_idx->line(10).to_string());
 }
+
+namespace {
+    /// write s into the temporary file tmp.
+    void write_file(TemporaryFile& tmp, const std::string& s)
+    {
+	FILE *f = tmp.file();
+	ASSERT_TRUE(f != nullptr);
+	ASSERT_EQ(s.size(), fwrite(s.data(), 1, s.size(), f));
+	ASSERT_TRUE(tmp.close());
+    }
+
+    /// check that indexing filename with num_threads threads results in the same lines as indexing line by line.
+    void expect_same_lines(const std::string& filename, const unsigned num_threads)
+    {
+	auto serial = std::make_shared<file_index>(filename);
+	line_number_t num = 1;
+	try {
+	    while(true) {
+		serial->line(num++);
+	    }
+	} catch (std::runtime_error&) { }
+
+	auto parallel = std::make_shared<file_index>(filename);
+	parallel->index_all(num_threads, 1);
+	ASSERT_EQ(serial->size(), parallel->size());
+	// both objects map the file to different addresses, compare the offsets into the file
+	const char* a_base = serial->line(1).beg_;
+	const char* b_base = parallel->line(1).beg_;
+	for(num = 1; num <= serial->size(); ++num) {
+	    const line_t a = serial->line(num);
+	    const line_t b = parallel->line(num);
+	    ASSERT_EQ(a.num_, b.num_);
+	    ASSERT_EQ(a.beg_ - a_base, b.beg_ - b_base);
+	    ASSERT_EQ(a.end_ - a_base, b.end_ - b_base);
+	    ASSERT_EQ(a.next_ == nullptr, b.next_ == nullptr);
+	    if (a.next_) {
+		ASSERT_EQ(a.next_ - a_base, b.next_ - b_base);
+	    }
+	}
+    }
+}
+
+TEST(file_index, index_all_counts_lines_correctly)
+{
+    auto f_idx = std::make_shared<file_index>("test.txt");
+    f_idx->index_all(4, 1);
+    ASSERT_EQ(25u, f_idx->size());
+    ASSERT_EQ(std::string("This is line #10."), f_idx->line(10).to_string());
+    ASSERT_EQ(std::string("This is the last line #25."), f_idx->line(25).to_string());
+}
+
+TEST(file_index, index_all_is_identical_to_serial_parse)
+{
+    for(unsigned t = 1; t <= 7; ++t) {
+	expect_same_lines("test.txt", t);
+    }
+
+    TemporaryFile tmp;
+    write_file(tmp, "first\r\n\n\r\nx\ny\r\r\n\n\nlast line without newline");
+    for(unsigned t = 1; t <= 7; ++t) {
+	expect_same_lines(to_utf8(tmp.filename()), t);
+    }
+}
+
+TEST(file_index, index_all_continues_after_line_access)
+{
+    auto f_idx = std::make_shared<file_index>("test.txt");
+    ASSERT_EQ(std::string("This is line #10."), f_idx->line(10).to_string());
+    f_idx->index_all(3, 1);
+    ASSERT_EQ(25u, f_idx->size());
+    ASSERT_EQ(std::string("This is line #20."), f_idx->line(20).to_string());
+}
+
+TEST(file_index, small_file_uses_small_line_index)
+{
+    // the first block of the line index is not a huge page
+    auto f_idx = std::make_shared<file_index>("test.txt");
+    f_idx->index_all();
+    ASSERT_EQ(25u, f_idx->size());
+    ASSERT_LT(f_idx->memory_usage(), 16*1024u);
+
+    // the line index grows with the file
+    TemporaryFile tmp;
+    std::string s;
+    for(unsigned i = 1; i <= 300000; ++i) {
+	s += std::to_string(i) + "\n";
+    }
+    write_file(tmp, s);
+    f_idx = std::make_shared<file_index>(to_utf8(tmp.filename()));
+    f_idx->index_all();
+    ASSERT_EQ(300000u, f_idx->size());
+    for(unsigned i : { 1u, 1024u, 1025u, 4097u, 16385u, 65537u, 262144u, 262145u, 300000u }) {
+	ASSERT_EQ(std::to_string(i), f_idx->line(i).to_string());
+    }
+}
+
+TEST(file_index, populate_reads_the_file_into_memory)
+{
+    file_index::set_populate(true);
+    auto f_idx = std::make_shared<file_index>("test.txt");
+    file_index::set_populate(false);
+    f_idx->index_all();
+    ASSERT_EQ(25u, f_idx->size());
+    ASSERT_EQ(std::string("This is the last line #25."), f_idx->line(25).to_string());
+}
+
+TEST(file_index, index_in_background_publishes_lines_while_indexing)
+{
+    // the file has several segments of the background indexing job
+    TemporaryFile tmp;
+    std::string s;
+    const line_number_t lines = 200000;
+    for(line_number_t i = 1; i <= lines; ++i) {
+	s += "line " + std::to_string(i) + " of the background indexing test\n";
+    }
+    write_file(tmp, s);
+
+    auto f_idx = std::make_shared<file_index>(to_utf8(tmp.filename()));
+    f_idx->index_in_background(100, 2);
+    ASSERT_GE(f_idx->size(), 100u);
+
+    // read the published lines while the job adds lines
+    line_number_t checked = 0;
+    while(checked < lines) {
+	const line_number_t n = f_idx->size();
+	for(; checked < n; ++checked) {
+	    ASSERT_EQ("line " + std::to_string(checked + 1) + " of the background indexing test", f_idx->line(checked + 1).to_string());
+	}
+    }
+    f_idx->index_all();
+    ASSERT_TRUE(f_idx->indexed());
+    ASSERT_EQ(lines, f_idx->size());
+
+    // the job reports the number of indexed lines with events
+    line_number_t last = 0;
+    while(eventPending()) {
+	const event e = eventGet();
+	if (e.indexed_ > 0) {
+	    EXPECT_GT(e.indexed_, last);
+	    last = e.indexed_;
+	}
+    }
+    ASSERT_EQ(lines, last);
+}
+
+namespace {
+    void append_file(const std::string& filename, const std::string& s)
+    {
+	std::ofstream os(filename, std::ios::app | std::ios::binary);
+	os << s;
+    }
+}
+
+TEST(file_index, follow_indexes_appended_lines)
+{
+    TemporaryFile tmp;
+    const std::string fn = to_utf8(tmp.filename());
+    write_file(tmp, "line 1\nline 2\nincomplete");
+
+    auto f_idx = std::make_shared<file_index>(fn, true);
+    ASSERT_TRUE(f_idx->following());
+    f_idx->index_all();
+    // the incomplete last line is not indexed
+    ASSERT_EQ(2u, f_idx->size());
+    auto ri = std::make_shared<regex_index>("/2|4|incomplete/");
+    f_idx->parse_all(ri);
+    ASSERT_EQ(2u, ri->matched());
+    ASSERT_EQ(lineNum_vector_t({ 2 }), ri->lineNum_vector());
+    ASSERT_EQ(file_index::file_unchanged, f_idx->follow());
+
+    append_file(fn, " line 3\nline 4\nline 5\n");
+    ASSERT_EQ(file_index::file_grew, f_idx->follow());
+    ASSERT_EQ(5u, f_idx->size());
+    ASSERT_EQ("incomplete line 3", f_idx->line(3).to_string());
+    ASSERT_EQ("line 5", f_idx->line(5).to_string());
+
+    // only the new lines are matched
+    ASSERT_EQ(lineNum_vector_t({ 3, 4 }), f_idx->match_new_lines(*ri).to_vector());
+    ASSERT_EQ(lineNum_vector_t({ 2, 3, 4 }), ri->lineNum_vector());
+    ASSERT_EQ(5u, ri->matched());
+    ASSERT_TRUE(f_idx->match_new_lines(*ri).empty());
+    ASSERT_EQ(file_index::file_unchanged, f_idx->follow());
+
+    // a truncated file has to be opened again
+    { std::ofstream os(fn, std::ios::trunc); os << "new\n"; }
+    ASSERT_EQ(file_index::file_replaced, f_idx->follow());
+}
+
+#if !defined(_WIN32)
+TEST(file_index, follow_detects_copytruncate)
+{
+    TemporaryFile tmp;
+    const std::string fn = to_utf8(tmp.filename());
+    std::string s;
+    for(unsigned i = 0; i < 20000; ++i) {
+	s += "line " + std::to_string(i) + "\n";
+    }
+    write_file(tmp, s);
+
+    auto f_idx = std::make_shared<file_index>(fn, true);
+    f_idx->index_all();
+    ASSERT_EQ(20000u, f_idx->size());
+
+    ASSERT_FALSE(f_idx->truncated());
+
+    // the truncation is noticed before the lines are read, even if the file grows beyond its old size
+    { std::ofstream os(fn, std::ios::trunc); }
+    ASSERT_TRUE(f_idx->truncated());
+    append_file(fn, s + s);
+    ASSERT_TRUE(f_idx->truncated());
+    ASSERT_EQ(file_index::file_replaced, f_idx->follow());
+}
+#endif
+
+TEST(file_index, follow_detects_rotation)
+{
+    TemporaryFile tmp;
+    const std::string fn = to_utf8(tmp.filename());
+    write_file(tmp, "");
+
+    // an empty file can be followed
+    auto f_idx = std::make_shared<file_index>(fn, true);
+    f_idx->index_all();
+    ASSERT_EQ(0u, f_idx->size());
+    append_file(fn, "first\n");
+    ASSERT_EQ(file_index::file_grew, f_idx->follow());
+    ASSERT_EQ("first", f_idx->line(1).to_string());
+
+    // a file that is not followed does not grow
+    auto unfollowed = std::make_shared<file_index>(fn);
+    unfollowed->index_all();
+    append_file(fn, "second\n");
+    ASSERT_EQ(file_index::file_unchanged, unfollowed->follow());
+    ASSERT_EQ(1u, unfollowed->size());
+
+    const std::string rotated = fn + ".1";
+    ASSERT_EQ(0, std::rename(fn.c_str(), rotated.c_str()));
+    { std::ofstream os(fn); os << "rotated\n"; }
+    ASSERT_EQ(file_index::file_replaced, f_idx->follow());
+    std::remove(rotated.c_str());
+}
+
+TEST(file_index, line_index_memory_benchmark)
+{
+    TemporaryFile tmp;
+    {
+	std::string s;
+	for(unsigned i = 0; i < 1000000; ++i) {
+	    s += "line " + std::to_string(i) + "\n";
+	}
+	write_file(tmp, s);
+    }
+
+    const size_t rss = getCurrentRSS();
+    auto f_idx = std::make_shared<file_index>(to_utf8(tmp.filename()));
+    f_idx->index_all();
+    ASSERT_EQ(1000000u, f_idx->size());
+    ASSERT_EQ(std::string("line 999999"), f_idx->line(1000000).to_string());
+
+    const uint64_t bytes = f_idx->memory_usage();
+    std::clog << "line index memory benchmark: " << f_idx->size() << " lines use " << bytes / 1024 << " KB line index ("
+	      << static_cast<double>(bytes) / f_idx->size() << " bytes per line), a vector<line_t> would use "
+	      << f_idx->size() * sizeof(line_t) / 1024 << " KB. RSS grew by " << (getCurrentRSS() - rss) / 1024 << " KB" << std::endl;
+    ASSERT_LT(bytes, f_idx->size() * sizeof(line_t) / 2);
+}
+
+TEST(file_index, parse_all_in_background_matches_with_multiple_threads)
+{
+    TemporaryFile tmp;
+    {
+	std::string s;
+	for(unsigned i = 1; i <= 300000; ++i) {
+	    s += "line " + std::to_string(i) + ((i % 7) ? " info\n" : " error\n");
+	}
+	write_file(tmp, s);
+    }
+    auto f_idx = std::make_shared<file_index>(to_utf8(tmp.filename()));
+    auto expected = std::make_shared<regex_index>("/error/");
+    f_idx->parse_all(expected);
+    ASSERT_EQ(300000u / 7u, expected->size());
+
+    for(unsigned t = 1; t <= 5; ++t) {
+	auto ri = std::make_shared<regex_index>("/error/");
+	ASSERT_TRUE(f_idx->parse_all_in_background(ri, 0, t));
+	ASSERT_EQ(expected->lineNum_vector(), ri->lineNum_vector());
+
+	auto inverted = std::make_shared<regex_index>("/error/!");
+	ASSERT_TRUE(f_idx->parse_all_in_background(inverted, 0, t));
+	ASSERT_EQ(300000u - expected->size(), inverted->size());
+    }
+
+    // remove the progress events
+    while(eventPending()) {
+	eventGet();
+    }
+}
+
+TEST(file_index, buffer_matching_is_identical_to_line_matching)
+{
+    TemporaryFile tmp;
+    write_file(tmp, "error at start\nno problem\r\n\nERROR in caps\nerror error twice\r\nthe end has an error");
+    auto f_idx = std::make_shared<file_index>(to_utf8(tmp.filename()));
+    f_idx->parse_all();
+    for(auto rgx : { "/error/", "/error/i", "/error/!", "/error/i!", "/error [a-z]+/", "/error\\b.*twice/!", "/r/", "/^$/", "/not found/" }) {
+	auto per_line = std::make_shared<regex_index>(rgx);
+	for(line_number_t num = 1; num <= f_idx->size(); ++num) {
+	    per_line->match(f_idx->line(num));
+	}
+	auto buffer = std::make_shared<regex_index>(rgx);
+	f_idx->parse_all(buffer);
+	ASSERT_EQ(per_line->lineNum_vector(), buffer->lineNum_vector()) << rgx;
+    }
+}
+
+TEST(file_index, buffer_matching_benchmark)
+{
+    TemporaryFile tmp;
+    {
+	std::string s;
+	for(unsigned i = 1; i <= 1000000; ++i) {
+	    s += "2016-02-01 12:00:00 INFO worker=" + std::to_string(i % 16) + " request " + std::to_string(i)
+		+ ((i % 1000) ? " handled\n" : " failed with a timeout\n");
+	}
+	write_file(tmp, s);
+    }
+    auto f_idx = std::make_shared<file_index>(to_utf8(tmp.filename()));
+    f_idx->parse_all();
+
+    for(auto rgx : { "/timeout/", "/with a \\w+/" }) {
+	auto start = std::chrono::steady_clock::now();
+	auto per_line = std::make_shared<regex_index>(rgx);
+	for(line_number_t num = 1; num <= f_idx->size(); ++num) {
+	    per_line->match(f_idx->line(num));
+	}
+	const auto line_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	auto buffer = std::make_shared<regex_index>(rgx);
+	f_idx->parse_all(buffer);
+	const auto buffer_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	std::clog << "buffer matching benchmark: " << rgx << " matched " << buffer->size() << " of " << f_idx->size()
+		  << " lines: line by line " << line_ms << " ms, buffer " << buffer_ms << " ms" << std::endl;
+	ASSERT_EQ(per_line->lineNum_vector(), buffer->lineNum_vector());
+    }
+}
@@ -0,0 +1,100 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "file_watcher.h"
+#include "file_identity.h"
+#include <chrono>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    /// interval in which the stop flag is checked and the file is polled.
+    const std::chrono::milliseconds poll_interval(250);
+
+#if defined(__linux__)
+    /**
+     * watch the directory of filename with inotify.
+     * @return false if inotify is not available.
+     */
+    bool watch_inotify(const std::string& filename, std::function<void()> changed, std::atomic_bool& stop)
+    {
+	std::string dir = ".", name = filename;
+	const auto slash = filename.rfind('/');
+	if (slash != std::string::npos) {
+	    dir = (slash == 0) ? "/" : filename.substr(0, slash);
+	    name = filename.substr(slash + 1);
+	}
+
+	const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0) {
+	    return false;
+	}
+	if (inotify_add_watch(fd, dir.c_str(), IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) < 0) {
+	    close(fd);
+	    return false;
+	}
+
+	while(! stop) {
+	    struct pollfd p = { fd, POLLIN, 0 };
+	    if (poll(&p, 1, poll_interval.count()) <= 0) {
+		continue;
+	    }
+	    bool found = false;
+	    alignas(struct inotify_event) char buf[4096];
+	    ssize_t len;
+	    while((len = read(fd, buf, sizeof(buf))) > 0) {
+		for(const char* ptr = buf; ptr < buf + len; ) {
+		    const struct inotify_event* e = reinterpret_cast<const struct inotify_event*>(ptr);
+		    if ((e->mask & IN_Q_OVERFLOW) || (e->len > 0 && name == e->name)) {
+			found = true;
+		    }
+		    ptr += sizeof(struct inotify_event) + e->len;
+		}
+	    }
+	    if (found) {
+		changed();
+	    }
+	}
+	close(fd);
+	return true;
+    }
+#endif
+
+    void watch(const std::string filename, std::function<void()> changed, std::atomic_bool& stop)
+    {
+#if defined(__linux__)
+	if (watch_inotify(filename, changed, stop)) {
+	    return;
+	}
+#endif
+	// poll the identity of the file
+	file_identity last;
+	get_file_identity(filename, last);
+	while(! stop) {
+	    std::this_thread::sleep_for(poll_interval);
+	    file_identity id;
+	    get_file_identity(filename, id);
+	    if (id.key() != last.key()) {
+		last = id;
+		changed();
+	    }
+	}
+    }
+}
+
+file_watcher::file_watcher(const std::string& filename, std::function<void()> changed) :
+    stop_(false),
+    thread_(watch, filename, changed, std::ref(stop_))
+{
+}
+
+file_watcher::~file_watcher()
+{
+    stop_ = true;
+    thread_.join();
+}
@@ -0,0 +1,31 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * watch a file for modifications in a background thread.
+ * On Linux the directory of the file is watched with inotify, so a rotated file is noticed
+ * when it is created again. On other platforms or if inotify is not available the file is polled.
+ */
+class file_watcher
+{
+    std::atomic_bool stop_;
+    std::thread thread_;
+
+public:
+    /**
+     * start watching a file.
+     * @param filename file name.
+     * @param changed function which is called by the background thread if the file was modified, created, moved or deleted.
+     */
+    file_watcher(const std::string& filename, std::function<void()> changed);
+
+    /// stop the background thread.
+    ~file_watcher();
+};
@@ -0,0 +1,40 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "file_watcher.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <chrono>
+#include <fstream>
+
+namespace {
+    /// @return true if flag was set within a few seconds.
+    bool wait_for(std::atomic_int& flag)
+    {
+	for(int i = 0; i < 500 && flag == 0; ++i) {
+	    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return flag > 0;
+    }
+}
+
+TEST(file_watcher, reports_appended_data)
+{
+    TemporaryFile tmp;
+    const std::string fn = to_utf8(tmp.filename());
+    ASSERT_TRUE(tmp.file() != nullptr);
+    ASSERT_TRUE(tmp.close());
+
+    std::atomic_int changed(0);
+    file_watcher w(fn, [&]() { ++changed; });
+    // give the background thread time to start watching
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(0, changed);
+    {
+	std::ofstream os(fn, std::ios::app);
+	os << "new line" << std::endl;
+    }
+    ASSERT_TRUE(wait_for(changed));
+}
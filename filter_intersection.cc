@@ -0,0 +1,103 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "filter_intersection.h"
+#include <algorithm>
+
+filter_intersection::filter_intersection() :
+    prefix_(1),
+    prefix_valid_(0),
+    suffix_(1),
+    suffix_valid_(0),
+    others_slot_(-1),
+    intersections_(0)
+{
+}
+
+filter_intersection::set_ptr
+filter_intersection::intersect(const set_ptr& a, const set_ptr& b)
+{
+    if (! a) {
+	return b;
+    }
+    if (! b) {
+	return a;
+    }
+    ++intersections_;
+    return std::make_shared<const line_bitmap>(line_bitmap::and_(*a, *b));
+}
+
+filter_intersection::set_ptr
+filter_intersection::others(const unsigned k)
+{
+    if (others_slot_ == static_cast<int>(k)) {
+	return others_;
+    }
+    for(; prefix_valid_ < k; ++prefix_valid_) {
+	prefix_[prefix_valid_ + 1] = intersect(prefix_[prefix_valid_], slot_[prefix_valid_]);
+    }
+    for(; suffix_valid_ > k + 1; --suffix_valid_) {
+	suffix_[suffix_valid_ - 1] = intersect(slot_[suffix_valid_ - 1], suffix_[suffix_valid_]);
+    }
+    others_ = intersect(prefix_[k], suffix_[k + 1]);
+    others_slot_ = k;
+    return others_;
+}
+
+void
+filter_intersection::set(const unsigned k, set_ptr lines)
+{
+    if (k >= slot_.size()) {
+	if (! lines) {
+	    return;
+	}
+	// new slots have no filter, so the existing suffixes do not change
+	slot_.resize(k + 1);
+	prefix_.resize(k + 2);
+	suffix_.resize(k + 2);
+    }
+    if (slot_[k] == lines) {
+	return;
+    }
+
+    // the intersection of the other slots does not depend on slot k
+    const set_ptr o = others(k);
+    slot_[k] = std::move(lines);
+    prefix_valid_ = std::min(prefix_valid_, k);
+    suffix_valid_ = std::max(suffix_valid_, k + 1);
+    result_ = intersect(o, slot_[k]);
+
+    // if the slots after k have no filter, every following prefix is the result
+    if (! suffix_[k + 1]) {
+	for(unsigned i = k + 1; i < prefix_.size(); ++i) {
+	    prefix_[i] = result_;
+	}
+	prefix_valid_ = prefix_.size() - 1;
+    }
+}
+
+filter_intersection::set_ptr
+filter_intersection::grow(const std::vector<set_ptr>& added)
+{
+    set_ptr r;
+    for(unsigned k = 0; k < added.size() && k < slot_.size(); ++k) {
+	if (slot_[k]) {
+	    r = intersect(r, added[k]);
+	}
+    }
+
+    // the cached intersections miss the added lines
+    prefix_valid_ = 0;
+    suffix_valid_ = slot_.size();
+    others_slot_ = -1;
+    others_ = nullptr;
+
+    // the result is the set of a slot, if only that slot has a filter. That set already grew.
+    if (r && std::find(slot_.begin(), slot_.end(), result_) == slot_.end()) {
+	auto g = std::make_shared<line_bitmap>(*result_);
+	g->append(line_bitmap(*r));
+	result_ = g;
+    }
+    return r;
+}
@@ -0,0 +1,71 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "line_bitmap.h"
+#include <memory>
+#include <vector>
+
+/**
+ * the intersection of the line sets of the filter slots.
+ *
+ * The intersection of all slots before slot i is kept in prefix_[i], the intersection of
+ * slot i and all slots after it in suffix_[i]. The intersection of all slots except slot k is
+ * therefore prefix_[k] & suffix_[k + 1], which does not change when slot k changes.
+ * Replacing, adding or removing the filter of one slot costs a single intersection,
+ * changing another slot recomputes the invalidated prefixes and suffixes.
+ */
+class filter_intersection
+{
+public:
+    /// a set of line numbers, nullptr is the set of all lines.
+    typedef std::shared_ptr<const line_bitmap> set_ptr;
+
+private:
+    std::vector<set_ptr> slot_;
+    /// prefix_[i] is the intersection of slot_[0, i), valid for i <= prefix_valid_.
+    std::vector<set_ptr> prefix_;
+    unsigned prefix_valid_;
+    /// suffix_[i] is the intersection of slot_[i, size()), valid for i >= suffix_valid_.
+    std::vector<set_ptr> suffix_;
+    unsigned suffix_valid_;
+    /// the intersection of all slots except slot others_slot_.
+    set_ptr others_;
+    int others_slot_;
+    set_ptr result_;
+    /// number of computed intersections, used for tests.
+    unsigned long long intersections_;
+
+    set_ptr intersect(const set_ptr& a, const set_ptr& b);
+
+    /// @return the intersection of all slots except slot k.
+    set_ptr others(const unsigned k);
+
+public:
+    filter_intersection();
+
+    /// @return number of slots.
+    unsigned size() const { return slot_.size(); }
+
+    /**
+     * set the line set of slot k.
+     * @param lines the matching lines of the filter; nullptr if the slot has no filter.
+     */
+    void set(const unsigned k, set_ptr lines);
+
+    /**
+     * the line sets of the slots grew by lines which are larger than all lines in the sets.
+     * Only the intersection of the added lines is computed and appended to the result.
+     * The intersections of the other slots are recomputed by the next set() call.
+     * @param added the lines that were added to the set of each slot; nullptr if the slot has no filter.
+     * @return the intersection of the added lines; nullptr if no slot has a filter.
+     */
+    set_ptr grow(const std::vector<set_ptr>& added);
+
+    /// @return the intersection of all slots; nullptr if no slot has a filter.
+    set_ptr result() const { return result_; }
+
+    /// @return number of intersections computed so far.
+    unsigned long long intersections() const { return intersections_; }
+};
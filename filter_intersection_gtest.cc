@@ -0,0 +1,142 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "filter_intersection.h"
+#include <random>
+
+namespace {
+    filter_intersection::set_ptr random_set(std::mt19937& gen)
+    {
+	std::bernoulli_distribution d(0.7);
+	auto b = std::make_shared<line_bitmap>();
+	for(line_number_t n = 1; n <= 100000; ++n) {
+	    if (d(gen)) {
+		b->add(n);
+	    }
+	}
+	return b;
+    }
+
+    /// @return intersection of all sets in v, computed from scratch.
+    lineNum_vector_t expected(const std::vector<filter_intersection::set_ptr>& v)
+    {
+	filter_intersection::set_ptr r;
+	for(auto s : v) {
+	    if (s) {
+		r = r ? std::make_shared<line_bitmap>(line_bitmap::and_(*r, *s)) : s;
+	    }
+	}
+	return r ? r->to_vector() : lineNum_vector_t();
+    }
+}
+
+TEST(filter_intersection, without_filters)
+{
+    filter_intersection f;
+    ASSERT_EQ(nullptr, f.result());
+    f.set(3, nullptr);
+    ASSERT_EQ(nullptr, f.result());
+    ASSERT_EQ(0u, f.size());
+}
+
+TEST(filter_intersection, changing_one_slot_costs_one_intersection)
+{
+    std::mt19937 gen(3);
+    std::vector<filter_intersection::set_ptr> v(5);
+    filter_intersection f;
+
+    // adding filters in order
+    for(unsigned i = 0; i < v.size(); ++i) {
+	v[i] = random_set(gen);
+	const auto n = f.intersections();
+	f.set(i, v[i]);
+	ASSERT_EQ(expected(v), f.result()->to_vector());
+	ASSERT_EQ(i == 0 ? n : n + 1, f.intersections());
+    }
+
+    // replacing a filter repeatedly
+    for(int j = 0; j < 3; ++j) {
+	v[2] = random_set(gen);
+	f.set(2, v[2]);
+	ASSERT_EQ(expected(v), f.result()->to_vector());
+    }
+    auto n = f.intersections();
+    v[2] = random_set(gen);
+    f.set(2, v[2]);
+    ASSERT_EQ(n + 1, f.intersections());
+    ASSERT_EQ(expected(v), f.result()->to_vector());
+
+    // removing the filter
+    n = f.intersections();
+    v[2] = nullptr;
+    f.set(2, nullptr);
+    ASSERT_EQ(n, f.intersections());
+    ASSERT_EQ(expected(v), f.result()->to_vector());
+
+    // setting the same set again does nothing
+    n = f.intersections();
+    f.set(1, v[1]);
+    ASSERT_EQ(n, f.intersections());
+}
+
+TEST(filter_intersection, is_identical_to_full_intersection)
+{
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<unsigned> slot(0, 7);
+    std::bernoulli_distribution remove(0.3);
+    std::vector<filter_intersection::set_ptr> v(8);
+    filter_intersection f;
+    for(int j = 0; j < 40; ++j) {
+	const unsigned k = slot(gen);
+	v[k] = remove(gen) ? nullptr : random_set(gen);
+	f.set(k, v[k]);
+	const auto r = f.result();
+	ASSERT_EQ(expected(v), r ? r->to_vector() : lineNum_vector_t()) << j;
+    }
+}
+
+TEST(filter_intersection, grow_intersects_only_the_added_lines)
+{
+    std::mt19937 gen(5);
+    std::vector<filter_intersection::set_ptr> v = { random_set(gen), nullptr, random_set(gen) };
+    filter_intersection f;
+    for(unsigned i = 0; i < v.size(); ++i) {
+	f.set(i, v[i]);
+    }
+
+    // the sets grow in place, like the sets of a followed file
+    std::vector<filter_intersection::set_ptr> added = { std::make_shared<line_bitmap>(), nullptr, std::make_shared<line_bitmap>() };
+    for(line_number_t n = 100001; n <= 100100; ++n) {
+	if (n % 2) {
+	    std::const_pointer_cast<line_bitmap>(added[0])->add(n);
+	}
+	if (n % 3) {
+	    std::const_pointer_cast<line_bitmap>(added[2])->add(n);
+	}
+    }
+    std::const_pointer_cast<line_bitmap>(v[0])->append(line_bitmap(*added[0]));
+    std::const_pointer_cast<line_bitmap>(v[2])->append(line_bitmap(*added[2]));
+
+    const auto n = f.intersections();
+    const auto r = f.grow(added);
+    ASSERT_EQ(n + 1, f.intersections());
+    ASSERT_EQ(expected(added), r->to_vector());
+    ASSERT_EQ(expected(v), f.result()->to_vector());
+
+    // the next change of a slot uses the grown sets
+    v[1] = random_set(gen);
+    f.set(1, v[1]);
+    ASSERT_EQ(expected(v), f.result()->to_vector());
+
+    // a single filter is the result, its set already grew
+    filter_intersection g;
+    g.set(0, v[0]);
+    std::const_pointer_cast<line_bitmap>(v[0])->add(200000);
+    added = { std::make_shared<line_bitmap>() };
+    std::const_pointer_cast<line_bitmap>(added[0])->add(200000);
+    g.grow(added);
+    ASSERT_EQ(v[0], g.result());
+    ASSERT_EQ(200000u, g.result()->max());
+}
@@ -0,0 +1,185 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "find_newlines.h"
+#include <cstring>
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FIND_NEWLINES_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    /**
+     * record a newline character.
+     * @param q pointer to the '\n' character.
+     * @param cr_before true if the character before q is a '\r' character.
+     * @param[in,out] line_beg first character of the current line, is advanced to the next line.
+     * @return the number of found newline characters including this one.
+     */
+    inline size_t found(const char* q, const bool cr_before, const char*& line_beg, const char** nl, const char** eol, size_t n)
+    {
+	nl[n] = q;
+	if (eol) {
+	    const char* e = q;
+	    if (cr_before) {
+		while(e > line_beg && *(e - 1) == '\r') {
+		    --e;
+		}
+	    }
+	    eol[n] = e;
+	}
+	line_beg = q + 1;
+	return n + 1;
+    }
+
+    /// scan [p, end) one character at a time. Used for the tail of the SIMD kernels.
+    inline size_t scalar_tail(const char* p, const char* end, const char* line_beg, const char** nl, const char** eol, size_t n, const size_t max)
+    {
+	for(; p < end && n < max; ++p) {
+	    if (*p == '\n') {
+		n = found(p, p > line_beg && *(p - 1) == '\r', line_beg, nl, eol, n);
+	    }
+	}
+	return n;
+    }
+
+    size_t find_newlines_memchr(const char* beg, const char* end, const char** nl, const char** eol, size_t max)
+    {
+	size_t n = 0;
+	const char* line_beg = beg;
+	while(n < max && beg < end) {
+	    const char* q = static_cast<const char*>(memchr(beg, '\n', end - beg));
+	    if (q == nullptr) {
+		break;
+	    }
+	    n = found(q, q > line_beg && *(q - 1) == '\r', line_beg, nl, eol, n);
+	    beg = q + 1;
+	}
+	return n;
+    }
+
+#if FIND_NEWLINES_X86
+    size_t find_newlines_sse2(const char* beg, const char* end, const char** nl, const char** eol, size_t max)
+    {
+	size_t n = 0;
+	const char* line_beg = beg;
+	const char* p = beg;
+	const __m128i v_nl = _mm_set1_epi8('\n');
+	const __m128i v_cr = _mm_set1_epi8('\r');
+	while(end - p >= 16) {
+	    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	    uint32_t m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, v_nl));
+	    if (m) {
+		// the '\r' mask is shifted by one, so bit i tells if the character before p[i] is a '\r'
+		uint32_t cr = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, v_cr))) << 1;
+		if (p > line_beg && *(p - 1) == '\r') {
+		    cr |= 1;
+		}
+		do {
+		    const unsigned bit = __builtin_ctz(m);
+		    n = found(p + bit, (cr >> bit) & 1, line_beg, nl, eol, n);
+		    if (n == max) {
+			return n;
+		    }
+		    m &= m - 1;
+		} while(m);
+	    }
+	    p += 16;
+	}
+	return scalar_tail(p, end, line_beg, nl, eol, n, max);
+    }
+
+    __attribute__((target("avx2")))
+    size_t find_newlines_avx2(const char* beg, const char* end, const char** nl, const char** eol, size_t max)
+    {
+	size_t n = 0;
+	const char* line_beg = beg;
+	const char* p = beg;
+	const __m256i v_nl = _mm256_set1_epi8('\n');
+	const __m256i v_cr = _mm256_set1_epi8('\r');
+	while(end - p >= 32) {
+	    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	    uint32_t m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, v_nl));
+	    if (m) {
+		// bit i+1 of the 64bit '\r' mask tells if p[i] is a '\r'
+		uint64_t cr = static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, v_cr)))) << 1;
+		if (p > line_beg && *(p - 1) == '\r') {
+		    cr |= 1;
+		}
+		do {
+		    const unsigned bit = __builtin_ctz(m);
+		    n = found(p + bit, (cr >> bit) & 1, line_beg, nl, eol, n);
+		    if (n == max) {
+			return n;
+		    }
+		    m &= m - 1;
+		} while(m);
+	    }
+	    p += 32;
+	}
+	return scalar_tail(p, end, line_beg, nl, eol, n, max);
+    }
+#endif
+
+    /// select the fastest kernel with CPUID.
+    find_newlines_f select_kernel(const char*& name)
+    {
+#if FIND_NEWLINES_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+	    name = "avx2";
+	    return find_newlines_avx2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+	    name = "sse2";
+	    return find_newlines_sse2;
+	}
+#endif
+	name = "memchr";
+	return find_newlines_memchr;
+    }
+
+    const char* kernel_name_ = nullptr;
+
+    /// @return the selected kernel.
+    find_newlines_f kernel()
+    {
+	static const find_newlines_f k = select_kernel(kernel_name_);
+	return k;
+    }
+}
+
+find_newlines_f
+find_newlines_kernel(const std::string& name)
+{
+    if (name == "memchr") {
+	return find_newlines_memchr;
+    }
+#if FIND_NEWLINES_X86
+    __builtin_cpu_init();
+    if (name == "sse2" && __builtin_cpu_supports("sse2")) {
+	return find_newlines_sse2;
+    }
+    if (name == "avx2" && __builtin_cpu_supports("avx2")) {
+	return find_newlines_avx2;
+    }
+#endif
+    return nullptr;
+}
+
+const char*
+find_newlines_kernel_name()
+{
+    kernel();
+    return kernel_name_;
+}
+
+size_t
+find_newlines(const char* beg, const char* end, const char** nl, const char** eol, size_t max)
+{
+    return kernel()(beg, end, nl, eol, max);
+}
@@ -0,0 +1,39 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * function type of a newline scanner kernel.
+ * The kernel finds the '\n' characters in [beg, end).
+ * beg has to be the first character of a line.
+ *
+ * @param beg first character to scan.
+ * @param end one past the last character to scan.
+ * @param[out] nl receives pointers to the found '\n' characters.
+ * @param[out] eol if not nullptr, receives for every found '\n' character the end of the line
+ *                 excluding any '\r' characters that directly precede the '\n' character.
+ * @param max number of entries in nl and eol.
+ * @return number of found newline characters. If the return value is equal to max, the scan stopped
+ *         at nl[max-1] and should be continued at nl[max-1] + 1.
+ */
+typedef size_t (*find_newlines_f)(const char* beg, const char* end, const char** nl, const char** eol, size_t max);
+
+/**
+ * get a newline scanner kernel by name.
+ * @param name "avx2", "sse2" or "memchr".
+ * @return kernel function; nullptr if the kernel is not available on this CPU or with this compiler.
+ */
+find_newlines_f find_newlines_kernel(const std::string& name);
+
+/// @return name of the fastest kernel the CPU supports. It is selected once with CPUID.
+const char* find_newlines_kernel_name();
+
+/**
+ * find newline characters with the fastest kernel the CPU supports.
+ * See find_newlines_f for a description of the parameters.
+ */
+size_t find_newlines(const char* beg, const char* end, const char** nl, const char** eol, size_t max);
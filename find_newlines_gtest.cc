@@ -0,0 +1,148 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "find_newlines.h"
+#include "timeGetTime.h"
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+
+namespace {
+    const char* kernels[] = { "memchr", "sse2", "avx2" };
+
+    /// reference implementation, the loop file_index used before the SIMD kernels.
+    void scalar_lines(const std::string& s, std::vector<const char*>& nl, std::vector<const char*>& eol)
+    {
+	const char* beg = s.data();
+	const char* end = s.data() + s.size();
+	const char* line_beg = beg;
+	for(const char* it = beg; it != end; ++it) {
+	    if (*it == '\n') {
+		const char* e = it;
+		while(e > line_beg && *(e - 1) == '\r') {
+		    --e;
+		}
+		nl.push_back(it);
+		eol.push_back(e);
+		line_beg = it + 1;
+	    }
+	}
+    }
+
+    /// run kernel over s with batches of max entries.
+    void kernel_lines(find_newlines_f kernel, const std::string& s, const size_t max, std::vector<const char*>& nl, std::vector<const char*>& eol)
+    {
+	std::vector<const char*> n(max), e(max);
+	const char* beg = s.data();
+	const char* end = s.data() + s.size();
+	while(true) {
+	    const size_t cnt = kernel(beg, end, n.data(), e.data(), max);
+	    nl.insert(nl.end(), n.begin(), n.begin() + cnt);
+	    eol.insert(eol.end(), e.begin(), e.begin() + cnt);
+	    if (cnt < max) {
+		break;
+	    }
+	    beg = n[cnt - 1] + 1;
+	}
+    }
+
+    /// @return a string with random characters, '\n' and '\r' characters.
+    std::string random_text(const size_t len, unsigned seed)
+    {
+	std::string s(len, ' ');
+	for(auto& c : s) {
+	    seed = seed * 1103515245u + 12345u;
+	    const unsigned r = (seed >> 16) % 16;
+	    c = (r == 0) ? '\n' : (r == 1) ? '\r' : static_cast<char>('a' + r);
+	}
+	return s;
+    }
+}
+
+TEST(find_newlines, selects_a_kernel)
+{
+    const std::string name = find_newlines_kernel_name();
+    ASSERT_TRUE(find_newlines_kernel(name) != nullptr);
+    ASSERT_TRUE(find_newlines_kernel("memchr") != nullptr);
+    ASSERT_TRUE(find_newlines_kernel("does not exist") == nullptr);
+}
+
+TEST(find_newlines, handles_empty_range)
+{
+    const char* nl[4];
+    const char* eol[4];
+    const std::string s;
+    ASSERT_EQ(0u, find_newlines(s.data(), s.data(), nl, eol, 4));
+}
+
+TEST(find_newlines, strips_carriage_return)
+{
+    const std::string s = "a\r\n\r\n\r\r\nbc\n";
+    const char* nl[8];
+    const char* eol[8];
+    ASSERT_EQ(4u, find_newlines(s.data(), s.data() + s.size(), nl, eol, 8));
+    ASSERT_EQ(s.data() + 2, nl[0]);
+    ASSERT_EQ(s.data() + 1, eol[0]);
+    ASSERT_EQ(s.data() + 4, nl[1]);
+    ASSERT_EQ(s.data() + 3, eol[1]);
+    ASSERT_EQ(s.data() + 7, nl[2]);
+    ASSERT_EQ(s.data() + 5, eol[2]);
+    ASSERT_EQ(s.data() + 10, nl[3]);
+    ASSERT_EQ(s.data() + 10, eol[3]);
+}
+
+TEST(find_newlines, kernels_match_scalar_loop)
+{
+    for(unsigned len : { 0u, 1u, 15u, 16u, 17u, 31u, 32u, 33u, 100u, 4097u }) {
+	const std::string s = random_text(len, len);
+	std::vector<const char*> expected_nl, expected_eol;
+	scalar_lines(s, expected_nl, expected_eol);
+	for(auto name : kernels) {
+	    find_newlines_f k = find_newlines_kernel(name);
+	    if (! k) {
+		continue;
+	    }
+	    for(size_t max : { 1u, 3u, 64u }) {
+		std::vector<const char*> nl, eol;
+		kernel_lines(k, s, max, nl, eol);
+		ASSERT_EQ(expected_nl, nl) << name << " len " << len << " max " << max;
+		ASSERT_EQ(expected_eol, eol) << name << " len " << len << " max " << max;
+	    }
+	}
+    }
+}
+
+TEST(find_newlines, benchmark)
+{
+    // a log file like text with lines of 40 to 140 characters
+    std::string s;
+    unsigned seed = 1;
+    while(s.size() < 32*1024*1024) {
+	seed = seed * 1103515245u + 12345u;
+	s += std::string(40 + (seed >> 16) % 100, 'x');
+	s += '\n';
+    }
+
+    uint32_t start = timeGetTime();
+    std::vector<const char*> nl, eol;
+    nl.reserve(s.size() / 40);
+    eol.reserve(s.size() / 40);
+    scalar_lines(s, nl, eol);
+    std::clog << "find_newlines benchmark: scalar loop " << (timeGetTime() - start) << " ms, " << nl.size() << " lines" << std::endl;
+    const size_t expected = nl.size();
+
+    for(auto name : kernels) {
+	find_newlines_f k = find_newlines_kernel(name);
+	if (! k) {
+	    continue;
+	}
+	nl.clear();
+	eol.clear();
+	start = timeGetTime();
+	kernel_lines(k, s, 256, nl, eol);
+	std::clog << "find_newlines benchmark: " << name << " kernel " << (timeGetTime() - start) << " ms" << std::endl;
+	ASSERT_EQ(expected, nl.size());
+    }
+}
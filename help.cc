@@ -9,13 +9,16 @@
  */
 void help()
 {
-    std::cout << "usage: few [--regex '/REGEX/flags']* [--search '/REGEX/flags'] [--tabwidth 'NUM'] [--goto 'NUM'] [-v] [--color] [-h|-?|--help] ['FILE']\n"
+    std::cout << "usage: few [--regex '/REGEX/flags']* [--search '/REGEX/flags'] [--tabwidth 'NUM'] [--goto 'NUM'] [-v] [--color] [--no-cache] [--follow] [--temp-limit 'MB'] [-h|-?|--help] ['FILE']\n"
 	      << "--regex     preset Display Regular Expression or Filter Regular Expression or Attribute Display Filter Regular Expression\n"
 	      << "--search    preset search regular expression\n"
 	      << "--tabwidth  set the width of a tab character in spaces\n"
 	      << "--goto      go to a line number\n"
 	      << " -v         increase verbosity\n"
 	      << "--color     enable color\n"
+	      << "--no-cache  do not use the index cache\n"
+	      << "--follow    show lines appended to the file, like tail -f\n"
+	      << "--temp-limit maximum size in MB of the temporary file for STDIN or a compressed file\n"
 	      << "--help      show this text\n"
 	      << "Study the man page few(1) for more details.\n"
 	;
@@ -0,0 +1,179 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "index_cache.h"
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    std::string cache_dir_;
+    uint64_t min_file_size_ = 0;
+
+    /// magic string at the beginning of each cache file.
+    const char magic[8] = { 'f', 'e', 'w', 'c', 'a', 'c', 'h', 'e' };
+    /// version of the cache file format.
+    const uint32_t version = 2;
+
+    /**
+     * header of a cache file.
+     * The header is followed by the key string padded to 8 bytes and the payload.
+     */
+    struct header_t
+    {
+	char magic_[8];
+	uint32_t version_;
+	uint32_t key_size_;
+	uint64_t payload_size_;
+    };
+
+    /// @return n rounded up to a multiple of 8.
+    uint64_t pad8(const uint64_t n)
+    {
+	return (n + 7u) & ~static_cast<uint64_t>(7u);
+    }
+
+    /// @return 64bit FNV-1a hash of s.
+    uint64_t fnv1a(const std::string& s)
+    {
+	uint64_t h = 14695981039346656037llu;
+	for(auto c : s) {
+	    h ^= static_cast<unsigned char>(c);
+	    h *= 1099511628211llu;
+	}
+	return h;
+    }
+
+    std::atomic_ullong tmp_cnt_(0);
+}
+
+void
+index_cache_setup(const std::string& dir, const uint64_t min_file_size)
+{
+    cache_dir_ = dir;
+    min_file_size_ = min_file_size;
+}
+
+bool
+index_cache_enabled(const file_identity& id)
+{
+    return !cache_dir_.empty() && id.size_ >= min_file_size_;
+}
+
+std::string
+index_cache_filename(const std::string& name, const std::string& suffix)
+{
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(fnv1a(name)));
+    return cache_dir_ + "/" + hash + suffix;
+}
+
+index_cache_file::index_cache_file(const std::string& name, const std::string& key, const std::string& suffix) :
+    map_(index_cache_filename(name, suffix)),
+    payload_(nullptr),
+    payload_size_(0)
+{
+    if (map_.empty()) {
+	return;
+    }
+    const uint64_t size = map_.size();
+    if (size < sizeof(header_t)) {
+	return;
+    }
+    header_t h;
+    memcpy(&h, map_.get(), sizeof(h));
+    if (memcmp(h.magic_, magic, sizeof(magic)) != 0 || h.version_ != version) {
+	return;
+    }
+    const uint64_t payload_offset = sizeof(header_t) + pad8(h.key_size_);
+    if (size != payload_offset + h.payload_size_) {
+	return;
+    }
+    if (h.key_size_ != key.size() || memcmp(map_.get() + sizeof(header_t), key.data(), key.size()) != 0) {
+	return;
+    }
+    payload_ = map_.get() + payload_offset;
+    payload_size_ = h.payload_size_;
+}
+
+index_cache_writer::index_cache_writer(const std::string& name, const std::string& key, const std::string& suffix, const uint64_t payload_size) :
+    filename_(index_cache_filename(name, suffix)),
+    f_(nullptr),
+    remaining_(payload_size)
+{
+    if (cache_dir_.empty() || ! create_directories(cache_dir_)) {
+	return;
+    }
+    tmp_filename_ = filename_ + ".tmp." + std::to_string(getpid()) + "." + std::to_string(tmp_cnt_.fetch_add(1));
+    f_ = fopen(tmp_filename_.c_str(), "wb");
+    if (! f_) {
+	return;
+    }
+
+    header_t h;
+    memcpy(h.magic_, magic, sizeof(magic));
+    h.version_ = version;
+    h.key_size_ = key.size();
+    h.payload_size_ = payload_size;
+    const char padding[8] = { 0 };
+    const size_t padding_size = pad8(key.size()) - key.size();
+    if (fwrite(&h, sizeof(h), 1, f_) != 1 ||
+	fwrite(key.data(), 1, key.size(), f_) != key.size() ||
+	fwrite(padding, 1, padding_size, f_) != padding_size) {
+	fclose(f_);
+	f_ = nullptr;
+    }
+}
+
+index_cache_writer::~index_cache_writer()
+{
+    if (f_) {
+	fclose(f_);
+    }
+    if (! tmp_filename_.empty()) {
+	remove(tmp_filename_.c_str());
+    }
+}
+
+bool
+index_cache_writer::write(const void* data, const uint64_t size)
+{
+    if (! f_ || size > remaining_) {
+	return false;
+    }
+    if (fwrite(data, 1, size, f_) != size) {
+	return false;
+    }
+    remaining_ -= size;
+    return true;
+}
+
+bool
+index_cache_writer::commit()
+{
+    if (! f_) {
+	return false;
+    }
+    const bool ok = fclose(f_) == 0;
+    f_ = nullptr;
+    if (! ok || remaining_ != 0) {
+	return false;
+    }
+#if defined(_WIN32)
+    // rename() does not replace existing files on Windows
+    remove(filename_.c_str());
+#endif
+    if (rename(tmp_filename_.c_str(), filename_.c_str()) != 0) {
+	return false;
+    }
+    tmp_filename_.clear();
+    return true;
+}
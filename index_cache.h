@@ -0,0 +1,100 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "memorymap.h"
+#include "file_identity.h"
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+
+/**
+ * configure the index cache.
+ * The cache is disabled until this function is called with a directory name.
+ * @param dir directory for the cache files; an empty string disables the cache.
+ * @param min_file_size indexes of files smaller than this number of bytes are not cached.
+ */
+void index_cache_setup(const std::string& dir, const uint64_t min_file_size = 1024*1024);
+
+/// @return true if the indexes of the file id should be cached.
+bool index_cache_enabled(const file_identity& id);
+
+/**
+ * @param name a string that identifies the cache file. It should contain file_identity::path_.
+ * @param suffix file name suffix, describes the type of cached data.
+ * @return the file name of a cache file.
+ */
+std::string index_cache_filename(const std::string& name, const std::string& suffix);
+
+/**
+ * a memory mapped cache file.
+ * A cache file contains a header with the key string and the payload.
+ * The payload starts at an 8 byte boundary.
+ *
+ * The file name of a cache file is derived from a name, which does not change when the
+ * cached file is modified, e.g. its path. The key identifies the version of the cached data, e.g. by
+ * the size and modification time of the file. A cache file for a new version replaces the cache file
+ * of the old version, so the cache directory does not fill up with indexes of a growing log file.
+ */
+class index_cache_file
+{
+    doj::memorymap_ptr<char> map_;
+    const char* payload_;
+    uint64_t payload_size_;
+
+public:
+    /**
+     * map the cache file for name and validate that its header matches key.
+     * Use valid() to check if a cache file for key exists.
+     */
+    index_cache_file(const std::string& name, const std::string& key, const std::string& suffix);
+
+    /// @return true if the cache file exists and its header matches the key.
+    bool valid() const { return payload_ != nullptr; }
+
+    /// @return pointer to the payload.
+    const void* data() const { return payload_; }
+
+    /// @return size of the payload in bytes.
+    uint64_t size() const { return payload_size_; }
+};
+
+/**
+ * write a cache file.
+ * The data is written to a temporary file which is renamed to the cache file name by commit(),
+ * so a concurrently running program never sees a partially written cache file.
+ */
+class index_cache_writer
+{
+    std::string filename_;
+    std::string tmp_filename_;
+    FILE* f_;
+    /// number of payload bytes still to be written.
+    uint64_t remaining_;
+
+public:
+    /**
+     * create the temporary file and write the header.
+     * @param name a string that identifies the cache file, see index_cache_filename().
+     * @param key a string that identifies the cached data.
+     * @param suffix file name suffix.
+     * @param payload_size number of payload bytes that will be written.
+     */
+    index_cache_writer(const std::string& name, const std::string& key, const std::string& suffix, const uint64_t payload_size);
+    /// remove the temporary file if commit() was not successful.
+    ~index_cache_writer();
+
+    /// write payload data.
+    bool write(const void* data, const uint64_t size);
+
+    /**
+     * finish the cache file, it replaces the cache file of the same name.
+     * @return true if the complete payload was written and the cache file was created.
+     */
+    bool commit();
+
+private:
+    index_cache_writer(const index_cache_writer&);
+    index_cache_writer& operator=(const index_cache_writer&);
+};
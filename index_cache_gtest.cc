@@ -0,0 +1,316 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "index_cache.h"
+#include "file_index.h"
+#include "seek_index.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace {
+    /// use a temporary cache directory for a test and disable the cache afterwards.
+    class temporary_cache
+    {
+	TemporaryFile tmp_;
+	std::string dir_;
+	std::vector<std::string> files_;
+
+    public:
+	temporary_cache(const uint64_t min_file_size = 0) :
+	    dir_(to_utf8(tmp_.filename()) + ".cache")
+	{
+	    index_cache_setup(dir_, min_file_size);
+	}
+
+	~temporary_cache()
+	{
+	    for(auto& fn : files_) {
+		remove(fn.c_str());
+	    }
+	    remove(dir_.c_str());
+	    index_cache_setup("");
+	}
+
+	/// remember the cache file for name and suffix to remove it later.
+	std::string file(const std::string& name, const std::string& suffix)
+	{
+	    files_.push_back(index_cache_filename(name, suffix));
+	    return files_.back();
+	}
+    };
+
+    bool write_cache(const std::string& key, const std::string& payload)
+    {
+	index_cache_writer w("name", key, ".test", payload.size());
+	return w.write(payload.data(), payload.size()) && w.commit();
+    }
+
+    void write_file(TemporaryFile& tmp, const std::string& s)
+    {
+	FILE *f = tmp.file();
+	ASSERT_TRUE(f != nullptr);
+	ASSERT_EQ(s.size(), fwrite(s.data(), 1, s.size(), f));
+	ASSERT_TRUE(tmp.close());
+    }
+}
+
+TEST(index_cache, is_disabled_without_directory)
+{
+    index_cache_setup("");
+    file_identity id;
+    id.size_ = 1llu << 40;
+    ASSERT_FALSE(index_cache_enabled(id));
+}
+
+TEST(index_cache, can_write_and_read_payload)
+{
+    temporary_cache c;
+    c.file("name", ".test");
+    ASSERT_TRUE(write_cache("key", "payload data"));
+
+    index_cache_file f("name", "key", ".test");
+    ASSERT_TRUE(f.valid());
+    ASSERT_EQ(12u, f.size());
+    ASSERT_EQ(0, memcmp("payload data", f.data(), 12));
+    // the payload is aligned for 64bit access
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(f.data()) % 8);
+}
+
+TEST(index_cache, ignores_file_with_different_key)
+{
+    temporary_cache c;
+    c.file("name", ".test");
+    ASSERT_TRUE(write_cache("key", "payload"));
+    ASSERT_FALSE(index_cache_file("name", "other key", ".test").valid());
+    ASSERT_FALSE(index_cache_file("name", "key", ".other").valid());
+}
+
+TEST(index_cache, replaces_file_of_the_same_name)
+{
+    temporary_cache c;
+    c.file("name", ".test");
+    ASSERT_TRUE(write_cache("old key", "old payload"));
+    ASSERT_TRUE(write_cache("new key", "new payload"));
+    ASSERT_FALSE(index_cache_file("name", "old key", ".test").valid());
+    index_cache_file f("name", "new key", ".test");
+    ASSERT_TRUE(f.valid());
+    ASSERT_EQ(0, memcmp("new payload", f.data(), 11));
+}
+
+TEST(index_cache, ignores_truncated_file)
+{
+    temporary_cache c;
+    const std::string fn = c.file("name", ".test");
+    ASSERT_TRUE(write_cache("key", "payload"));
+
+    std::string data;
+    {
+	doj::memorymap_ptr<char> m(fn);
+	ASSERT_FALSE(m.empty());
+	data.assign(m.get(), m.size() - 1);
+    }
+    FILE *f = fopen(fn.c_str(), "wb");
+    ASSERT_TRUE(f != nullptr);
+    ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), f));
+    fclose(f);
+
+    ASSERT_FALSE(index_cache_file("name", "key", ".test").valid());
+}
+
+TEST(index_cache, writer_needs_complete_payload)
+{
+    temporary_cache c;
+    c.file("name", ".test");
+    index_cache_writer w("name", "key", ".test", 10);
+    ASSERT_TRUE(w.write("12345", 5));
+    ASSERT_FALSE(w.commit());
+    ASSERT_FALSE(index_cache_file("name", "key", ".test").valid());
+}
+
+TEST(index_cache, file_index_uses_cached_line_index)
+{
+    TemporaryFile tmp;
+    write_file(tmp, "first line\nsecond line\r\nthird line");
+    const std::string filename = to_utf8(tmp.filename());
+
+    temporary_cache c;
+    {
+	auto f_idx = std::make_shared<file_index>(filename);
+	ASSERT_FALSE(f_idx->loaded_from_cache());
+	c.file("few line index\n" + f_idx->identity().path_, ".lines");
+	f_idx->index_all();
+	ASSERT_EQ(3u, f_idx->size());
+    }
+
+    auto f_idx = std::make_shared<file_index>(filename);
+    ASSERT_TRUE(f_idx->loaded_from_cache());
+    ASSERT_EQ(3u, f_idx->size());
+    ASSERT_EQ(std::string("first line"), f_idx->line(1).to_string());
+    ASSERT_EQ(std::string("second line"), f_idx->line(2).to_string());
+    ASSERT_EQ(std::string("third line"), f_idx->line(3).to_string());
+    ASSERT_TRUE(f_idx->line(3).next_ == nullptr);
+}
+
+TEST(index_cache, file_index_ignores_cache_of_modified_file)
+{
+    TemporaryFile tmp;
+    write_file(tmp, "first line\nsecond line\n");
+    const std::string filename = to_utf8(tmp.filename());
+
+    temporary_cache c;
+    std::string old_key;
+    {
+	auto f_idx = std::make_shared<file_index>(filename);
+	c.file("few line index\n" + f_idx->identity().path_, ".lines");
+	old_key = "few line index\n" + f_idx->identity().key();
+	f_idx->index_all();
+    }
+
+    // the size of the file changes, so does its identity
+    FILE *f = fopen(filename.c_str(), "ab");
+    ASSERT_TRUE(f != nullptr);
+    fputs("third line\n", f);
+    fclose(f);
+
+    auto f_idx = std::make_shared<file_index>(filename);
+    ASSERT_FALSE(f_idx->loaded_from_cache());
+    f_idx->index_all();
+    ASSERT_EQ(3u, f_idx->size());
+    // the line index of the new version replaced the old one
+    const std::string name = "few line index\n" + f_idx->identity().path_;
+    ASSERT_FALSE(index_cache_file(name, old_key, ".lines").valid());
+    ASSERT_TRUE(index_cache_file(name, "few line index\n" + f_idx->identity().key(), ".lines").valid());
+}
+
+TEST(index_cache, file_index_ignores_corrupted_line_index)
+{
+    TemporaryFile tmp;
+    write_file(tmp, "first line\nsecond line\nthird line\n");
+    const std::string filename = to_utf8(tmp.filename());
+
+    temporary_cache c;
+    file_identity id;
+    ASSERT_TRUE(get_file_identity(filename, id));
+    const std::string name = "few line index\n" + id.path_;
+    c.file(name, ".lines");
+    // the offsets cover the file, but they are not ascending
+    const uint64_t offsets[] = { 0, 23, 11, 34 };
+    {
+	index_cache_writer w(name, "few line index\n" + id.key(), ".lines", sizeof(offsets));
+	ASSERT_TRUE(w.write(offsets, sizeof(offsets)));
+	ASSERT_TRUE(w.commit());
+    }
+
+    auto f_idx = std::make_shared<file_index>(filename);
+    ASSERT_FALSE(f_idx->loaded_from_cache());
+    f_idx->index_all();
+    ASSERT_EQ(3u, f_idx->size());
+    ASSERT_EQ(std::string("second line"), f_idx->line(2).to_string());
+}
+
+TEST(index_cache, does_not_cache_small_files)
+{
+    TemporaryFile tmp;
+    write_file(tmp, "first line\nsecond line\n");
+    const std::string filename = to_utf8(tmp.filename());
+
+    temporary_cache c(1024);
+    {
+	auto f_idx = std::make_shared<file_index>(filename);
+	c.file("few line index\n" + f_idx->identity().path_, ".lines");
+	f_idx->index_all();
+    }
+    ASSERT_FALSE(std::make_shared<file_index>(filename)->loaded_from_cache());
+}
+
+TEST(index_cache, file_index_uses_cached_regex_index)
+{
+    TemporaryFile tmp;
+    write_file(tmp, "apple\nbanana\ncherry\napricot\n");
+    const std::string filename = to_utf8(tmp.filename());
+
+    temporary_cache c;
+    {
+	auto f_idx = std::make_shared<file_index>(filename);
+	auto ri = std::make_shared<regex_index>("/^a/");
+	c.file("few line index\n" + f_idx->identity().path_, ".lines");
+	c.file(ri->cache_name(f_idx->identity()), ".regex");
+	c.file(regex_index("/^a/!").cache_name(f_idx->identity()), ".regex");
+	ASSERT_FALSE(f_idx->load_cache(*ri));
+	f_idx->parse_all(ri);
+	ASSERT_EQ(2u, ri->size());
+    }
+
+    auto f_idx = std::make_shared<file_index>(filename);
+    auto ri = std::make_shared<regex_index>("/^a/");
+    ASSERT_TRUE(f_idx->load_cache(*ri));
+    const lineNum_vector_t expected = { 1, 4 };
+    ASSERT_EQ(expected, ri->lineNum_vector());
+
+    // the flags are part of the key
+    auto inverted = std::make_shared<regex_index>("/^a/!");
+    ASSERT_FALSE(f_idx->load_cache(*inverted));
+}
+
+TEST(index_cache, regex_index_of_another_engine_is_not_used)
+{
+    TemporaryFile tmp;
+    write_file(tmp, "apple\nbanana\n");
+    const std::string filename = to_utf8(tmp.filename());
+
+    temporary_cache c;
+    auto f_idx = std::make_shared<file_index>(filename);
+    c.file("few line index\n" + f_idx->identity().path_, ".lines");
+    for(auto& e : regex_engine_names()) {
+	regex_index ri("/A/i", e.c_str());
+	c.file(ri.cache_name(f_idx->identity()), ".regex");
+	ASSERT_NE(std::string::npos, ri.cache_name(f_idx->identity()).find(e + " bytes icase\n"));
+    }
+    auto ri = std::make_shared<regex_index>("/A/i", "std");
+    f_idx->parse_all(ri);
+    ASSERT_EQ(2u, ri->size());
+
+    for(auto& e : regex_engine_names()) {
+	regex_index other("/A/i", e.c_str());
+	ASSERT_EQ(e == "std", f_idx->load_cache(other)) << e;
+    }
+    // a regular expression without the icase flag has its own key
+    regex_index cased("/A/", "std");
+    ASSERT_EQ(std::string::npos, cased.cache_name(f_idx->identity()).find("icase"));
+    ASSERT_FALSE(f_idx->load_cache(cased));
+}
+
+TEST(index_cache, caches_seek_index_of_compressed_file)
+{
+    TemporaryFile tmp;
+    write_file(tmp, "compressed data");
+    const std::string filename = to_utf8(tmp.filename());
+    file_identity id;
+    ASSERT_TRUE(get_file_identity(filename, id));
+
+    temporary_cache c;
+    c.file("few seek index\n" + id.path_, ".seek");
+    seek_index index(compression_gzip);
+    ASSERT_FALSE(index.load_cache(id));
+    seek_point p;
+    index.add(std::move(p));
+    // an incomplete index is not cached
+    index.save_cache(id);
+    ASSERT_FALSE(seek_index(compression_gzip).load_cache(id));
+    index.finish(100);
+    index.save_cache(id);
+
+    seek_index cached(compression_gzip);
+    ASSERT_TRUE(cached.load_cache(id));
+    ASSERT_EQ(100u, cached.size());
+    ASSERT_EQ(1u, cached.windows());
+
+    // the index of a modified file is not used
+    id.size_ += 1;
+    ASSERT_FALSE(seek_index(compression_gzip).load_cache(id));
+}
@@ -27,6 +27,13 @@
 #pragma once
 #include <algorithm>
 #include <vector>
+#include <iterator>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define INTERSECT_SSE2 1
+#include <emmintrin.h>
+#endif
 
 template <typename PairIter, typename OutputIter>
 unsigned long long multiple_set_intersect(PairIter pair_begin, PairIter pair_end, OutputIter out)
@@ -88,3 +95,165 @@ unsigned long long multiple_set_intersect(PairIter pair_begin, PairIter pair_end
 
     return cnt;
 }
+
+namespace intersect_detail {
+
+    /**
+     * galloping search: find the first element >= x in [first, last).
+     * The distance to the found element is probed with exponentially growing steps,
+     * so finding an element close to first is cheap even in a large set.
+     */
+    template <typename Iter, typename T>
+    Iter gallop(Iter first, Iter last, const T& x)
+    {
+	typename std::iterator_traits<Iter>::difference_type step = 1, len = last - first;
+	Iter lo = first;
+	while(step < len && *(first + step) < x) {
+	    lo = first + step + 1;
+	    step *= 2;
+	}
+	Iter hi = (step < len) ? first + step + 1 : last;
+	return std::lower_bound(lo, hi, x);
+    }
+
+    /// merge two sorted ranges of similar size.
+    template <typename Iter1, typename Iter2, typename OutputIter>
+    unsigned long long merge(Iter1 a, Iter1 a_end, Iter2 b, Iter2 b_end, OutputIter& out)
+    {
+	unsigned long long cnt = 0;
+	while(a != a_end && b != b_end) {
+	    if (*a < *b) {
+		++a;
+	    } else if (*b < *a) {
+		++b;
+	    } else {
+		*out = *a;
+		++out;
+		++cnt;
+		++a;
+		++b;
+	    }
+	}
+	return cnt;
+    }
+
+#if INTERSECT_SSE2
+    /**
+     * intersect two sorted arrays of 32bit integers with an SSE2 block compare kernel.
+     * Each block of 4 elements of a is compared with all rotations of a block of 4 elements of b.
+     * @return number of elements written to out.
+     */
+    inline unsigned long long merge_u32(const uint32_t* a, const uint32_t* const a_end, const uint32_t* b, const uint32_t* const b_end, uint32_t* out)
+    {
+	uint32_t* const out_begin = out;
+	while(a + 4 <= a_end && b + 4 <= b_end) {
+	    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+	    const __m128i vb0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+	    const __m128i vb1 = _mm_shuffle_epi32(vb0, _MM_SHUFFLE(0, 3, 2, 1));
+	    const __m128i vb2 = _mm_shuffle_epi32(vb0, _MM_SHUFFLE(1, 0, 3, 2));
+	    const __m128i vb3 = _mm_shuffle_epi32(vb0, _MM_SHUFFLE(2, 1, 0, 3));
+	    const __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(va, vb0), _mm_cmpeq_epi32(va, vb1)),
+					    _mm_or_si128(_mm_cmpeq_epi32(va, vb2), _mm_cmpeq_epi32(va, vb3)));
+	    const int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+	    for(int i = 0; i < 4; ++i) {
+		if (mask & (1 << i)) {
+		    *out++ = a[i];
+		}
+	    }
+	    const uint32_t a_max = a[3], b_max = b[3];
+	    if (a_max <= b_max) {
+		a += 4;
+	    }
+	    if (b_max <= a_max) {
+		b += 4;
+	    }
+	}
+	uint32_t* p = out;
+	return (out - out_begin) + merge(a, a_end, b, b_end, p);
+    }
+
+    /// use the SSE2 kernel for vectors of 32bit integers.
+    template <typename OutputIter>
+    unsigned long long merge(std::vector<uint32_t>::const_iterator a, std::vector<uint32_t>::const_iterator a_end,
+			     std::vector<uint32_t>::const_iterator b, std::vector<uint32_t>::const_iterator b_end, OutputIter& out)
+    {
+	std::vector<uint32_t> tmp(std::min(a_end - a, b_end - b));
+	if (tmp.empty()) {
+	    return 0;
+	}
+	const unsigned long long cnt = merge_u32(&*a, &*a + (a_end - a), &*b, &*b + (b_end - b), tmp.data());
+	for(unsigned long long i = 0; i < cnt; ++i) {
+	    *out = tmp[i];
+	    ++out;
+	}
+	return cnt;
+    }
+#endif
+}
+
+/**
+ * intersect sorted sets, adapting the algorithm to the sizes of the sets.
+ * The sets are sorted by size and the smallest set drives the intersection. The next element of
+ * the other sets is found with a galloping search, so a small set is intersected with a huge set
+ * in O(small * log(huge)) time. Two sets of similar size are merged, for vectors of 32bit integers
+ * with an SSE2 kernel.
+ *
+ * @param pair_begin, pair_end range of pairs of random access iterators, each pair describes a sorted set.
+ * @param out output iterator which receives the elements of the intersection in ascending order.
+ * @return number of elements in the intersection.
+ */
+template <typename PairIter, typename OutputIter>
+unsigned long long adaptive_set_intersect(PairIter pair_begin, PairIter pair_end, OutputIter out)
+{
+    typedef typename std::iterator_traits<PairIter>::value_type pair_t;
+    std::vector<pair_t> sets(pair_begin, pair_end);
+    if (sets.empty()) {
+	return 0;
+    }
+    std::sort(sets.begin(), sets.end(), [](const pair_t& a, const pair_t& b) {
+	    return (a.second - a.first) < (b.second - b.first);
+	});
+
+    unsigned long long cnt = 0;
+    if (sets.size() == 1) {
+	for(auto i = sets[0].first; i != sets[0].second; ++i) {
+	    *out = *i;
+	    ++out;
+	    ++cnt;
+	}
+	return cnt;
+    }
+
+    // merge two sets of similar size
+    const auto small_size = sets[0].second - sets[0].first;
+    if (sets.size() == 2 && (sets[1].second - sets[1].first) / 32 <= small_size) {
+	return intersect_detail::merge(sets[0].first, sets[0].second, sets[1].first, sets[1].second, out);
+    }
+
+    // the smallest set drives the intersection
+    auto i = sets[0].first;
+    const auto i_end = sets[0].second;
+    while(i != i_end) {
+	bool all_equal = true;
+	for(size_t s = 1; s < sets.size(); ++s) {
+	    auto& p = sets[s].first;
+	    p = intersect_detail::gallop(p, sets[s].second, *i);
+	    if (p == sets[s].second) {
+		return cnt;
+	    }
+	    if (*i < *p) {
+		// skip all elements of the smallest set that are smaller than *p
+		i = intersect_detail::gallop(i, i_end, *p);
+		all_equal = false;
+		break;
+	    }
+	}
+	if (all_equal) {
+	    *out = *i;
+	    ++out;
+	    ++cnt;
+	    ++i;
+	}
+    }
+    return cnt;
+}
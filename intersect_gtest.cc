@@ -150,3 +150,104 @@ namespace multiple_set_intersect_test2 {
 	ASSERT_EQ(std::string("3"), *(out.begin()));
     }
 }
+
+#include <chrono>
+#include <random>
+#include <stdint.h>
+namespace adaptive_set_intersect_test {
+    typedef std::vector<uint32_t> container_t;
+    typedef std::pair<container_t::const_iterator, container_t::const_iterator> pair_t;
+
+    /// @return a sorted set of num random elements in [0, max).
+    container_t random_set(std::mt19937& rnd, const uint32_t num, const uint32_t max)
+    {
+	std::uniform_int_distribution<uint32_t> dist(0, max - 1);
+	container_t c;
+	for(uint32_t i = 0; i < num; ++i) {
+	    c.push_back(dist(rnd));
+	}
+	std::sort(c.begin(), c.end());
+	c.erase(std::unique(c.begin(), c.end()), c.end());
+	return c;
+    }
+
+    container_t reference(const std::vector<container_t>& sets)
+    {
+	std::vector<pair_t> v;
+	for(auto& s : sets) {
+	    v.push_back(std::make_pair(s.begin(), s.end()));
+	}
+	container_t out;
+	multiple_set_intersect(v.begin(), v.end(), std::back_insert_iterator<container_t>(out));
+	return out;
+    }
+
+    container_t adaptive(const std::vector<container_t>& sets)
+    {
+	std::vector<pair_t> v;
+	for(auto& s : sets) {
+	    v.push_back(std::make_pair(s.begin(), s.end()));
+	}
+	container_t out;
+	const auto cnt = adaptive_set_intersect(v.begin(), v.end(), std::back_insert_iterator<container_t>(out));
+	EXPECT_EQ(out.size(), cnt);
+	return out;
+    }
+
+    TEST(adaptive_set_intersect, is_identical_to_multiple_set_intersect)
+    {
+	std::mt19937 rnd(42);
+	const std::vector<std::vector<uint32_t>> sizes = {
+	    { }, { 0 }, { 10 }, { 0, 100 }, { 3, 5 }, { 100, 100 }, { 1000, 1200 }, { 5, 10000 },
+	    { 1000, 100000 }, { 50, 2000, 3000 }, { 2000, 2000, 2000, 2000 }, { 100000, 10, 5000 },
+	};
+	for(auto& sz : sizes) {
+	    for(uint32_t max : { 20u, 5000u, 1000000u }) {
+		std::vector<container_t> sets;
+		for(auto n : sz) {
+		    sets.push_back(random_set(rnd, n, max));
+		}
+		ASSERT_EQ(reference(sets), adaptive(sets));
+	    }
+	}
+    }
+
+    TEST(adaptive_set_intersect, works_with_other_types)
+    {
+	std::vector<int> a = { 1, 2, 3, 11, 555 }, b = { 3, 6, 10, 11 }, c = { 0, 3, 11, 20 };
+	typedef std::pair<std::vector<int>::iterator, std::vector<int>::iterator> p_t;
+	std::vector<p_t> v = { std::make_pair(a.begin(), a.end()), std::make_pair(b.begin(), b.end()), std::make_pair(c.begin(), c.end()) };
+	std::vector<int> out;
+	ASSERT_EQ(2u, adaptive_set_intersect(v.begin(), v.end(), std::back_insert_iterator<std::vector<int>>(out)));
+	const std::vector<int> expected = { 3, 11 };
+	ASSERT_EQ(expected, out);
+    }
+
+    TEST(adaptive_set_intersect, benchmark)
+    {
+	std::mt19937 rnd(1);
+	container_t big(20000000);
+	for(uint32_t i = 0; i < big.size(); ++i) {
+	    big[i] = i * 2;
+	}
+	const std::vector<std::vector<container_t>> cases = {
+	    { big, random_set(rnd, 200, 40000000) },
+	    { random_set(rnd, 2000000, 8000000), random_set(rnd, 2000000, 8000000) },
+	    { big, random_set(rnd, 1000000, 40000000), random_set(rnd, 5000, 40000000) },
+	};
+	for(auto& sets : cases) {
+	    auto start = std::chrono::steady_clock::now();
+	    const container_t r = reference(sets);
+	    const auto ref_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	    start = std::chrono::steady_clock::now();
+	    const container_t a = adaptive(sets);
+	    const auto adaptive_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	    std::clog << "set intersection benchmark:";
+	    for(auto& s : sets) {
+		std::clog << " " << s.size();
+	    }
+	    std::clog << " elements: multiple_set_intersect " << ref_ms << " ms, adaptive_set_intersect " << adaptive_ms << " ms" << std::endl;
+	    ASSERT_EQ(r, a);
+	}
+    }
+}
@@ -0,0 +1,972 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "line_bitmap.h"
+#include "intersect.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+namespace {
+    typedef line_bitmap::container container;
+    const uint32_t words = line_bitmap::bitmap_words;
+    /// position returned by next_set() and next_clear() if no bit was found.
+    const uint32_t no_bit = 65536;
+
+    inline unsigned popcount(uint64_t w)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(w);
+#else
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (w * 0x0101010101010101ULL) >> 56;
+#endif
+    }
+
+    /// @return index of the lowest set bit, w must not be 0.
+    inline unsigned ctz(const uint64_t w)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(w);
+#else
+	unsigned n = 0;
+	while(((w >> n) & 1) == 0) {
+	    ++n;
+	}
+	return n;
+#endif
+    }
+
+    /// @return index of the highest set bit, w must not be 0.
+    inline unsigned msb(const uint64_t w)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+	return 63 - __builtin_clzll(w);
+#else
+	unsigned n = 63;
+	while(((w >> n) & 1) == 0) {
+	    --n;
+	}
+	return n;
+#endif
+    }
+
+    uint32_t count_bits(const uint64_t* w)
+    {
+	uint32_t n = 0;
+	for(uint32_t i = 0; i < words; ++i) {
+	    n += popcount(w[i]);
+	}
+	return n;
+    }
+
+    /// @return number of runs of consecutive set bits in w.
+    uint32_t count_runs(const uint64_t* w)
+    {
+	uint32_t n = 0;
+	uint64_t carry = 0;
+	for(uint32_t i = 0; i < words; ++i) {
+	    // a run starts at a set bit whose lower neighbor is not set
+	    n += popcount(w[i] & ~((w[i] << 1) | carry));
+	    carry = w[i] >> 63;
+	}
+	return n;
+    }
+
+    /// @return position of the first set bit at or after pos; no_bit if there is none.
+    uint32_t next_set(const uint64_t* w, const uint32_t pos)
+    {
+	if (pos >= no_bit) {
+	    return no_bit;
+	}
+	uint32_t i = pos / 64;
+	uint64_t m = w[i] & (~uint64_t(0) << (pos % 64));
+	while(m == 0) {
+	    if (++i == words) {
+		return no_bit;
+	    }
+	    m = w[i];
+	}
+	return i * 64 + ctz(m);
+    }
+
+    /// @return position of the first clear bit at or after pos; no_bit if there is none.
+    uint32_t next_clear(const uint64_t* w, const uint32_t pos)
+    {
+	if (pos >= no_bit) {
+	    return no_bit;
+	}
+	uint32_t i = pos / 64;
+	uint64_t m = ~w[i] & (~uint64_t(0) << (pos % 64));
+	while(m == 0) {
+	    if (++i == words) {
+		return no_bit;
+	    }
+	    m = ~w[i];
+	}
+	return i * 64 + ctz(m);
+    }
+
+    /// set the bits [lo, hi] in w.
+    void set_range(uint64_t* w, const uint32_t lo, const uint32_t hi)
+    {
+	assert(lo <= hi);
+	const uint32_t first = lo / 64, last = hi / 64;
+	const uint64_t first_mask = ~uint64_t(0) << (lo % 64);
+	const uint64_t last_mask = ~uint64_t(0) >> (63 - hi % 64);
+	if (first == last) {
+	    w[first] |= first_mask & last_mask;
+	    return;
+	}
+	w[first] |= first_mask;
+	for(uint32_t i = first + 1; i < last; ++i) {
+	    w[i] = ~uint64_t(0);
+	}
+	w[last] |= last_mask;
+    }
+
+    /// @return the words of c; if c is not a bitmap container they are stored in buf.
+    const uint64_t* words_of(const container& c, uint64_t* buf)
+    {
+	if (c.type_ == line_bitmap::bitmap_type) {
+	    return c.words_.data();
+	}
+	std::fill(buf, buf + words, 0);
+	c.to_words(buf);
+	return buf;
+    }
+
+    /// @return the type that uses the least memory for card numbers in runs runs.
+    line_bitmap::type_t best_type(const uint32_t card, const uint32_t runs)
+    {
+	const uint64_t run_bytes = 4 * uint64_t(runs);
+	const uint64_t array_bytes = (card <= line_bitmap::max_array_size) ? 2 * uint64_t(card) : UINT64_MAX;
+	const uint64_t bitmap_bytes = words * sizeof(uint64_t);
+	if (run_bytes < array_bytes && run_bytes < bitmap_bytes) {
+	    return line_bitmap::run_type;
+	}
+	return (array_bytes <= bitmap_bytes) ? line_bitmap::array_type : line_bitmap::bitmap_type;
+    }
+
+    /// @return a container with the bits of w in the representation that uses the least memory.
+    container from_words(const line_number_t key, const uint64_t* w)
+    {
+	container c(key, line_bitmap::array_type);
+	c.assign_words(w, best_type(count_bits(w), count_runs(w)));
+	return c;
+    }
+
+    container and_container(const container& x, const container& y)
+    {
+	if (x.type_ == line_bitmap::array_type || y.type_ == line_bitmap::array_type) {
+	    const container& a = (x.type_ == line_bitmap::array_type) ? x : y;
+	    const container& o = (x.type_ == line_bitmap::array_type) ? y : x;
+	    container r(x.key_, line_bitmap::array_type);
+	    if (o.type_ == line_bitmap::array_type) {
+		// gallop through the larger array if the sizes differ a lot
+		typedef std::vector<uint16_t>::const_iterator iter_t;
+		const std::pair<iter_t, iter_t> sets[] = { { a.data_.begin(), a.data_.end() }, { o.data_.begin(), o.data_.end() } };
+		r.data_.reserve(std::min(a.data_.size(), o.data_.size()));
+		adaptive_set_intersect(std::begin(sets), std::end(sets), std::back_inserter(r.data_));
+	    } else {
+		for(auto d : a.data_) {
+		    if (o.contains(d)) {
+			r.data_.push_back(d);
+		    }
+		}
+	    }
+	    r.card_ = r.data_.size();
+	    return r;
+	}
+	uint64_t bx[words], by[words];
+	const uint64_t* wx = words_of(x, bx);
+	const uint64_t* wy = words_of(y, by);
+	for(uint32_t i = 0; i < words; ++i) {
+	    bx[i] = wx[i] & wy[i];
+	}
+	return from_words(x.key_, bx);
+    }
+
+    /// @return x without the numbers of y.
+    container and_not_container(const container& x, const container& y)
+    {
+	if (x.type_ == line_bitmap::array_type) {
+	    container r(x.key_, line_bitmap::array_type);
+	    if (y.type_ == line_bitmap::array_type) {
+		std::set_difference(x.data_.begin(), x.data_.end(), y.data_.begin(), y.data_.end(), std::back_inserter(r.data_));
+	    } else {
+		for(auto d : x.data_) {
+		    if (! y.contains(d)) {
+			r.data_.push_back(d);
+		    }
+		}
+	    }
+	    r.card_ = r.data_.size();
+	    return r;
+	}
+	uint64_t bx[words], by[words];
+	const uint64_t* wx = words_of(x, bx);
+	const uint64_t* wy = words_of(y, by);
+	for(uint32_t i = 0; i < words; ++i) {
+	    bx[i] = wx[i] & ~wy[i];
+	}
+	return from_words(x.key_, bx);
+    }
+
+    container or_container(const container& x, const container& y)
+    {
+	if (x.type_ == line_bitmap::array_type && y.type_ == line_bitmap::array_type && x.card_ + y.card_ <= line_bitmap::max_array_size) {
+	    container r(x.key_, line_bitmap::array_type);
+	    std::set_union(x.data_.begin(), x.data_.end(), y.data_.begin(), y.data_.end(), std::back_inserter(r.data_));
+	    r.card_ = r.data_.size();
+	    return r;
+	}
+	uint64_t bx[words];
+	const uint64_t* wx = words_of(x, bx);
+	if (wx != bx) {
+	    std::copy(wx, wx + words, bx);
+	}
+	y.to_words(bx);
+	return from_words(x.key_, bx);
+    }
+
+    /// header of a serialized container, followed by n elements of data_ or words_, padded to 8 bytes.
+    struct serialized_container
+    {
+	uint64_t key;
+	uint32_t type;
+	uint32_t card;
+	uint64_t n;
+    };
+
+    inline uint64_t padded(const uint64_t bytes) { return (bytes + 7) & ~uint64_t(7); }
+
+    /// @return number of runs of the run container c which start at or before low.
+    size_t runs_before(const container& c, const uint16_t low)
+    {
+	size_t lo = 0, hi = c.data_.size() / 2;
+	while(lo < hi) {
+	    const size_t mid = (lo + hi) / 2;
+	    if (c.data_[2 * mid] <= low) {
+		lo = mid + 1;
+	    } else {
+		hi = mid;
+	    }
+	}
+	return lo;
+    }
+
+    /// @return the last number of run i of the run container c.
+    inline uint32_t run_end(const container& c, const size_t i) { return uint32_t(c.data_[2 * i]) + c.data_[2 * i + 1]; }
+}
+
+bool
+line_bitmap::container::contains(const uint16_t low) const
+{
+    switch(type_) {
+    case array_type:
+	return std::binary_search(data_.begin(), data_.end(), low);
+    case bitmap_type:
+	return (words_[low / 64] >> (low % 64)) & 1;
+    case run_type:
+	break;
+    }
+    const size_t r = runs_before(*this, low);
+    return r > 0 && low <= run_end(*this, r - 1);
+}
+
+uint32_t
+line_bitmap::container::rank(const uint16_t low) const
+{
+    switch(type_) {
+    case array_type:
+	return std::upper_bound(data_.begin(), data_.end(), low) - data_.begin();
+    case bitmap_type:
+	{
+	    uint32_t n = 0;
+	    for(uint32_t i = 0; i < low / 64u; ++i) {
+		n += popcount(words_[i]);
+	    }
+	    return n + popcount(words_[low / 64] & (~uint64_t(0) >> (63 - low % 64)));
+	}
+    case run_type:
+	break;
+    }
+    const size_t r = runs_before(*this, low);
+    uint32_t n = 0;
+    for(size_t i = 0; i < r; ++i) {
+	n += std::min<uint32_t>(low, run_end(*this, i)) - data_[2 * i] + 1;
+    }
+    return n;
+}
+
+uint16_t
+line_bitmap::container::select(uint32_t i) const
+{
+    assert(i < card_);
+    switch(type_) {
+    case array_type:
+	return data_[i];
+    case bitmap_type:
+	for(uint32_t w = 0; w < words; ++w) {
+	    const uint32_t n = popcount(words_[w]);
+	    if (i < n) {
+		uint64_t m = words_[w];
+		for(; i > 0; --i) {
+		    m &= m - 1;
+		}
+		return w * 64 + ctz(m);
+	    }
+	    i -= n;
+	}
+	break;
+    case run_type:
+	for(size_t r = 0; 2 * r < data_.size(); ++r) {
+	    if (i <= data_[2 * r + 1]) {
+		return data_[2 * r] + i;
+	    }
+	    i -= data_[2 * r + 1] + 1;
+	}
+	break;
+    }
+    assert(false);
+    return 0;
+}
+
+bool
+line_bitmap::container::next(const uint16_t low, uint16_t& n) const
+{
+    switch(type_) {
+    case array_type:
+	{
+	    const auto it = std::lower_bound(data_.begin(), data_.end(), low);
+	    if (it == data_.end()) {
+		return false;
+	    }
+	    n = *it;
+	    return true;
+	}
+    case bitmap_type:
+	{
+	    const uint32_t b = next_set(words_.data(), low);
+	    if (b == no_bit) {
+		return false;
+	    }
+	    n = b;
+	    return true;
+	}
+    case run_type:
+	break;
+    }
+    const size_t r = runs_before(*this, low);
+    if (r > 0 && low <= run_end(*this, r - 1)) {
+	n = low;
+	return true;
+    }
+    if (2 * r == data_.size()) {
+	return false;
+    }
+    n = data_[2 * r];
+    return true;
+}
+
+bool
+line_bitmap::container::prev(const uint16_t low, uint16_t& n) const
+{
+    switch(type_) {
+    case array_type:
+	{
+	    const auto it = std::upper_bound(data_.begin(), data_.end(), low);
+	    if (it == data_.begin()) {
+		return false;
+	    }
+	    n = *(it - 1);
+	    return true;
+	}
+    case bitmap_type:
+	{
+	    uint32_t i = low / 64;
+	    uint64_t m = words_[i] & (~uint64_t(0) >> (63 - low % 64));
+	    while(m == 0) {
+		if (i == 0) {
+		    return false;
+		}
+		m = words_[--i];
+	    }
+	    n = i * 64 + msb(m);
+	    return true;
+	}
+    case run_type:
+	break;
+    }
+    const size_t r = runs_before(*this, low);
+    if (r == 0) {
+	return false;
+    }
+    n = std::min<uint32_t>(low, run_end(*this, r - 1));
+    return true;
+}
+
+void
+line_bitmap::container::add(const uint16_t low)
+{
+    ++card_;
+    switch(type_) {
+    case array_type:
+	assert(data_.empty() || data_.back() < low);
+	data_.push_back(low);
+	if (card_ > max_array_size) {
+	    std::vector<uint64_t> w(words, 0);
+	    to_words(w.data());
+	    std::vector<uint16_t>().swap(data_);
+	    words_.swap(w);
+	    type_ = bitmap_type;
+	}
+	break;
+    case bitmap_type:
+	words_[low / 64] |= uint64_t(1) << (low % 64);
+	break;
+    case run_type:
+	{
+	    const size_t n = data_.size();
+	    assert(n == 0 || uint32_t(data_[n - 2]) + data_[n - 1] < low);
+	    if (n > 0 && uint32_t(data_[n - 2]) + data_[n - 1] + 1 == low) {
+		++data_[n - 1];
+	    } else {
+		data_.push_back(low);
+		data_.push_back(0);
+	    }
+	}
+	break;
+    }
+}
+
+void
+line_bitmap::container::add_range(const uint16_t lo, const uint16_t hi)
+{
+    assert(lo <= hi);
+    const uint32_t n = uint32_t(hi) - lo + 1;
+    if (type_ == array_type) {
+	if (card_ + n <= max_array_size) {
+	    for(uint32_t i = lo; i <= hi; ++i) {
+		data_.push_back(i);
+	    }
+	    card_ += n;
+	    return;
+	}
+	std::vector<uint64_t> w(words, 0);
+	to_words(w.data());
+	std::vector<uint16_t>().swap(data_);
+	words_.swap(w);
+	type_ = bitmap_type;
+    }
+    card_ += n;
+    if (type_ == bitmap_type) {
+	set_range(words_.data(), lo, hi);
+	return;
+    }
+    const size_t s = data_.size();
+    if (s > 0 && uint32_t(data_[s - 2]) + data_[s - 1] + 1 == lo) {
+	data_[s - 1] += n;
+    } else {
+	data_.push_back(lo);
+	data_.push_back(n - 1);
+    }
+}
+
+void
+line_bitmap::container::to_words(uint64_t* w) const
+{
+    switch(type_) {
+    case array_type:
+	for(auto d : data_) {
+	    w[d / 64] |= uint64_t(1) << (d % 64);
+	}
+	break;
+    case bitmap_type:
+	for(uint32_t i = 0; i < words; ++i) {
+	    w[i] |= words_[i];
+	}
+	break;
+    case run_type:
+	for(size_t i = 0; i < data_.size(); i += 2) {
+	    set_range(w, data_[i], uint32_t(data_[i]) + data_[i + 1]);
+	}
+	break;
+    }
+}
+
+void
+line_bitmap::container::assign_words(const uint64_t* w, const type_t t)
+{
+    std::vector<uint16_t> data;
+    std::vector<uint64_t> wrds;
+    card_ = count_bits(w);
+    switch(t) {
+    case array_type:
+	data.reserve(card_);
+	for(uint32_t i = 0; i < words; ++i) {
+	    for(uint64_t m = w[i]; m != 0; m &= m - 1) {
+		data.push_back(i * 64 + ctz(m));
+	    }
+	}
+	break;
+    case bitmap_type:
+	wrds.assign(w, w + words);
+	break;
+    case run_type:
+	data.reserve(2 * count_runs(w));
+	for(uint32_t pos = next_set(w, 0); pos < no_bit; ) {
+	    const uint32_t end = next_clear(w, pos);
+	    data.push_back(pos);
+	    data.push_back(end - 1 - pos);
+	    pos = next_set(w, end);
+	}
+	break;
+    }
+    type_ = t;
+    data_.swap(data);
+    words_.swap(wrds);
+}
+
+void
+line_bitmap::const_iterator::settle()
+{
+    while(ci_ < c_->size()) {
+	const container& c = (*c_)[ci_];
+	switch(c.type_) {
+	case array_type:
+	    if (pos_ < c.data_.size()) {
+		return;
+	    }
+	    break;
+	case bitmap_type:
+	    pos_ = next_set(c.words_.data(), pos_);
+	    if (pos_ < no_bit) {
+		return;
+	    }
+	    break;
+	case run_type:
+	    if (2 * pos_ < c.data_.size()) {
+		return;
+	    }
+	    break;
+	}
+	++ci_;
+	pos_ = 0;
+	off_ = 0;
+    }
+}
+
+line_number_t
+line_bitmap::const_iterator::operator*() const
+{
+    const container& c = (*c_)[ci_];
+    const line_number_t base = c.key_ << 16;
+    switch(c.type_) {
+    case array_type:
+	return base | c.data_[pos_];
+    case bitmap_type:
+	return base | pos_;
+    case run_type:
+	break;
+    }
+    return base | (c.data_[2 * pos_] + off_);
+}
+
+line_bitmap::const_iterator&
+line_bitmap::const_iterator::operator++()
+{
+    const container& c = (*c_)[ci_];
+    if (c.type_ == run_type && off_ < c.data_[2 * pos_ + 1]) {
+	++off_;
+	return *this;
+    }
+    ++pos_;
+    off_ = 0;
+    settle();
+    return *this;
+}
+
+uint64_t
+line_bitmap::cardinality() const
+{
+    uint64_t n = 0;
+    for(const auto& c : c_) {
+	n += c.card_;
+    }
+    return n;
+}
+
+bool
+line_bitmap::contains(const line_number_t num) const
+{
+    const line_number_t key = num >> 16;
+    auto i = std::lower_bound(c_.begin(), c_.end(), key, [](const container& c, const line_number_t k) { return c.key_ < k; });
+    return i != c_.end() && i->key_ == key && i->contains(num & 0xffff);
+}
+
+uint64_t
+line_bitmap::rank(const line_number_t num) const
+{
+    const line_number_t key = num >> 16;
+    uint64_t n = 0;
+    for(const auto& c : c_) {
+	if (c.key_ > key) {
+	    break;
+	}
+	n += (c.key_ < key) ? c.card_ : c.rank(num & 0xffff);
+    }
+    return n;
+}
+
+line_number_t
+line_bitmap::select(uint64_t i) const
+{
+    for(const auto& c : c_) {
+	if (i < c.card_) {
+	    return (c.key_ << 16) | c.select(i);
+	}
+	i -= c.card_;
+    }
+    assert(false);
+    return 0;
+}
+
+line_number_t
+line_bitmap::next(const line_number_t num) const
+{
+    if (num == max_line_number) {
+	return 0;
+    }
+    const line_number_t key = (num + 1) >> 16;
+    auto i = std::lower_bound(c_.begin(), c_.end(), key, [](const container& c, const line_number_t k) { return c.key_ < k; });
+    for(; i != c_.end(); ++i) {
+	uint16_t n;
+	if (i->next((i->key_ == key) ? ((num + 1) & 0xffff) : 0, n)) {
+	    return (i->key_ << 16) | n;
+	}
+    }
+    return 0;
+}
+
+line_number_t
+line_bitmap::prev(const line_number_t num) const
+{
+    if (num == 0) {
+	return 0;
+    }
+    const line_number_t key = (num - 1) >> 16;
+    auto i = std::upper_bound(c_.begin(), c_.end(), key, [](const line_number_t k, const container& c) { return k < c.key_; });
+    while(i != c_.begin()) {
+	--i;
+	uint16_t n;
+	if (i->prev((i->key_ == key) ? ((num - 1) & 0xffff) : 0xffff, n)) {
+	    return (i->key_ << 16) | n;
+	}
+    }
+    return 0;
+}
+
+line_number_t
+line_bitmap::min() const
+{
+    return c_.empty() ? 0 : (c_.front().key_ << 16) | c_.front().select(0);
+}
+
+line_number_t
+line_bitmap::max() const
+{
+    if (c_.empty()) {
+	return 0;
+    }
+    const container& c = c_.back();
+    const line_number_t base = c.key_ << 16;
+    switch(c.type_) {
+    case array_type:
+	return base | c.data_.back();
+    case bitmap_type:
+	break;
+    case run_type:
+	return base | (uint32_t(c.data_[c.data_.size() - 2]) + c.data_.back());
+    }
+    for(uint32_t i = words; i-- > 0; ) {
+	if (c.words_[i] != 0) {
+	    return base | (i * 64 + msb(c.words_[i]));
+	}
+    }
+    assert(false);
+    return base;
+}
+
+void
+line_bitmap::add(const line_number_t num)
+{
+    const line_number_t key = num >> 16;
+    if (c_.empty() || c_.back().key_ != key) {
+	assert(c_.empty() || c_.back().key_ < key);
+	c_.emplace_back(key, array_type);
+    }
+    c_.back().add(num & 0xffff);
+}
+
+void
+line_bitmap::add_range(line_number_t first, const line_number_t last)
+{
+    assert(first <= last);
+    assert(c_.empty() || max() < first);
+    const line_number_t last_key = last >> 16;
+    while(true) {
+	const line_number_t key = first >> 16;
+	const uint16_t lo = first & 0xffff;
+	const uint16_t hi = (key == last_key) ? (last & 0xffff) : 0xffff;
+	if (c_.empty() || c_.back().key_ != key) {
+	    c_.emplace_back(key, run_type);
+	}
+	c_.back().add_range(lo, hi);
+	if (key == last_key) {
+	    break;
+	}
+	first = (key + 1) << 16;
+    }
+}
+
+void
+line_bitmap::append(line_bitmap&& b)
+{
+    if (b.c_.empty()) {
+	return;
+    }
+    assert(c_.empty() || max() < *b.begin());
+    auto i = b.c_.begin();
+    if (! c_.empty() && c_.back().key_ == i->key_) {
+	c_.back() = or_container(c_.back(), *i);
+	++i;
+    }
+    c_.insert(c_.end(), std::make_move_iterator(i), std::make_move_iterator(b.c_.end()));
+    b.clear();
+}
+
+void
+line_bitmap::optimize()
+{
+    uint64_t buf[words];
+    for(auto& c : c_) {
+	const uint64_t* w = words_of(c, buf);
+	const type_t t = best_type(c.card_, count_runs(w));
+	if (t != c.type_) {
+	    if (w != buf) {
+		std::copy(w, w + words, buf);
+	    }
+	    c.assign_words(buf, t);
+	} else {
+	    c.data_.shrink_to_fit();
+	}
+    }
+    c_.shrink_to_fit();
+}
+
+lineNum_vector_t
+line_bitmap::to_vector() const
+{
+    lineNum_vector_t v;
+    v.reserve(cardinality());
+    for(const auto& c : c_) {
+	const line_number_t base = c.key_ << 16;
+	switch(c.type_) {
+	case array_type:
+	    for(auto d : c.data_) {
+		v.push_back(base | d);
+	    }
+	    break;
+	case bitmap_type:
+	    for(uint32_t i = 0; i < words; ++i) {
+		for(uint64_t m = c.words_[i]; m != 0; m &= m - 1) {
+		    v.push_back(base | (i * 64 + ctz(m)));
+		}
+	    }
+	    break;
+	case run_type:
+	    for(size_t i = 0; i < c.data_.size(); i += 2) {
+		const uint32_t end = uint32_t(c.data_[i]) + c.data_[i + 1];
+		for(uint32_t d = c.data_[i]; d <= end; ++d) {
+		    v.push_back(base | d);
+		}
+	    }
+	    break;
+	}
+    }
+    return v;
+}
+
+size_t
+line_bitmap::memory_usage() const
+{
+    size_t n = sizeof(*this) + c_.capacity() * sizeof(container);
+    for(const auto& c : c_) {
+	n += c.memory_usage();
+    }
+    return n;
+}
+
+size_t
+line_bitmap::containers(const type_t t) const
+{
+    return std::count_if(c_.begin(), c_.end(), [t](const container& c) { return c.type_ == t; });
+}
+
+line_bitmap
+line_bitmap::and_(const line_bitmap& a, const line_bitmap& b)
+{
+    line_bitmap r;
+    size_t i = 0, j = 0;
+    while(i < a.c_.size() && j < b.c_.size()) {
+	if (a.c_[i].key_ < b.c_[j].key_) {
+	    ++i;
+	} else if (a.c_[i].key_ > b.c_[j].key_) {
+	    ++j;
+	} else {
+	    container c = and_container(a.c_[i++], b.c_[j++]);
+	    if (c.card_ > 0) {
+		r.c_.push_back(std::move(c));
+	    }
+	}
+    }
+    return r;
+}
+
+line_bitmap
+line_bitmap::and_not(const line_bitmap& a, const line_bitmap& b)
+{
+    line_bitmap r;
+    size_t j = 0;
+    for(const auto& c : a.c_) {
+	while(j < b.c_.size() && b.c_[j].key_ < c.key_) {
+	    ++j;
+	}
+	if (j < b.c_.size() && b.c_[j].key_ == c.key_) {
+	    container d = and_not_container(c, b.c_[j]);
+	    if (d.card_ > 0) {
+		r.c_.push_back(std::move(d));
+	    }
+	} else {
+	    r.c_.push_back(c);
+	}
+    }
+    return r;
+}
+
+line_bitmap
+line_bitmap::or_(const line_bitmap& a, const line_bitmap& b)
+{
+    line_bitmap r;
+    size_t i = 0, j = 0;
+    while(i < a.c_.size() || j < b.c_.size()) {
+	if (j == b.c_.size() || (i < a.c_.size() && a.c_[i].key_ < b.c_[j].key_)) {
+	    r.c_.push_back(a.c_[i++]);
+	} else if (i == a.c_.size() || a.c_[i].key_ > b.c_[j].key_) {
+	    r.c_.push_back(b.c_[j++]);
+	} else {
+	    r.c_.push_back(or_container(a.c_[i++], b.c_[j++]));
+	}
+    }
+    return r;
+}
+
+std::string
+line_bitmap::serialize() const
+{
+    std::string s;
+    for(const auto& c : c_) {
+	serialized_container h;
+	h.key = c.key_;
+	h.type = c.type_;
+	h.card = c.card_;
+	const char* data;
+	uint64_t bytes;
+	if (c.type_ == bitmap_type) {
+	    h.n = c.words_.size();
+	    data = reinterpret_cast<const char*>(c.words_.data());
+	    bytes = h.n * sizeof(uint64_t);
+	} else {
+	    h.n = c.data_.size();
+	    data = reinterpret_cast<const char*>(c.data_.data());
+	    bytes = h.n * sizeof(uint16_t);
+	}
+	s.append(reinterpret_cast<const char*>(&h), sizeof(h));
+	s.append(data, bytes);
+	s.append(padded(bytes) - bytes, '\0');
+    }
+    return s;
+}
+
+bool
+line_bitmap::deserialize(const void* data, const uint64_t size)
+{
+    c_.clear();
+    const char* p = static_cast<const char*>(data);
+    const char* end = p + size;
+    while(p != end) {
+	serialized_container h;
+	if (uint64_t(end - p) < sizeof(h)) {
+	    c_.clear();
+	    return false;
+	}
+	memcpy(&h, p, sizeof(h));
+	p += sizeof(h);
+
+	const bool bitmap = h.type == bitmap_type;
+	const uint64_t max_n = bitmap ? words : 2 * uint64_t(65536);
+	const uint64_t bytes = h.n * (bitmap ? sizeof(uint64_t) : sizeof(uint16_t));
+	if (h.type > run_type ||
+	    h.key > (line_number_t(~0) >> 16) ||
+	    (! c_.empty() && h.key <= c_.back().key_) ||
+	    h.card == 0 ||
+	    h.n > max_n ||
+	    uint64_t(end - p) < padded(bytes)) {
+	    c_.clear();
+	    return false;
+	}
+
+	container c(h.key, static_cast<type_t>(h.type));
+	uint64_t card = 0;
+	if (bitmap) {
+	    c.words_.resize(h.n);
+	    memcpy(c.words_.data(), p, bytes);
+	    card = (h.n == words) ? count_bits(c.words_.data()) : 0;
+	} else {
+	    c.data_.resize(h.n);
+	    memcpy(c.data_.data(), p, bytes);
+	    // the numbers have to be ascending
+	    bool valid = true;
+	    if (c.type_ == array_type) {
+		for(size_t i = 1; i < c.data_.size(); ++i) {
+		    valid = valid && c.data_[i - 1] < c.data_[i];
+		}
+		card = valid ? c.data_.size() : 0;
+	    } else {
+		valid = h.n % 2 == 0;
+		uint32_t next = 0;
+		for(size_t i = 0; valid && i < c.data_.size(); i += 2) {
+		    const uint32_t last = uint32_t(c.data_[i]) + c.data_[i + 1];
+		    valid = c.data_[i] >= next && last <= 0xffff;
+		    next = last + 1;
+		    card += c.data_[i + 1] + 1;
+		}
+		card = valid ? card : 0;
+	    }
+	}
+	if (card != h.card || (c.type_ == array_type && card > max_array_size)) {
+	    c_.clear();
+	    return false;
+	}
+	c.card_ = h.card;
+	c_.push_back(std::move(c));
+	p += padded(bytes);
+    }
+    return true;
+}
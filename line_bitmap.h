@@ -0,0 +1,191 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "types.h"
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * a compressed set of line numbers.
+ *
+ * The line numbers are split by their upper 16 bits into containers. Each container stores the
+ * lower 16 bits of its line numbers in the representation that uses the least memory:
+ * - an array container stores up to max_array_size sorted numbers, 2 bytes per line.
+ * - a bitmap container stores 1 bit for each of the 65536 possible numbers, 8 KB.
+ * - a run container stores sequences of consecutive numbers as start and length pairs, 4 bytes per run.
+ *
+ * A sparse filter uses array containers, a broad filter bitmap containers and
+ * a negative '!' filter, which matches most lines, a few runs.
+ * The set operations work on 64bit words of bitmaps.
+ */
+class line_bitmap
+{
+public:
+    /// maximum number of elements in an array container.
+    static const uint32_t max_array_size = 4096;
+    /// number of 64bit words of a bitmap container.
+    static const uint32_t bitmap_words = 65536 / 64;
+
+    enum type_t { array_type = 0, bitmap_type = 1, run_type = 2 };
+
+    /// a container stores the line numbers with the same upper 16 bits.
+    struct container
+    {
+	/// the line numbers shifted right by 16 bits.
+	line_number_t key_;
+	type_t type_;
+	/// number of line numbers in the container.
+	uint32_t card_;
+	/// the lower 16 bits of an array container; start and length - 1 pairs of a run container.
+	std::vector<uint16_t> data_;
+	/// the words of a bitmap container.
+	std::vector<uint64_t> words_;
+
+	container(const line_number_t key, const type_t t) : key_(key), type_(t), card_(0) {}
+
+	/// @return true if the lower 16 bits low are in the container.
+	bool contains(const uint16_t low) const;
+
+	/// @return number of numbers in the container which are less than or equal to low.
+	uint32_t rank(const uint16_t low) const;
+
+	/// @return the number with index i in ascending order, i has to be less than card_.
+	uint16_t select(uint32_t i) const;
+
+	/**
+	 * find the smallest number which is larger than or equal to low.
+	 * @return true if n was set; false if there is no such number.
+	 */
+	bool next(const uint16_t low, uint16_t& n) const;
+
+	/**
+	 * find the largest number which is less than or equal to low.
+	 * @return true if n was set; false if there is no such number.
+	 */
+	bool prev(const uint16_t low, uint16_t& n) const;
+
+	/// add low, which has to be larger than all numbers in the container.
+	void add(const uint16_t low);
+
+	/// add [lo, hi], lo has to be larger than all numbers in the container.
+	void add_range(const uint16_t lo, const uint16_t hi);
+
+	/// set the bits of all numbers in w, which has bitmap_words entries.
+	void to_words(uint64_t* w) const;
+
+	/// replace the content with the bits of w, stored as type t.
+	void assign_words(const uint64_t* w, const type_t t);
+
+	/// @return number of bytes used to store the numbers.
+	size_t memory_usage() const { return data_.capacity() * sizeof(uint16_t) + words_.capacity() * sizeof(uint64_t); }
+    };
+
+private:
+    std::vector<container> c_;
+
+public:
+    /// forward iterator over the line numbers in ascending order.
+    class const_iterator
+    {
+	const std::vector<container>* c_;
+	size_t ci_;
+	/// array: index of the number; bitmap: the number; run: index of the run.
+	uint32_t pos_;
+	/// run: offset in the run.
+	uint32_t off_;
+
+	/// move to the next valid position, starting at the current position.
+	void settle();
+
+    public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef line_number_t value_type;
+	typedef ptrdiff_t difference_type;
+	typedef const line_number_t* pointer;
+	typedef line_number_t reference;
+
+	const_iterator() : c_(nullptr), ci_(0), pos_(0), off_(0) {}
+	const_iterator(const std::vector<container>& c, const size_t ci) : c_(&c), ci_(ci), pos_(0), off_(0) { settle(); }
+
+	line_number_t operator*() const;
+	const_iterator& operator++();
+	const_iterator operator++(int) { const_iterator i = *this; ++*this; return i; }
+	bool operator==(const const_iterator& o) const { return ci_ == o.ci_ && pos_ == o.pos_ && off_ == o.off_; }
+	bool operator!=(const const_iterator& o) const { return !(*this == o); }
+    };
+
+    const_iterator begin() const { return const_iterator(c_, 0); }
+    const_iterator end() const { return const_iterator(c_, c_.size()); }
+
+    /// @return true if the set is empty.
+    bool empty() const { return c_.empty(); }
+
+    /// @return number of line numbers in the set.
+    uint64_t cardinality() const;
+
+    /// @return true if num is in the set.
+    bool contains(const line_number_t num) const;
+
+    /// @return number of line numbers in the set which are less than or equal to num.
+    uint64_t rank(const line_number_t num) const;
+
+    /// @return the line number with index i in ascending order, i has to be less than cardinality().
+    line_number_t select(uint64_t i) const;
+
+    /// @return the smallest line number which is larger than num; 0 if there is none.
+    line_number_t next(const line_number_t num) const;
+
+    /// @return the largest line number which is less than num; 0 if there is none.
+    line_number_t prev(const line_number_t num) const;
+
+    /// @return the smallest line number; 0 if the set is empty.
+    line_number_t min() const;
+
+    /// @return the largest line number; 0 if the set is empty.
+    line_number_t max() const;
+
+    /// add num, which has to be larger than all line numbers in the set.
+    void add(const line_number_t num);
+
+    /// add [first, last], first has to be larger than all line numbers in the set.
+    void add_range(line_number_t first, const line_number_t last);
+
+    /// add all line numbers of b, which have to be larger than all line numbers in the set.
+    void append(line_bitmap&& b);
+
+    /// remove all line numbers.
+    void clear() { c_.clear(); }
+
+    /// convert every container to the representation that uses the least memory.
+    void optimize();
+
+    /// @return the line numbers in a vector, as used by DisplayInfo.
+    lineNum_vector_t to_vector() const;
+
+    /// @return number of bytes used by the set.
+    size_t memory_usage() const;
+
+    /// @return the number of containers of type t, used for tests.
+    size_t containers(const type_t t) const;
+
+    ///@{
+    /// set operations. Bitmap and run containers are combined 64 bits at a time.
+    static line_bitmap and_(const line_bitmap& a, const line_bitmap& b);
+    static line_bitmap and_not(const line_bitmap& a, const line_bitmap& b);
+    static line_bitmap or_(const line_bitmap& a, const line_bitmap& b);
+    ///@}
+
+    /// @return the set as a string of bytes.
+    std::string serialize() const;
+
+    /**
+     * replace the set with a serialized set.
+     * @return true upon success; false if data is not a valid serialized set, then the set is empty.
+     */
+    bool deserialize(const void* data, const uint64_t size);
+};
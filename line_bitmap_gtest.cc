@@ -0,0 +1,281 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "line_bitmap.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <random>
+
+namespace {
+    line_bitmap make_bitmap(const lineNum_vector_t& v)
+    {
+	line_bitmap b;
+	for(auto n : v) {
+	    b.add(n);
+	}
+	return b;
+    }
+
+    /**
+     * @return sorted random line numbers in [1, max].
+     * @param density probability that a line is in the set.
+     * @param run_length the lines are added in runs of this length.
+     */
+    lineNum_vector_t random_lines(std::mt19937& gen, const line_number_t max, const double density, const unsigned run_length)
+    {
+	std::bernoulli_distribution d(density);
+	lineNum_vector_t v;
+	for(line_number_t n = 1; n <= max; n += run_length) {
+	    if (d(gen)) {
+		for(line_number_t i = n; i < n + run_length && i <= max; ++i) {
+		    v.push_back(i);
+		}
+	    }
+	}
+	return v;
+    }
+}
+
+TEST(line_bitmap, is_empty)
+{
+    line_bitmap b;
+    ASSERT_TRUE(b.empty());
+    ASSERT_EQ(0u, b.cardinality());
+    ASSERT_TRUE(b.begin() == b.end());
+    ASSERT_TRUE(b.to_vector().empty());
+    ASSERT_FALSE(b.contains(1));
+}
+
+TEST(line_bitmap, stores_line_numbers)
+{
+    const lineNum_vector_t v = { 1, 2, 3, 100, 65535, 65536, 65537, 200000, 0xffffffff };
+    line_bitmap b = make_bitmap(v);
+    ASSERT_EQ(v.size(), b.cardinality());
+    ASSERT_EQ(v, b.to_vector());
+    ASSERT_EQ(v, lineNum_vector_t(b.begin(), b.end()));
+    ASSERT_EQ(0xffffffffu, b.max());
+    for(auto n : v) {
+	ASSERT_TRUE(b.contains(n)) << n;
+    }
+    ASSERT_FALSE(b.contains(4));
+    ASSERT_FALSE(b.contains(65534));
+    ASSERT_FALSE(b.contains(0xfffffffe));
+}
+
+TEST(line_bitmap, uses_the_smallest_container)
+{
+    // sparse lines use array containers
+    line_bitmap sparse;
+    for(line_number_t n = 1; n < 1000000; n += 100) {
+	sparse.add(n);
+    }
+    sparse.optimize();
+    ASSERT_EQ(sparse.containers(line_bitmap::array_type), 16u);
+
+    // scattered dense lines use bitmap containers
+    line_bitmap dense;
+    for(line_number_t n = 1; n < 1000000; n += 3) {
+	dense.add(n);
+    }
+    dense.optimize();
+    ASSERT_EQ(dense.containers(line_bitmap::bitmap_type), 16u);
+
+    // consecutive lines use run containers
+    line_bitmap runs;
+    runs.add_range(1, 999999);
+    runs.optimize();
+    ASSERT_EQ(runs.containers(line_bitmap::run_type), 16u);
+    ASSERT_EQ(999999u, runs.cardinality());
+    ASSERT_LT(runs.memory_usage(), 2000u);
+
+    // optimize() does not change the set
+    lineNum_vector_t v;
+    for(line_number_t n = 1; n < 1000000; n += 3) {
+	v.push_back(n);
+    }
+    ASSERT_EQ(v, dense.to_vector());
+}
+
+TEST(line_bitmap, add_range_and_add_mix)
+{
+    line_bitmap b;
+    lineNum_vector_t v;
+    b.add(5);
+    v.push_back(5);
+    b.add_range(6, 10);
+    b.add_range(20, 70000);
+    for(line_number_t n = 6; n <= 10; ++n) {
+	v.push_back(n);
+    }
+    for(line_number_t n = 20; n <= 70000; ++n) {
+	v.push_back(n);
+    }
+    b.add(70001);
+    b.add(70003);
+    v.push_back(70001);
+    v.push_back(70003);
+    ASSERT_EQ(v, b.to_vector());
+    b.optimize();
+    ASSERT_EQ(v, b.to_vector());
+    ASSERT_EQ(v, lineNum_vector_t(b.begin(), b.end()));
+}
+
+TEST(line_bitmap, append)
+{
+    line_bitmap a = make_bitmap({ 1, 2, 3, 70000 });
+    a.append(make_bitmap({ 70001, 200000 }));
+    const lineNum_vector_t expected = { 1, 2, 3, 70000, 70001, 200000 };
+    ASSERT_EQ(expected, a.to_vector());
+    a.append(line_bitmap());
+    ASSERT_EQ(expected, a.to_vector());
+}
+
+TEST(line_bitmap, set_operations_are_identical_to_std_algorithms)
+{
+    std::mt19937 gen(42);
+    const line_number_t max = 300000;
+    // sparse, scattered, dense and runs of lines
+    const std::vector<std::pair<double, unsigned>> params = { {0.001, 1}, {0.05, 1}, {0.3, 1}, {0.9, 1}, {0.5, 1000}, {0.99, 5000} };
+    for(auto pa : params) {
+	for(auto pb : params) {
+	    const lineNum_vector_t va = random_lines(gen, max, pa.first, pa.second);
+	    const lineNum_vector_t vb = random_lines(gen, max, pb.first, pb.second);
+	    line_bitmap a = make_bitmap(va), b = make_bitmap(vb);
+	    for(int optimized = 0; optimized < 2; ++optimized) {
+		lineNum_vector_t expected;
+		std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(expected));
+		ASSERT_EQ(expected, line_bitmap::and_(a, b).to_vector()) << pa.first << " " << pb.first;
+		expected.clear();
+		std::set_difference(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(expected));
+		ASSERT_EQ(expected, line_bitmap::and_not(a, b).to_vector()) << pa.first << " " << pb.first;
+		expected.clear();
+		std::set_union(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(expected));
+		ASSERT_EQ(expected, line_bitmap::or_(a, b).to_vector()) << pa.first << " " << pb.first;
+		a.optimize();
+		b.optimize();
+	    }
+	}
+    }
+}
+
+TEST(line_bitmap, rank_select_next_and_prev_are_identical_to_std_algorithms)
+{
+    std::mt19937 gen(7);
+    const line_number_t max = 300000;
+    const std::vector<std::pair<double, unsigned>> params = { {0.001, 1}, {0.3, 1}, {0.9, 1}, {0.5, 1000} };
+    for(auto p : params) {
+	const lineNum_vector_t v = random_lines(gen, max, p.first, p.second);
+	line_bitmap b = make_bitmap(v);
+	for(int optimized = 0; optimized < 2; ++optimized) {
+	    ASSERT_EQ(v.empty() ? 0 : v.front(), b.min());
+	    for(size_t i = 0; i < v.size(); i += 97) {
+		ASSERT_EQ(v[i], b.select(i)) << p.first << " " << i;
+	    }
+	    for(line_number_t n = 0; n <= max + 1; n += 7) {
+		const auto upper = std::upper_bound(v.begin(), v.end(), n);
+		const auto lower = std::lower_bound(v.begin(), v.end(), n);
+		ASSERT_EQ(uint64_t(upper - v.begin()), b.rank(n)) << p.first << " " << n;
+		ASSERT_EQ(upper == v.end() ? 0 : *upper, b.next(n)) << p.first << " " << n;
+		ASSERT_EQ(lower == v.begin() ? 0 : *(lower - 1), b.prev(n)) << p.first << " " << n;
+	    }
+	    b.optimize();
+	}
+    }
+}
+
+TEST(line_bitmap, serialize)
+{
+    std::mt19937 gen(7);
+    line_bitmap b = make_bitmap(random_lines(gen, 200000, 0.01, 1));
+    for(auto n : random_lines(gen, 100000, 0.5, 1)) {
+	b.add(n + 200000);
+    }
+    b.add_range(400000, 500000);
+    b.optimize();
+    ASSERT_GT(b.containers(line_bitmap::array_type), 0u);
+    ASSERT_GT(b.containers(line_bitmap::run_type), 0u);
+
+    const std::string s = b.serialize();
+    line_bitmap c;
+    ASSERT_TRUE(c.deserialize(s.data(), s.size()));
+    ASSERT_EQ(b.to_vector(), c.to_vector());
+
+    ASSERT_TRUE(c.deserialize("", 0));
+    ASSERT_TRUE(c.empty());
+
+    // truncated and corrupted data is rejected
+    ASSERT_FALSE(c.deserialize(s.data(), s.size() - 8));
+    ASSERT_TRUE(c.empty());
+    std::string t = s;
+    t[8] = 7; // type
+    ASSERT_FALSE(c.deserialize(t.data(), t.size()));
+}
+
+TEST(line_bitmap, benchmark)
+{
+    // a negative filter matches almost every line
+    std::mt19937 gen(1);
+    const line_number_t max = 10000000;
+    lineNum_vector_t most;
+    for(line_number_t n = 1; n <= max; ++n) {
+	if (n % 10000 != 0) {
+	    most.push_back(n);
+	}
+    }
+    const lineNum_vector_t some = random_lines(gen, max, 0.2, 1);
+    line_bitmap a = make_bitmap(most), b = make_bitmap(some);
+    a.optimize();
+    b.optimize();
+
+    auto start = std::chrono::steady_clock::now();
+    lineNum_vector_t out;
+    std::set_intersection(most.begin(), most.end(), some.begin(), some.end(), std::back_inserter(out));
+    const auto vector_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    const line_bitmap r = line_bitmap::and_(a, b);
+    const auto bitmap_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(out.size(), r.cardinality());
+
+    std::clog << "line bitmap benchmark: " << most.size() << " lines: vector " << most.size() * sizeof(line_number_t) << " bytes, bitmap " << a.memory_usage() << " bytes; "
+	      << some.size() << " lines: vector " << some.size() * sizeof(line_number_t) << " bytes, bitmap " << b.memory_usage() << " bytes; "
+	      << "intersection: std::set_intersection " << vector_ms << " ms, line_bitmap::and_ " << bitmap_ms << " ms" << std::endl;
+}
+
+TEST(line_bitmap, stores_the_largest_line_numbers)
+{
+    line_bitmap b;
+    b.add_range(max_line_number - 70000, max_line_number);
+    ASSERT_EQ(70001u, b.cardinality());
+    ASSERT_EQ(max_line_number, b.max());
+    ASSERT_TRUE(b.contains(max_line_number));
+    ASSERT_EQ(max_line_number, b.to_vector().back());
+    ASSERT_EQ(0u, b.next(max_line_number));
+    ASSERT_EQ(max_line_number, b.next(max_line_number - 1));
+    ASSERT_EQ(max_line_number - 1, b.prev(max_line_number));
+    ASSERT_EQ(70001u, b.rank(max_line_number));
+    ASSERT_EQ(max_line_number, b.select(70000));
+    b.optimize();
+    const std::string s = b.serialize();
+    line_bitmap c;
+    ASSERT_TRUE(c.deserialize(s.data(), s.size()));
+    ASSERT_EQ(b.to_vector(), c.to_vector());
+}
+
+#ifdef LINE_NUMBER_64
+TEST(line_bitmap, stores_line_numbers_beyond_32bit)
+{
+    const lineNum_vector_t v = { 1, 0xffffffff, 0x100000000, 0x100000001, 0x123456789a };
+    line_bitmap b = make_bitmap(v);
+    ASSERT_EQ(v, b.to_vector());
+    ASSERT_EQ(0x123456789au, b.max());
+    ASSERT_FALSE(b.contains(0x100000002));
+
+    line_bitmap r;
+    r.add_range(0xfffffff0, 0x100000010);
+    ASSERT_EQ(lineNum_vector_t({ 0xffffffff, 0x100000000, 0x100000001 }), line_bitmap::and_(b, r).to_vector());
+}
+#endif
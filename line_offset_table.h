@@ -0,0 +1,212 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "memorymap.h"
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+#include <cassert>
+#include <cstring>
+
+/**
+ * a table of line offsets into a file.
+ * The table stores one 64bit offset per line: the offset of the first character of the next line.
+ * Entry 0 is the offset of the first line. Line number n spans the offsets [at(n-1), at(n)).
+ *
+ * The offsets are stored in fixed size blocks, which are not moved or copied when the table grows.
+ * This avoids the temporary doubling of memory a std::vector needs when it grows.
+ * The blocks can also point into read only memory, e.g. a memory mapped cache file, see assign().
+ *
+ * One thread can push_back() offsets while other threads read the table. A new offset is published
+ * by incrementing the atomic entry count after it was stored, so readers only see complete entries.
+ * The writer has to call reserve() before, so the block pointers are never moved.
+ *
+ * A full block has the size of a huge page, so the kernel can back it with one transparent huge page,
+ * see doj::hugepagealloc(). The first block starts small and is copied into a larger block when it is
+ * full, so the table of a small file uses little memory. A block which is copied from read only memory
+ * grows the same way. A reader can still use the old block, so it is freed with the table. The old
+ * blocks use a third of the memory of the last block.
+ */
+class line_offset_table
+{
+public:
+    typedef uint64_t offset_t;
+
+    /// number of offsets in a block, 2^18 offsets are 2 MB.
+    static const unsigned block_bits = 18;
+    static const uint64_t block_size = 1llu << block_bits;
+
+    /// number of offsets in the first allocation of a block.
+    static const uint64_t min_block_size = 1024;
+
+    /// a full block which is not a huge page is copied into a block of block_growth times the size.
+    static const unsigned block_growth = 4;
+
+private:
+    /// pointers to the blocks.
+    std::vector<offset_t*> blocks_;
+
+    /// frees a block allocated by allocate_block().
+    struct block_deleter
+    {
+	bool huge_;
+	explicit block_deleter(const bool huge = false) : huge_(huge) {}
+	void operator()(offset_t* p) const { if (huge_) doj::hugepagefree(p); else delete[] p; }
+    };
+
+    /// the blocks allocated by this object.
+    std::vector<std::unique_ptr<offset_t, block_deleter>> owned_;
+
+    /// number of bytes of the blocks in owned_.
+    uint64_t allocated_;
+
+    /// number of offsets the last block can hold.
+    uint64_t capacity_;
+
+    /// number of stored offsets.
+    std::atomic<uint64_t> entries_;
+
+    /// the first mapped_entries_ offsets are read only memory and kept valid by keep_alive_.
+    uint64_t mapped_entries_;
+    std::shared_ptr<const void> keep_alive_;
+
+    /// allocate a block for num offsets, a full block uses huge pages.
+    offset_t* allocate_block(const uint64_t num)
+    {
+	const bool huge = num == block_size;
+	offset_t* b = huge ? static_cast<offset_t*>(doj::hugepagealloc(num * sizeof(offset_t))) : new offset_t[num];
+	if (! b) {
+	    throw std::bad_alloc();
+	}
+	owned_.push_back(std::unique_ptr<offset_t, block_deleter>(b, block_deleter(huge)));
+	allocated_ += num * sizeof(offset_t);
+	capacity_ = num;
+	return b;
+    }
+
+public:
+    /// construct a table with the first line starting at offset first.
+    explicit line_offset_table(const offset_t first = 0) :
+	allocated_(0),
+	capacity_(0),
+	entries_(0),
+	mapped_entries_(0)
+    {
+	push_back(first);
+    }
+
+    /// @return the number of lines in the table.
+    uint64_t size() const { return entries() - 1; }
+
+    /// @return the number of stored offsets, which is size() + 1.
+    uint64_t entries() const { return entries_.load(std::memory_order_acquire); }
+
+    /// @return the offset at index idx.
+    offset_t at(const uint64_t idx) const
+    {
+	assert(idx < entries());
+	return blocks_[idx >> block_bits][idx & (block_size - 1)];
+    }
+
+    /**
+     * binary search for the line containing an offset.
+     * @param o offset into the file.
+     * @param lo first index to check.
+     * @param hi last index to check, at(hi) has to be > o.
+     * @return the first index in [lo, hi] with at(index) > o, which is the number of the line containing o.
+     */
+    uint64_t upper_bound(const offset_t o, uint64_t lo, uint64_t hi) const
+    {
+	assert(hi < entries() && at(hi) > o);
+	while(lo < hi) {
+	    const uint64_t mid = lo + (hi - lo) / 2;
+	    if (at(mid) > o) {
+		hi = mid;
+	    } else {
+		lo = mid + 1;
+	    }
+	}
+	return lo;
+    }
+
+    /// @return the offset following the last line.
+    offset_t back() const { return at(entries() - 1); }
+
+    /**
+     * reserve memory for the block pointers of a table with up to entries offsets.
+     * Call this function before other threads read the table while offsets are added.
+     */
+    void reserve(const uint64_t entries)
+    {
+	blocks_.reserve((entries >> block_bits) + 1);
+    }
+
+    /// add a line to the table. next is the offset following the line.
+    void push_back(const offset_t next)
+    {
+	const uint64_t entries = entries_.load(std::memory_order_relaxed);
+	const uint64_t block = entries >> block_bits;
+	const uint64_t pos = entries & (block_size - 1);
+	if (block == blocks_.size()) {
+	    // the table of a file with more than one block is large
+	    blocks_.push_back(allocate_block(block == 0 ? uint64_t(min_block_size) : uint64_t(block_size)));
+	} else if ((block << block_bits) < mapped_entries_ || pos == capacity_) {
+	    // the last block is read only memory or full, copy it before it is modified
+	    const uint64_t grown = (block_growth * pos < min_block_size) ? min_block_size : block_growth * pos;
+	    offset_t* b = allocate_block((grown < block_size) ? grown : uint64_t(block_size));
+	    memcpy(b, blocks_[block], pos * sizeof(offset_t));
+	    blocks_[block] = b;
+	    if (mapped_entries_ > (block << block_bits)) {
+		mapped_entries_ = block << block_bits;
+	    }
+	}
+	blocks_[block][pos] = next;
+	entries_.store(entries + 1, std::memory_order_release);
+    }
+
+    /**
+     * replace the table with offsets stored in read only memory.
+     * The memory is used directly and not copied.
+     * @param data pointer to the offsets.
+     * @param entries number of offsets, has to be >= 1.
+     * @param keep_alive object that keeps data valid as long as this table uses it.
+     */
+    void assign(const offset_t* data, const uint64_t entries, std::shared_ptr<const void> keep_alive)
+    {
+	assert(entries >= 1);
+	blocks_.clear();
+	owned_.clear();
+	allocated_ = 0;
+	capacity_ = 0;
+	for(uint64_t i = 0; i < entries; i += block_size) {
+	    blocks_.push_back(const_cast<offset_t*>(data + i));
+	}
+	entries_ = entries;
+	mapped_entries_ = entries;
+	keep_alive_ = keep_alive;
+    }
+
+    /**
+     * call f for each block of offsets.
+     * @param f function object with the signature f(const offset_t* data, uint64_t num).
+     */
+    template <typename F>
+    void for_each_block(F f) const
+    {
+	const uint64_t entries = entries_;
+	for(uint64_t i = 0; i < entries; i += block_size) {
+	    const uint64_t num = (entries - i < block_size) ? entries - i : block_size;
+	    f(blocks_[i >> block_bits], num);
+	}
+    }
+
+    /// @return number of bytes allocated by the table. Read only memory from assign() is not included.
+    uint64_t memory_usage() const
+    {
+	return allocated_ + blocks_.capacity() * sizeof(blocks_[0]);
+    }
+};
@@ -0,0 +1,305 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "literal_prefilter.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define LITERAL_PREFILTER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    inline bool is_digit(const char c) { return c >= '0' && c <= '9'; }
+    inline bool is_alnum(const char c) { return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+    inline char to_lower(const char c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; }
+    inline char to_upper(const char c) { return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c; }
+    inline bool is_xdigit(const char c) { return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+
+    /// @return true if c has a special meaning in an ECMAScript regular expression.
+    inline bool is_meta(const char c)
+    {
+	return c != 0 && strchr("^$\\.*+?()[]{}|", c) != nullptr;
+    }
+
+    /**
+     * skip an escape sequence including its argument, like the hex digits of \x41 or the letter of \cJ.
+     * @param i index of the backslash.
+     * @return index following the escape sequence.
+     */
+    size_t skip_escape(const std::string& r, size_t i)
+    {
+	if (i + 1 >= r.size()) {
+	    return r.size();
+	}
+	const char c = r[i+1];
+	i += 2;
+	if (c == 'c') {
+	    return (i < r.size()) ? i + 1 : i;
+	}
+	if (c == 'x' || c == 'u') {
+	    const size_t e = std::min(r.size(), i + (c == 'x' ? 2 : 4));
+	    while(i < e && is_xdigit(r[i])) {
+		++i;
+	    }
+	} else if (is_digit(c)) {
+	    // an octal character or a back reference
+	    while(i < r.size() && is_digit(r[i])) {
+		++i;
+	    }
+	}
+	return i;
+    }
+
+    /**
+     * skip a bracket expression.
+     * @param i index of the '[' character.
+     * @return index following the closing ']' character.
+     */
+    size_t skip_bracket(const std::string& r, size_t i)
+    {
+	++i;
+	while(i < r.size() && r[i] != ']') {
+	    if (r[i] == '\\') {
+		i = skip_escape(r, i);
+	    } else if (r[i] == '[' && i + 1 < r.size() && strchr(":.=", r[i+1]) != nullptr) {
+		// skip character classes like [:alpha:]
+		const char term[3] = { r[i+1], ']', 0 };
+		const size_t e = r.find(term, i + 2);
+		i = (e == std::string::npos) ? r.size() : e + 2;
+	    } else {
+		++i;
+	    }
+	}
+	return i + 1;
+    }
+
+    /**
+     * skip a group.
+     * @param i index of the '(' character.
+     * @return index following the closing ')' character.
+     */
+    size_t skip_group(const std::string& r, size_t i)
+    {
+	unsigned depth = 0;
+	while(i < r.size()) {
+	    switch(r[i]) {
+	    case '\\': i = skip_escape(r, i); continue;
+	    case '[': i = skip_bracket(r, i); continue;
+	    case '(': ++depth; break;
+	    case ')':
+		if (--depth == 0) {
+		    return i + 1;
+		}
+		break;
+	    }
+	    ++i;
+	}
+	return i;
+    }
+
+    /**
+     * parse an optional quantifier.
+     * @param i index following an atom.
+     * @param[out] min minimum number of repetitions of the atom.
+     * @param[out] single true if the atom is matched at most once.
+     * @return index following the quantifier.
+     */
+    size_t quantifier(const std::string& r, size_t i, unsigned& min, bool& single)
+    {
+	min = 1;
+	single = true;
+	if (i >= r.size()) {
+	    return i;
+	}
+	switch(r[i]) {
+	case '*': min = 0; single = false; ++i; break;
+	case '+': single = false; ++i; break;
+	case '?': min = 0; ++i; break;
+	case '{': {
+	    size_t j = i + 1;
+	    unsigned n = 0, m = 0;
+	    const size_t n_beg = j;
+	    for(; j < r.size() && is_digit(r[j]); ++j) {
+		n = (n > 100000) ? n : n * 10 + (r[j] - '0');
+	    }
+	    if (j == n_beg) {
+		return i;
+	    }
+	    m = n;
+	    if (j < r.size() && r[j] == ',') {
+		++j;
+		const size_t m_beg = j;
+		for(m = 0; j < r.size() && is_digit(r[j]); ++j) {
+		    m = (m > 100000) ? m : m * 10 + (r[j] - '0');
+		}
+		if (j == m_beg) {
+		    m = 2; // no upper bound
+		}
+	    }
+	    if (j >= r.size() || r[j] != '}') {
+		return i;
+	    }
+	    min = n;
+	    single = m <= 1;
+	    i = j + 1;
+	    break;
+	}
+	default:
+	    return i;
+	}
+	// skip the non-greedy modifier
+	if (i < r.size() && r[i] == '?') {
+	    ++i;
+	}
+	return i;
+    }
+
+    /// @return true if p starts with the lower case literal lit, ignoring the case of ASCII letters. The first character is not compared.
+    inline bool equal_icase(const char* p, const std::string& lit)
+    {
+	for(size_t i = 1; i < lit.size(); ++i) {
+	    if (to_lower(p[i]) != lit[i]) {
+		return false;
+	    }
+	}
+	return true;
+    }
+}
+
+literal_prefilter::literal_prefilter(const std::string& r, const bool icase) :
+    icase_(icase),
+    pure_(true)
+{
+    // split the regular expression into runs of required literal characters and keep the longest run
+    std::string run;
+    auto end_run = [&]() {
+	if (run.size() > literal_.size()) {
+	    literal_ = run;
+	}
+	run.clear();
+    };
+
+    size_t i = 0;
+    while(i < r.size()) {
+	const char c = r[i];
+	bool lit = false;
+	char ch = c;
+	size_t next = i + 1;
+	if (c == '|') {
+	    // an alternative at the top level: no character is required
+	    literal_.clear();
+	    pure_ = false;
+	    return;
+	} else if (c == '\\') {
+	    // \x, \u, \c and octal escapes are no literal characters, their arguments are skipped
+	    next = skip_escape(r, i);
+	    ch = (i + 1 < r.size()) ? r[i+1] : 0;
+	    if (ch != 0 && !is_alnum(ch)) {
+		lit = true;
+	    } else if (ch == 't') {
+		lit = true;
+		ch = '\t';
+	    }
+	} else if (c == '[') {
+	    next = skip_bracket(r, i);
+	} else if (c == '(') {
+	    next = skip_group(r, i);
+	} else if (! is_meta(c)) {
+	    lit = true;
+	}
+
+	// the case of non ASCII characters depends on the regular expression engine
+	if (lit && icase_) {
+	    if (static_cast<unsigned char>(ch) >= 0x80) {
+		lit = false;
+	    } else {
+		ch = to_lower(ch);
+	    }
+	}
+
+	unsigned min;
+	bool single;
+	i = quantifier(r, next, min, single);
+	if (i != next || !lit) {
+	    pure_ = false;
+	}
+
+	if (!lit || min == 0) {
+	    end_run();
+	    continue;
+	}
+	run += ch;
+	if (! single) {
+	    // the following characters are not directly after this character
+	    end_run();
+	}
+    }
+    end_run();
+
+    if (literal_.empty()) {
+	pure_ = false;
+    }
+}
+
+const char*
+literal_prefilter::find(const char* beg, const char* end) const
+{
+    const size_t n = literal_.size();
+    if (n == 0) {
+	return beg;
+    }
+    if (static_cast<size_t>(end - beg) < n) {
+	return nullptr;
+    }
+    // the last position the literal can start at
+    const char* const last = end - n;
+
+    if (! icase_) {
+#if defined(__GLIBC__)
+	return static_cast<const char*>(memmem(beg, end - beg, literal_.data(), n));
+#else
+	for(const char* p = beg; p <= last; ++p) {
+	    p = static_cast<const char*>(memchr(p, literal_[0], last - p + 1));
+	    if (! p) {
+		return nullptr;
+	    }
+	    if (memcmp(p + 1, literal_.data() + 1, n - 1) == 0) {
+		return p;
+	    }
+	}
+	return nullptr;
+#endif
+    }
+
+    // search both cases of the first character, then compare the remaining characters
+    const char lower = literal_[0];
+    const char upper = to_upper(lower);
+    const char* p = beg;
+#if LITERAL_PREFILTER_SSE2
+    const __m128i l16 = _mm_set1_epi8(lower);
+    const __m128i u16 = _mm_set1_epi8(upper);
+    for(; p + 16 <= end && p <= last; p += 16) {
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, l16), _mm_cmpeq_epi8(v, u16)));
+	while(mask) {
+	    const char* c = p + __builtin_ctz(mask);
+	    if (c > last) {
+		return nullptr;
+	    }
+	    if (equal_icase(c, literal_)) {
+		return c;
+	    }
+	    mask &= mask - 1;
+	}
+    }
+#endif
+    for(; p <= last; ++p) {
+	if ((*p == lower || *p == upper) && equal_icase(p, literal_)) {
+	    return p;
+	}
+    }
+    return nullptr;
+}
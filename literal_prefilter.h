@@ -0,0 +1,49 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <string>
+
+/**
+ * find a literal string that every match of a regular expression has to contain.
+ * If a line does not contain the literal, the regular expression can not match the line
+ * and the slower regular expression engine does not need to search the line.
+ */
+class literal_prefilter
+{
+    /// the required literal; lower case if icase_ is true.
+    std::string literal_;
+    bool icase_;
+    /// true if the regular expression is equal to literal_.
+    bool pure_;
+
+public:
+    /// construct a prefilter without literal, which does not reject anything.
+    literal_prefilter() : icase_(false), pure_(false) {}
+
+    /**
+     * extract the longest required literal of a regular expression.
+     * @param rgx regular expression string in ECMAScript syntax without slashes and flags.
+     * @param icase true if the regular expression ignores the case of ASCII letters.
+     */
+    literal_prefilter(const std::string& rgx, const bool icase);
+
+    /// @return the required literal; empty string if no literal was found.
+    const std::string& literal() const { return literal_; }
+
+    /// @return true if the literal is searched ignoring the case of ASCII letters.
+    bool icase() const { return icase_; }
+
+    /// @return true if the regular expression only consists of the literal, so no regular expression engine is needed.
+    bool pure() const { return pure_; }
+
+    /**
+     * @return pointer to the first occurrence of the literal in [beg, end); nullptr if the literal was not found.
+     * If the literal is empty, return beg.
+     */
+    const char* find(const char* beg, const char* end) const;
+
+    /// @return false if the regular expression can not match [beg, end).
+    bool may_match(const char* beg, const char* end) const { return find(beg, end) != nullptr; }
+};
@@ -0,0 +1,137 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "literal_prefilter.h"
+#include "regex_index.h"
+#include <regex>
+
+TEST(literal_prefilter, finds_longest_required_literal)
+{
+    ASSERT_EQ(std::string("ERROR"), literal_prefilter("ERROR", false).literal());
+    ASSERT_EQ(std::string("user_id="), literal_prefilter("user_id=\\d+", false).literal());
+    ASSERT_EQ(std::string(" failed"), literal_prefilter("^\\d+ failed", false).literal());
+    ASSERT_EQ(std::string("abc"), literal_prefilter("x?abc", false).literal());
+    ASSERT_EQ(std::string("ab"), literal_prefilter("ab+c", false).literal());
+    ASSERT_EQ(std::string("xyz"), literal_prefilter("a*xyz", false).literal());
+    ASSERT_EQ(std::string("a.b"), literal_prefilter("a\\.b", false).literal());
+    ASSERT_EQ(std::string("end"), literal_prefilter("(foo|bar)end", false).literal());
+    ASSERT_EQ(std::string("longer"), literal_prefilter("ab[0-9]longer{1}", false).literal());
+    ASSERT_EQ(std::string("ab"), literal_prefilter("abc{0,1}", false).literal());
+    ASSERT_EQ(std::string("x"), literal_prefilter("[[:alpha:]]x", false).literal());
+    ASSERT_EQ(std::string("warn"), literal_prefilter("WaRn", true).literal());
+}
+
+TEST(literal_prefilter, no_literal_for_alternatives)
+{
+    ASSERT_EQ(std::string(""), literal_prefilter("error|warning", false).literal());
+    ASSERT_EQ(std::string(""), literal_prefilter(".*", false).literal());
+    ASSERT_EQ(std::string(""), literal_prefilter("\\d+", false).literal());
+    ASSERT_EQ(std::string(""), literal_prefilter("", false).literal());
+    ASSERT_FALSE(literal_prefilter("", false).pure());
+}
+
+TEST(literal_prefilter, detects_pure_literals)
+{
+    ASSERT_TRUE(literal_prefilter("ERROR", false).pure());
+    ASSERT_TRUE(literal_prefilter("disk full", true).pure());
+    ASSERT_TRUE(literal_prefilter("a\\.b\\(c\\)", false).pure());
+    ASSERT_FALSE(literal_prefilter("^ERROR", false).pure());
+    ASSERT_FALSE(literal_prefilter("ERRORS?", false).pure());
+    ASSERT_FALSE(literal_prefilter("ERROR\\d", false).pure());
+    // non ASCII characters are not folded by the prefilter
+    ASSERT_FALSE(literal_prefilter("caf\xc3\xa9", true).pure());
+    ASSERT_TRUE(literal_prefilter("caf\xc3\xa9", false).pure());
+}
+
+TEST(literal_prefilter, find_ignores_case)
+{
+    const std::string s = "0123456789abcdef some text with a Warning: in the middle of the line";
+    literal_prefilter p("WARNING:", true);
+    ASSERT_EQ(s.data() + s.find("Warning"), p.find(s.data(), s.data() + s.size()));
+    // the literal at the very end of the range
+    const std::string e = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxwarning:";
+    ASSERT_EQ(e.data() + 32, p.find(e.data(), e.data() + e.size()));
+    ASSERT_EQ(nullptr, p.find(e.data(), e.data() + e.size() - 1));
+}
+
+namespace {
+    /// assert that regex_index with the prefilter finds the same lines as std::regex.
+    void expect_std_regex_results(const std::vector<std::string>& lines, const std::vector<std::string>& patterns)
+    {
+	for(auto& p : patterns) {
+	    for(const std::string flags : { "", "i", "!", "i!" }) {
+		std::regex_constants::syntax_option_type fl = std::regex::ECMAScript;
+		if (flags.find('i') != std::string::npos) {
+		    fl |= std::regex::icase;
+		}
+		const std::regex rgx(p, fl);
+		const bool positive = flags.find('!') == std::string::npos;
+
+		regex_index ri("/" + p + "/" + flags);
+		lineNum_vector_t expected;
+		line_number_t num = 1;
+		for(auto& l : lines) {
+		    ri.match(line_t(l.data(), l.data() + l.size(), nullptr, num));
+		    if (std::regex_search(l, rgx) == positive) {
+			expected.push_back(num);
+		    }
+		    ++num;
+		}
+		ASSERT_EQ(expected, ri.lineNum_vector()) << "/" << p << "/" << flags;
+	    }
+	}
+    }
+}
+
+TEST(literal_prefilter, regex_index_results_are_identical_to_std_regex)
+{
+    const std::vector<std::string> lines = {
+	"",
+	"2016-02-01 12:00:01 INFO user_id=42 login",
+	"2016-02-01 12:00:02 ERROR disk full",
+	"2016-02-01 12:00:03 error: retry after Error",
+	"abcabcabc abbc ac",
+	"tab\tseparated\tvalues",
+	"caf\xc3\xa9 CAF\xc3\x89",
+	"a.b(c) a+b",
+	"ERRORS",
+	"user_id=",
+    };
+    const std::vector<std::string> patterns = {
+	"ERROR", "error", "user_id=\\d+", "ERRORS?", "disk full", "ab+c", "(abc){3}", "a\\.b\\(c\\)",
+	"\\tseparated", "caf\xc3\xa9", "^2016.*INFO", "error|full", "ab{2}c", "\\bretry\\b", "a\\+b",
+    };
+    expect_std_regex_results(lines, patterns);
+}
+
+TEST(literal_prefilter, skips_arguments_of_escapes)
+{
+    // the arguments of the escapes are not literal characters
+    ASSERT_EQ(std::string("BC"), literal_prefilter("\\x41BC", false).literal());
+    ASSERT_EQ(std::string("BC"), literal_prefilter("\\u0041BC", false).literal());
+    ASSERT_EQ(std::string("ab"), literal_prefilter("\\cAab", false).literal());
+    ASSERT_EQ(std::string("ab"), literal_prefilter("\\0ab", false).literal());
+    ASSERT_EQ(std::string("ab"), literal_prefilter("(x)\\1ab", false).literal());
+    ASSERT_EQ(std::string("end"), literal_prefilter("[\\x5d]end", false).literal());
+    ASSERT_FALSE(literal_prefilter("\\x41BC", false).pure());
+    ASSERT_FALSE(literal_prefilter("\\u0041", false).pure());
+    ASSERT_FALSE(literal_prefilter("\\cJab", false).pure());
+
+    const std::vector<std::string> lines = {
+	"",
+	"ABC 41BC",
+	"xABCx",
+	"0041BC",
+	"\x01" "ab Jab",
+	"\x01" "AB",
+	std::string("nul\0ab", 6),
+	"0ab",
+	"]end",
+    };
+    const std::vector<std::string> patterns = {
+	"\\x41BC", "\\u0041BC", "\\cAab", "\\cJab", "\\0ab", "[\\x5d]end", "\\x41\\x42C",
+    };
+    expect_std_regex_results(lines, patterns);
+}
@@ -50,8 +50,10 @@
 #include "to_wide.h"
 #endif
 
+#include <cstdlib>
 #include <iostream>
 #include <map>
+#include <mutex>
 
 #include "memorymap.h"
 
@@ -67,8 +69,12 @@ namespace doj
     struct mmap_info {
 	int fh;
 	uint64_t filelen;
+	/// length of the mapped address range, which is >= filelen.
+	uint64_t maplen;
 	string filename;
 	bool readonly;
+	/// set if the file was found to be smaller than filelen, see memorymaptruncated(void*).
+	bool truncated;
     };
 #endif
 
@@ -93,14 +99,18 @@ namespace doj
     */
     static memorymap_registry_t memorymap_registry;
 
+    /// the memory maps can be created and queried by several threads.
+    static mutex memorymap_registry_mutex;
+
 #ifdef __unix__
 
     //lint -esym(952,filename)
-    void* memorymap(const char* filename, const bool readonly_)
+    void* memorymap(const char* filename, const bool readonly_, const uint64_t reserve, const bool populate)
     {
 	struct mmap_info info;
 	info.filename=filename;
 	info.readonly=readonly_;
+	info.truncated=false;
 
 	// get file size
 	struct stat buf;
@@ -119,6 +129,15 @@ namespace doj
 		return 0;
 	    }
 	info.filelen=static_cast<uint64_t>(buf.st_size);
+	// a read only map can reach past the end of the file, those pages become valid when the file grows
+	info.maplen=info.readonly ? info.filelen + reserve : info.filelen;
+	if(info.maplen != static_cast<size_t>(info.maplen))
+	    {
+#ifdef DOJDEBUG
+		cerr << "memorymap(): " << filename << " is too large to map" << endl;
+#endif
+		return 0;
+	    }
 
 	// open file
 	info.fh=::open(filename, info.readonly?O_RDONLY:O_RDWR);
@@ -131,9 +150,19 @@ namespace doj
 	    }
 
 	// memory map file
+	int flags=info.readonly?MAP_PRIVATE:MAP_SHARED;
+#ifdef MAP_POPULATE
+	// the pages past the end of the file can not be populated, they are skipped
+	if(populate)
+	    {
+		flags|=MAP_POPULATE;
+	    }
+#else
+	(void)populate;
+#endif
 	//lint -esym(953,w) w should be non const
-	void *w=mmap(NULL, static_cast<unsigned>(info.filelen), info.readonly?PROT_READ:(PROT_READ|PROT_WRITE), info.readonly?MAP_PRIVATE:MAP_SHARED, info.fh, static_cast<off_t>(0));
-	if(!w)
+	void *w=mmap(NULL, static_cast<size_t>(info.maplen), info.readonly?PROT_READ:(PROT_READ|PROT_WRITE), flags, info.fh, static_cast<off_t>(0));
+	if(w == MAP_FAILED)
 	    {
 		const int e=errno;
 #ifdef DOJDEBUG
@@ -145,6 +174,7 @@ namespace doj
 	    }
 
 	// make an entry into registry
+	lock_guard<mutex> lock(memorymap_registry_mutex);
 	memorymap_registry[w]=info;
 
 	return w;
@@ -152,21 +182,23 @@ namespace doj
 
     int memoryunmap(void *mem)
     {
+	unique_lock<mutex> lock(memorymap_registry_mutex);
 	if(memorymap_registry.count(mem))
 	    {
 		struct mmap_info info=memorymap_registry[mem];
 		//lint -e{534} ignore return value
 		memorymap_registry.erase(mem);
+		lock.unlock();
 		if(!info.readonly)
 		    {
-			if(msync(mem, static_cast<unsigned>(info.filelen), 0) < 0)
+			if(msync(mem, static_cast<size_t>(info.filelen), 0) < 0)
 			    {
 #ifdef DOJDEBUG
 				clog << "memoryunmap(): could not msync()" << endl;
 #endif
 			    }
 		    }
-		if(munmap(mem, static_cast<unsigned>(info.filelen)) < 0)
+		if(munmap(mem, static_cast<size_t>(info.maplen)) < 0)
 		    {
 #ifdef DOJDEBUG
 			cerr << "memoryunmap(): could not unmap " << info.filename << " : " << strerror(errno) << endl;
@@ -186,10 +218,135 @@ namespace doj
 #endif
 	return -1;
     }
+
+    uint64_t memorymapgrow(void *mem)
+    {
+	lock_guard<mutex> lock(memorymap_registry_mutex);
+	auto it=memorymap_registry.find(mem);
+	if(it == memorymap_registry.end())
+	    {
+		return 0;
+	    }
+	struct mmap_info& info=it->second;
+	struct stat buf;
+	if(fstat(info.fh, &buf) < 0)
+	    {
+		return info.filelen;
+	    }
+	const uint64_t filelen=static_cast<uint64_t>(buf.st_size);
+	if(filelen > info.filelen)
+	    {
+		info.filelen=(filelen < info.maplen) ? filelen : info.maplen;
+	    }
+	else if(filelen < info.filelen)
+	    {
+		info.truncated=true;
+	    }
+	return info.filelen;
+    }
+
+    bool memorymaptruncated(void *mem)
+    {
+	lock_guard<mutex> lock(memorymap_registry_mutex);
+	auto it=memorymap_registry.find(mem);
+	if(it == memorymap_registry.end())
+	    {
+		return false;
+	    }
+	struct mmap_info& info=it->second;
+	struct stat buf;
+	// a file that grew again after it was truncated is only noticed if it was checked meanwhile
+	if(!info.truncated && fstat(info.fh, &buf) == 0 && static_cast<uint64_t>(buf.st_size) < info.filelen)
+	    {
+		info.truncated=true;
+	    }
+	return info.truncated;
+    }
+
+    int memorymapadvise(void *mem, const memorymap_access access)
+    {
+	lock_guard<mutex> lock(memorymap_registry_mutex);
+	auto it=memorymap_registry.find(mem);
+	if(it == memorymap_registry.end())
+	    {
+		return -1;
+	    }
+	int advice=MADV_NORMAL;
+	if(access == memorymap_sequential)
+	    {
+		advice=MADV_SEQUENTIAL;
+	    }
+	else if(access == memorymap_random)
+	    {
+		advice=MADV_RANDOM;
+	    }
+	// the advice includes the reserved address space of a growing file
+	if(madvise(mem, static_cast<size_t>(it->second.maplen), advice) < 0)
+	    {
+#ifdef DOJDEBUG
+		cerr << "memorymapadvise(): could not madvise " << it->second.filename << " : " << strerror(errno) << endl;
+#endif
+		return -1;
+	    }
+	return 0;
+    }
+
+    int memoryprefetch(const void *addr, const uint64_t len, const bool populate)
+    {
+	if(len == 0)
+	    {
+		return 0;
+	    }
+	// madvise() needs an address aligned to a page
+	static const uintptr_t page=static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	const uintptr_t beg=reinterpret_cast<uintptr_t>(addr) & ~(page-1);
+	const uintptr_t end=reinterpret_cast<uintptr_t>(addr)+static_cast<uintptr_t>(len);
+	if(!populate)
+	    {
+		return madvise(reinterpret_cast<void*>(beg), end-beg, MADV_WILLNEED);
+	    }
+#ifdef MADV_POPULATE_READ
+	if(madvise(reinterpret_cast<void*>(beg), end-beg, MADV_POPULATE_READ) == 0)
+	    {
+		return 0;
+	    }
+	if(errno != EINVAL)
+	    {
+		return -1;
+	    }
+	// the kernel does not support MADV_POPULATE_READ, read the pages instead
+#endif
+	volatile char c=0;
+	for(uintptr_t p=beg; p < end; p+=page)
+	    {
+		c=*reinterpret_cast<const char*>(p);
+	    }
+	(void)c;
+	return 0;
+    }
+
+    void* hugepagealloc(const size_t len)
+    {
+	void *mem=0;
+	if(posix_memalign(&mem, hugepage_size, len) != 0)
+	    {
+		return 0;
+	    }
+#ifdef MADV_HUGEPAGE
+	//lint -e{534} transparent huge pages are only a hint
+	madvise(mem, len, MADV_HUGEPAGE);
+#endif
+	return mem;
+    }
+
+    void hugepagefree(void *mem)
+    {
+	free(mem);
+    }
 #endif // __unix__
 
 #ifdef _WIN32
-    void* memorymap(const char* filename, const bool readonly)
+    void* memorymap(const char* filename, const bool readonly, const uint64_t, const bool)
     {
 	struct mmap_info info;
 	info.filename=filename;
@@ -246,16 +403,19 @@ namespace doj
 		return 0;
 	    }
 
+	lock_guard<mutex> lock(memorymap_registry_mutex);
 	memorymap_registry[mem]=info;
 	return mem;
     }
 
     int memoryunmap(void *mem)
     {
+	unique_lock<mutex> lock(memorymap_registry_mutex);
 	if(memorymap_registry.count(mem))
 	    {
 		struct mmap_info info=memorymap_registry[mem];
 		memorymap_registry.erase(mem);
+		lock.unlock();
 		UnmapViewOfFile(mem);
 		CloseHandle(info.map);
 		CloseHandle(info.file);
@@ -267,11 +427,61 @@ namespace doj
 #endif
 	return -1;
     }
+
+    uint64_t memorymapgrow(void *mem)
+    {
+	// a view of a read only file mapping can not reach past the end of the file
+	return memorymapsize(mem);
+    }
+
+    bool memorymaptruncated(void *)
+    {
+	// a file can not be truncated while a view of it is mapped
+	return false;
+    }
+
+    int memorymapadvise(void *mem, const memorymap_access)
+    {
+	// the file is opened with FILE_FLAG_SEQUENTIAL_SCAN, there is no advice for a view
+	return memorymapsize(mem) ? 0 : -1;
+    }
+
+    int memoryprefetch(const void *addr, const uint64_t len, const bool populate)
+    {
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress=const_cast<void*>(addr);
+	range.NumberOfBytes=static_cast<SIZE_T>(len);
+	if(!populate)
+	    {
+		return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) ? 0 : -1;
+	    }
+	// read one byte of each page, so the pages are mapped
+	const char *p=static_cast<const char*>(addr);
+	volatile char c=0;
+	for(uint64_t i=0; i < len; i+=4096)
+	    {
+		c=p[i];
+	    }
+	(void)c;
+	return 0;
+    }
+
+    void* hugepagealloc(const size_t len)
+    {
+	return _aligned_malloc(len, hugepage_size);
+    }
+
+    void hugepagefree(void *mem)
+    {
+	_aligned_free(mem);
+    }
 #endif // _WIN32
 
     uint64_t memorymapsize(void *mem)
     {
-	return (memorymap_registry.count(mem)) ? memorymap_registry[mem].filelen : 0;
+	lock_guard<mutex> lock(memorymap_registry_mutex);
+	auto it=memorymap_registry.find(mem);
+	return (it != memorymap_registry.end()) ? it->second.filelen : 0;
     }
 
 }
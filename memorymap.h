@@ -36,9 +36,11 @@ namespace doj
        retrieved with the memorymapsize(void*) function.
        @param filename pathname of file on local filesystem
        @param readonly if true map filename exclusive and write protected, if false map filename shared and writable
+       @param reserve if readonly is true, map reserve bytes of address space past the end of the file, so the map can grow with the file, see memorymapgrow(void*)
+       @param populate if true read the file into memory before the function returns, so accessing the memory does not cause page faults. Only supported on Linux.
        @return a pointer to the memory mapped file, NULL on error
     */
-    void* memorymap(const char *filename, const bool readonly=true);
+    void* memorymap(const char *filename, const bool readonly=true, const uint64_t reserve=0, const bool populate=false);
 
     /**
        map filename into memory. The size of the memory area can be
@@ -47,9 +49,9 @@ namespace doj
        @param readonly if true map filename exclusive and write protected, if false map filename shared and writable
        @return a pointer to the memory mapped file, NULL on error
     */
-    inline void* memorymap(const std::string& filename, const bool readonly=true)
+    inline void* memorymap(const std::string& filename, const bool readonly=true, const uint64_t reserve=0, const bool populate=false)
     {
-	return memorymap(filename.c_str(), readonly);
+	return memorymap(filename.c_str(), readonly, reserve, populate);
     }
 
     /**
@@ -74,6 +76,81 @@ namespace doj
     */
     uint64_t memorymapsize(void *mem);
 
+    /**
+       grow a memory map with its file. If the file was appended to,
+       the size of the memory area is increased up to the reserved
+       address space, see memorymap(const char*, const bool, const uint64_t).
+       The memory area is not moved. A map does not shrink if the file was truncated.
+       @param mem pointer to the beginning of the memory mapped file, as
+       retrieved from the memorymap(...) function.
+       @return the new size of the memory area. 0 if the *mem does not
+       resolve a valid start of a memory map.
+    */
+    uint64_t memorymapgrow(void *mem);
+
+    /**
+       check if the file of a memory map is smaller than the memory
+       area, e.g. because it was truncated by logrotate's copytruncate.
+       Reading a page past the new end of the file raises SIGBUS, so a
+       file that can be truncated should be checked before its pages
+       are read, and mapped again if it was truncated. Once a
+       truncation was noticed, by this function or by
+       memorymapgrow(void*), the function returns true even if the file
+       grew again.
+       @param mem pointer to the beginning of the memory mapped file, as
+       retrieved from the memorymap(...) function.
+       @return true if the file was truncated.
+    */
+    bool memorymaptruncated(void *mem);
+
+    /// expected access pattern of a memory map, see memorymapadvise(void*, const memorymap_access).
+    enum memorymap_access {
+	/// no special treatment.
+	memorymap_normal,
+	/// the memory area is read from the beginning to the end, pages are read ahead aggressively and can be freed soon after they were read.
+	memorymap_sequential,
+	/// the memory area is read at random positions, pages are not read ahead.
+	memorymap_random,
+    };
+
+    /**
+       advise the operating system how a memory map is accessed, so it
+       can read ahead and free pages accordingly. On platforms without
+       madvise() this function does nothing.
+       @param mem pointer to the beginning of the memory mapped file, as
+       retrieved from the memorymap(...) function.
+       @param access expected access pattern.
+       @return 0 on success. -1 on failure.
+    */
+    int memorymapadvise(void *mem, const memorymap_access access);
+
+    /**
+       read ahead a part of a memory map.
+       @param addr first byte to read ahead.
+       @param len number of bytes to read ahead.
+       @param populate if false the operating system starts to read the
+       pages in the background and the function returns immediately. If
+       true the function returns after the pages were read and mapped, so
+       accessing them does not cause page faults.
+       @return 0 on success. -1 on failure.
+    */
+    int memoryprefetch(const void *addr, const uint64_t len, const bool populate);
+
+    /// size of a huge page, see hugepagealloc(const size_t).
+    const size_t hugepage_size = 2*1024*1024;
+
+    /**
+       allocate memory for a large table. The memory is aligned to the
+       size of a huge page. On Linux the kernel is advised to back the
+       memory with transparent huge pages, which reduces page faults and
+       TLB misses when the table is filled and searched.
+       @param len number of bytes to allocate.
+       @return a pointer to the memory, NULL on error. The memory has to be freed with hugepagefree(void*).
+    */
+    void* hugepagealloc(const size_t len);
+
+    /// free memory allocated by hugepagealloc(const size_t).
+    void hugepagefree(void *mem);
 
     /** a wrapper class for doj::memorymap which acts like a pointer. If
 	the object goes out of scope the underlying memory is
@@ -95,9 +172,11 @@ namespace doj
 	/** construct a memory map from a file.
 	    @param fn filename of file in local file system.
 	    @param readonly if true the file is mapped with write protection and exclusive access, if false the memory area can be written to and the file is mapped shared.
+	    @param reserve number of bytes of address space to reserve past the end of the file for a growing file, see grow().
+	    @param populate if true read the file into memory before the constructor returns.
 	*/
-	explicit memorymap_ptr(const std::string& fn, const bool readonly=true) :
-	    p(reinterpret_cast<T*>(memorymap(fn.c_str(), readonly)))
+	explicit memorymap_ptr(const std::string& fn, const bool readonly=true, const uint64_t reserve=0, const bool populate=false) :
+	    p(reinterpret_cast<T*>(memorymap(fn.c_str(), readonly, reserve, populate)))
 	{ }
 
 	~memorymap_ptr() {
@@ -111,6 +190,14 @@ namespace doj
 
 	/// @return size of mapped file in bytes
 	uint64_t size() const { return memorymapsize(p); }
+	/// grow the map with its file, see memorymapgrow(void*). @return size of mapped file in bytes
+	uint64_t grow() { return memorymapgrow(p); }
+	/// @return true if the file was truncated, see memorymaptruncated(void*).
+	bool truncated() const { return memorymaptruncated(p); }
+	/// advise the operating system of the access pattern, see memorymapadvise(void*, const memorymap_access). @return 0 on success
+	int advise(const memorymap_access access) const { return memorymapadvise(p, access); }
+	/// read ahead the elements [beg, end), see memoryprefetch(const void*, const uint64_t, const bool). @return 0 on success
+	int prefetch(const T* beg, const T* end, const bool populate=false) const { return memoryprefetch(beg, (end - beg) * sizeof(T), populate); }
 
 	/// @return mapped file as object reference
 	T& operator*() { return *p; }
@@ -0,0 +1,61 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "memorymap.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <fstream>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+TEST(memorymap, advise_accepts_mapped_files)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    {
+	std::ofstream os(fn, std::ios::binary);
+	os << "line 1\nline 2\n";
+    }
+    doj::memorymap_ptr<char> m(fn, true, 1024*1024);
+    ASSERT_FALSE(!m);
+    ASSERT_EQ(0, m.advise(doj::memorymap_sequential));
+    ASSERT_EQ(0, m.advise(doj::memorymap_random));
+    ASSERT_EQ(0, m.advise(doj::memorymap_normal));
+    ASSERT_EQ("line 1\nline 2\n", std::string(m.begin(), m.end()));
+
+    int not_mapped;
+    ASSERT_EQ(-1, doj::memorymapadvise(&not_mapped, doj::memorymap_random));
+}
+
+#if !defined(_WIN32)
+TEST(memorymap, detects_truncation_of_a_growing_file)
+{
+    TemporaryFile t;
+    const std::string fn = to_utf8(t.filename());
+    const std::string s(3*65536, 'x');
+    {
+	std::ofstream os(fn, std::ios::binary);
+	os << s;
+    }
+    doj::memorymap_ptr<char> m(fn, true, 1024*1024);
+    ASSERT_FALSE(!m);
+    ASSERT_EQ('x', m.get()[2*65536]);
+    ASSERT_FALSE(m.truncated());
+
+    // like logrotate's copytruncate, the truncation is noticed before the pages are read
+    ASSERT_EQ(0, truncate(fn.c_str(), 0));
+    ASSERT_TRUE(m.truncated());
+    // the map stays truncated after the file grew again
+    {
+	std::ofstream os(fn, std::ios::binary);
+	os << s << s;
+    }
+    ASSERT_TRUE(m.truncated());
+
+    int not_mapped;
+    ASSERT_FALSE(doj::memorymaptruncated(&not_mapped));
+}
+#endif
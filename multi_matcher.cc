@@ -0,0 +1,172 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "multi_matcher.h"
+#include <cassert>
+#include <deque>
+
+aho_corasick::aho_corasick(const std::vector<std::string>& literals, const bool icase)
+{
+    for(unsigned c = 0; c < 256; ++c) {
+	fold_[c] = (icase && c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+
+    // build the trie, 0 is the root state and marks missing transitions
+    delta_.assign(256, 0);
+    out_.resize(1);
+    for(unsigned i = 0; i < literals.size(); ++i) {
+	assert(! literals[i].empty());
+	uint32_t s = 0;
+	for(auto ch : literals[i]) {
+	    const unsigned char c = ch;
+	    if (delta_[s * 256 + c] == 0) {
+		delta_[s * 256 + c] = out_.size();
+		out_.resize(out_.size() + 1);
+		delta_.resize(delta_.size() + 256, 0);
+	    }
+	    s = delta_[s * 256 + c];
+	}
+	out_[s].push_back(i);
+    }
+
+    // compute the failure transitions in breadth first order and
+    // replace missing transitions with the transitions of the failure state.
+    std::vector<uint32_t> fail(out_.size(), 0);
+    std::deque<uint32_t> queue;
+    for(unsigned c = 0; c < 256; ++c) {
+	if (delta_[c] != 0) {
+	    queue.push_back(delta_[c]);
+	}
+    }
+    while(! queue.empty()) {
+	const uint32_t s = queue.front();
+	queue.pop_front();
+	const std::vector<unsigned>& o = out_[fail[s]];
+	out_[s].insert(out_[s].end(), o.begin(), o.end());
+	for(unsigned c = 0; c < 256; ++c) {
+	    uint32_t& t = delta_[s * 256 + c];
+	    if (t != 0) {
+		fail[t] = delta_[fail[s] * 256 + c];
+		queue.push_back(t);
+	    } else {
+		t = delta_[fail[s] * 256 + c];
+	    }
+	}
+    }
+}
+
+void
+aho_corasick::scan(const char* beg, const char* end, std::vector<unsigned char>& found) const
+{
+    const uint32_t* delta = delta_.data();
+    uint32_t s = 0;
+    for(const char* p = beg; p != end; ++p) {
+	s = delta[s * 256 + fold_[static_cast<unsigned char>(*p)]];
+	for(auto i : out_[s]) {
+	    found[i] = 1;
+	}
+    }
+}
+
+multi_matcher::multi_matcher(const std::vector<std::shared_ptr<regex_index>>& ri) :
+    ri_(ri),
+    in_set_(ri.size(), 0),
+    candidate_(ri.size()),
+    found_(ri.size())
+{
+    std::vector<std::string> exact, icase;
+    std::vector<regex_with_flags_t> set;
+    for(unsigned i = 0; i < ri_.size(); ++i) {
+	const literal_prefilter& p = ri_[i]->prefilter();
+	if (p.literal().empty()) {
+	    no_literal_.push_back(i);
+	} else if (p.icase()) {
+	    icase.push_back(p.literal());
+	    icase_ri_.push_back(i);
+	} else {
+	    exact.push_back(p.literal());
+	    exact_ri_.push_back(i);
+	}
+	// regular expressions which are not supported by the engine use the std::regex fallback
+	if (! p.pure() && std::string(ri_[i]->engine()) == regex_engine_default()) {
+	    set.push_back(ri_[i]->regex_with_flags());
+	    set_ri_.push_back(i);
+	}
+    }
+
+    if (! exact.empty()) {
+	exact_.reset(new aho_corasick(exact, false));
+	exact_found_.resize(exact.size());
+    }
+    if (! icase.empty()) {
+	icase_.reset(new aho_corasick(icase, true));
+	icase_found_.resize(icase.size());
+    }
+    if (set.size() > 1) {
+	set_ = make_regex_engine_set(set);
+    }
+    if (set_) {
+	for(auto i : set_ri_) {
+	    in_set_[i] = 1;
+	}
+    }
+}
+
+void
+multi_matcher::match(const line_t& line)
+{
+    // find the candidates by their literals
+    std::fill(candidate_.begin(), candidate_.end(), 0);
+    for(auto i : no_literal_) {
+	candidate_[i] = 1;
+    }
+    if (exact_) {
+	std::fill(exact_found_.begin(), exact_found_.end(), 0);
+	exact_->scan(line.beg_, line.end_, exact_found_);
+	for(unsigned j = 0; j < exact_found_.size(); ++j) {
+	    candidate_[exact_ri_[j]] |= exact_found_[j];
+	}
+    }
+    if (icase_) {
+	std::fill(icase_found_.begin(), icase_found_.end(), 0);
+	icase_->scan(line.beg_, line.end_, icase_found_);
+	for(unsigned j = 0; j < icase_found_.size(); ++j) {
+	    candidate_[icase_ri_[j]] |= icase_found_[j];
+	}
+    }
+
+    // search the regular expressions of the candidates
+    bool search_set = false;
+    for(unsigned i = 0; i < ri_.size(); ++i) {
+	found_[i] = 0;
+	if (! candidate_[i]) {
+	    continue;
+	}
+	if (ri_[i]->prefilter().pure()) {
+	    found_[i] = 1;
+	} else if (in_set_[i]) {
+	    search_set = true;
+	} else {
+	    found_[i] = ri_[i]->search(line);
+	}
+    }
+    if (search_set) {
+	if (set_->search(line.beg_, line.end_, set_found_)) {
+	    for(auto j : set_found_) {
+		const unsigned i = set_ri_[j];
+		found_[i] = candidate_[i];
+	    }
+	} else {
+	    for(auto i : set_ri_) {
+		if (candidate_[i]) {
+		    found_[i] = ri_[i]->search(line);
+		}
+	    }
+	}
+    }
+
+    for(unsigned i = 0; i < ri_.size(); ++i) {
+	ri_[i]->add_result(line, found_[i]);
+    }
+}
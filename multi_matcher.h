@@ -0,0 +1,78 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "regex_index.h"
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * an Aho-Corasick automaton that finds several literal strings in one pass.
+ */
+class aho_corasick
+{
+    /// state transition table with 256 entries per state.
+    std::vector<uint32_t> delta_;
+    /// the indexes of the literals found when reaching a state.
+    std::vector<std::vector<unsigned>> out_;
+    /// map every input character, used to ignore the case of ASCII letters.
+    unsigned char fold_[256];
+
+public:
+    /**
+     * build the automaton.
+     * @param literals the literals, which must not be empty strings.
+     *                 If icase is true the literals must be lower case.
+     * @param icase ignore the case of ASCII letters.
+     */
+    aho_corasick(const std::vector<std::string>& literals, const bool icase);
+
+    /**
+     * find the literals in [beg, end).
+     * @param[in,out] found for every literal i found in the text, found[i] is set to 1.
+     */
+    void scan(const char* beg, const char* end, std::vector<unsigned char>& found) const;
+};
+
+/**
+ * match several regex_index objects with a line in one pass over the line.
+ *
+ * The required literals of all regular expressions are found with an Aho-Corasick automaton.
+ * Regular expressions whose literal is not found in the line do not match.
+ * The remaining regular expressions are matched with a combined automaton of the regular
+ * expression engine if it supports this, see make_regex_engine_set(), otherwise one by one.
+ */
+class multi_matcher
+{
+    std::vector<std::shared_ptr<regex_index>> ri_;
+
+    /// automatons for the case sensitive and case insensitive literals.
+    std::unique_ptr<aho_corasick> exact_, icase_;
+    /// map the literal index of exact_ and icase_ to the index in ri_.
+    std::vector<unsigned> exact_ri_, icase_ri_;
+    /// indexes of ri_ without literal.
+    std::vector<unsigned> no_literal_;
+
+    /// combined automaton of the regular expressions that are not pure literals.
+    std::unique_ptr<regex_engine_set> set_;
+    /// map the index in set_ to the index in ri_.
+    std::vector<unsigned> set_ri_;
+    /// true for the indexes of ri_ which are in set_.
+    std::vector<unsigned char> in_set_;
+
+    // buffers for match()
+    std::vector<unsigned char> exact_found_, icase_found_, candidate_, found_;
+    std::vector<int> set_found_;
+
+public:
+    /// @param ri the regex_index objects to match.
+    explicit multi_matcher(const std::vector<std::shared_ptr<regex_index>>& ri);
+
+    /// match line with all regex_index objects and add it to the objects which match.
+    void match(const line_t& line);
+
+    /// @return true if the regular expression engine combined the regular expressions into a single automaton.
+    bool combined() const { return set_ != nullptr; }
+};
@@ -0,0 +1,118 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "multi_matcher.h"
+#include "file_index.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <chrono>
+
+TEST(aho_corasick, finds_overlapping_literals)
+{
+    aho_corasick ac({ "he", "she", "his", "hers" }, false);
+    std::vector<unsigned char> found(4);
+    const std::string s = "ushers";
+    ac.scan(s.data(), s.data() + s.size(), found);
+    const std::vector<unsigned char> expected = { 1, 1, 0, 1 };
+    ASSERT_EQ(expected, found);
+}
+
+TEST(aho_corasick, ignores_case)
+{
+    aho_corasick ac({ "error", "warn" }, true);
+    std::vector<unsigned char> found(2);
+    const std::string s = "an ERROR occurred";
+    ac.scan(s.data(), s.data() + s.size(), found);
+    const std::vector<unsigned char> expected = { 1, 0 };
+    ASSERT_EQ(expected, found);
+}
+
+namespace {
+    const std::vector<std::string> filters = {
+	"/ERROR/", "/error/i", "/WARN/!", "/user_id=\\d+/", "/(abc)\\1/", "/^2016.*login$/",
+	"/disk full/i", "/a|b/", "/\\d{3}/", "/login/!", "/x?abc/", "/retry/",
+    };
+
+    const std::vector<std::string> lines = {
+	"",
+	"2016-02-01 12:00:01 INFO user_id=42 login",
+	"2016-02-01 12:00:02 ERROR Disk Full",
+	"2016-02-01 12:00:03 error: retry WARN",
+	"abcabc",
+	"xabc 123",
+    };
+}
+
+TEST(multi_matcher, results_are_identical_to_single_matching)
+{
+    std::vector<std::shared_ptr<regex_index>> single, multi;
+    for(auto& f : filters) {
+	single.push_back(std::make_shared<regex_index>(f));
+	multi.push_back(std::make_shared<regex_index>(f));
+    }
+    multi_matcher mm(multi);
+    line_number_t num = 1;
+    for(auto& l : lines) {
+	const line_t line(l.data(), l.data() + l.size(), nullptr, num++);
+	for(auto ri : single) {
+	    ri->match(line);
+	}
+	mm.match(line);
+    }
+    for(unsigned i = 0; i < filters.size(); ++i) {
+	ASSERT_EQ(single[i]->lineNum_vector(), multi[i]->lineNum_vector()) << filters[i];
+    }
+}
+
+TEST(multi_matcher, benchmark)
+{
+    TemporaryFile tmp;
+    {
+	std::string s;
+	for(unsigned i = 0; i < 200000; ++i) {
+	    s += "2016-02-01 12:00:00 " + std::string((i % 100) ? "INFO" : "ERROR") + " worker=" + std::to_string(i % 16)
+		+ " user_id=" + std::to_string(i * 7919u % 100000u) + " request /api/v1/items/" + std::to_string(i) + " handled\n";
+	}
+	FILE *f = tmp.file();
+	ASSERT_TRUE(f != nullptr);
+	ASSERT_EQ(s.size(), fwrite(s.data(), 1, s.size(), f));
+	ASSERT_TRUE(tmp.close());
+    }
+    const std::vector<std::string> rgx = {
+	"/ERROR/", "/warn/i", "/worker=1[0-5]/", "/user_id=\\d+7 /", "/timeout/", "/items\\/\\d+0 /",
+	"/handled/!", "/disk full/i", "/request \\/api\\/v2/", "/12:00:0[1-9]/", "/exception/i", "/worker=3 /",
+    };
+
+    auto f_idx = std::make_shared<file_index>(to_utf8(tmp.filename()));
+    f_idx->parse_all();
+
+    std::vector<std::shared_ptr<regex_index>> single, multi;
+    for(auto& r : rgx) {
+	single.push_back(std::make_shared<regex_index>(r));
+	multi.push_back(std::make_shared<regex_index>(r));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(line_number_t num = 1; num <= f_idx->size(); ++num) {
+	const line_t line = f_idx->line(num);
+	for(auto ri : single) {
+	    ri->match(line);
+	}
+    }
+    const auto single_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    multi_matcher mm(multi);
+    for(line_number_t num = 1; num <= f_idx->size(); ++num) {
+	mm.match(f_idx->line(num));
+    }
+    const auto multi_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    std::clog << "multi matcher benchmark: " << rgx.size() << " filters on " << f_idx->size() << " lines: one by one "
+	      << single_ms << " ms, multi matcher " << multi_ms << " ms" << (mm.combined() ? " (combined automaton)" : "") << std::endl;
+    for(unsigned i = 0; i < rgx.size(); ++i) {
+	ASSERT_EQ(single[i]->lineNum_vector(), multi[i]->lineNum_vector()) << rgx[i];
+    }
+}
@@ -0,0 +1,142 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <stdint.h>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <vector>
+
+/**
+ * a vector of unsigned integers, which stores each value in Bytes bytes.
+ * With 64bit line numbers a vector of line numbers would use twice the memory of 32bit line numbers,
+ * 5 bytes store line numbers up to 2^40-1, 6 bytes up to 2^48-1.
+ * The interface is the subset of std::vector used for line number vectors.
+ * Elements are only added at the end and the iterators return values, not references.
+ */
+template <typename T, unsigned Bytes>
+class packed_vector
+{
+    static_assert(Bytes > 0 && Bytes <= sizeof(T), "Bytes has to fit into T");
+
+    std::vector<uint8_t> data_;
+
+    static T load(const uint8_t* p)
+    {
+	T v = 0;
+	for(unsigned i = 0; i < Bytes; ++i) {
+	    v |= static_cast<T>(p[i]) << (8 * i);
+	}
+	return v;
+    }
+
+public:
+    typedef T value_type;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    /// the largest value that can be stored.
+    static const T max_value = (Bytes == sizeof(T)) ? ~T(0) : (T(1) << (8 * Bytes)) - 1;
+
+    /// a random access iterator, which returns the values.
+    class const_iterator
+    {
+	const uint8_t* p_;
+    public:
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef T value_type;
+	typedef ptrdiff_t difference_type;
+	typedef const T* pointer;
+	typedef T reference;
+
+	const_iterator() : p_(nullptr) {}
+	explicit const_iterator(const uint8_t* p) : p_(p) {}
+
+	T operator*() const { return load(p_); }
+	T operator[](const difference_type n) const { return load(p_ + n * Bytes); }
+
+	const_iterator& operator++() { p_ += Bytes; return *this; }
+	const_iterator operator++(int) { const_iterator i = *this; p_ += Bytes; return i; }
+	const_iterator& operator--() { p_ -= Bytes; return *this; }
+	const_iterator operator--(int) { const_iterator i = *this; p_ -= Bytes; return i; }
+	const_iterator& operator+=(const difference_type n) { p_ += n * Bytes; return *this; }
+	const_iterator& operator-=(const difference_type n) { p_ -= n * Bytes; return *this; }
+	const_iterator operator+(const difference_type n) const { return const_iterator(p_ + n * Bytes); }
+	const_iterator operator-(const difference_type n) const { return const_iterator(p_ - n * Bytes); }
+	friend const_iterator operator+(const difference_type n, const const_iterator& i) { return i + n; }
+	difference_type operator-(const const_iterator& o) const { return (p_ - o.p_) / static_cast<difference_type>(Bytes); }
+
+	bool operator==(const const_iterator& o) const { return p_ == o.p_; }
+	bool operator!=(const const_iterator& o) const { return p_ != o.p_; }
+	bool operator<(const const_iterator& o) const { return p_ < o.p_; }
+	bool operator>(const const_iterator& o) const { return p_ > o.p_; }
+	bool operator<=(const const_iterator& o) const { return p_ <= o.p_; }
+	bool operator>=(const const_iterator& o) const { return p_ >= o.p_; }
+    };
+    /// the elements can not be modified through iterators.
+    typedef const_iterator iterator;
+
+    packed_vector() {}
+
+    packed_vector(std::initializer_list<T> l)
+    {
+	reserve(l.size());
+	for(auto v : l) {
+	    push_back(v);
+	}
+    }
+
+    template <typename InputIterator>
+    packed_vector(InputIterator first, InputIterator last)
+    {
+	for(; first != last; ++first) {
+	    push_back(*first);
+	}
+    }
+
+    size_t size() const { return data_.size() / Bytes; }
+    bool empty() const { return data_.empty(); }
+    size_t capacity() const { return data_.capacity() / Bytes; }
+    void reserve(const size_t n) { data_.reserve(n * Bytes); }
+    void clear() { data_.clear(); }
+    void shrink_to_fit() { data_.shrink_to_fit(); }
+    void swap(packed_vector& o) { data_.swap(o.data_); }
+
+    /// @return number of bytes allocated by the vector.
+    size_t memory_usage() const { return data_.capacity(); }
+
+    void push_back(const T v)
+    {
+	assert(v <= max_value);
+	for(unsigned i = 0; i < Bytes; ++i) {
+	    data_.push_back(static_cast<uint8_t>(v >> (8 * i)));
+	}
+    }
+
+    /// append the values [first, last). pos has to be end().
+    template <typename InputIterator>
+    void insert(const const_iterator pos, InputIterator first, InputIterator last)
+    {
+	assert(pos == end());
+	(void)pos;
+	for(; first != last; ++first) {
+	    push_back(*first);
+	}
+    }
+
+    T operator[](const size_t i) const { return load(data_.data() + i * Bytes); }
+    T front() const { return (*this)[0]; }
+    T back() const { return (*this)[size() - 1]; }
+
+    const_iterator begin() const { return const_iterator(data_.data()); }
+    const_iterator end() const { return const_iterator(data_.data() + data_.size()); }
+
+    bool operator==(const packed_vector& o) const { return data_ == o.data_; }
+    bool operator!=(const packed_vector& o) const { return data_ != o.data_; }
+};
+
+template <typename T, unsigned Bytes>
+const T packed_vector<T, Bytes>::max_value;
@@ -0,0 +1,95 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "packed_vector.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+    /// values around the 32bit boundary and the largest value.
+    template <typename V>
+    std::vector<uint64_t> boundary_values()
+    {
+	return { 0, 1, 255, 256, 0xffffffffllu, 0x100000000llu, 0x100000001llu, V::max_value - 1, V::max_value };
+    }
+
+    template <typename V>
+    void check_boundary()
+    {
+	const std::vector<uint64_t> values = boundary_values<V>();
+	V v;
+	for(auto n : values) {
+	    v.push_back(n);
+	}
+	ASSERT_EQ(values.size(), v.size());
+	ASSERT_EQ(values, std::vector<uint64_t>(v.begin(), v.end()));
+	for(size_t i = 0; i < values.size(); ++i) {
+	    ASSERT_EQ(values[i], v[i]);
+	}
+	ASSERT_EQ(V::max_value, v.back());
+
+	// the values are sorted, so the iterators work with the binary search algorithms
+	ASSERT_EQ(5, std::lower_bound(v.begin(), v.end(), 0x100000000llu) - v.begin());
+	ASSERT_EQ(v.begin() + 4, std::find(v.begin(), v.end(), 0xffffffffllu));
+	ASSERT_TRUE(std::binary_search(v.begin(), v.end(), V::max_value));
+    }
+}
+
+TEST(packed_vector, stores_40bit_values)
+{
+    typedef packed_vector<uint64_t, 5> V;
+    ASSERT_EQ((1llu << 40) - 1, V::max_value);
+    check_boundary<V>();
+}
+
+TEST(packed_vector, stores_48bit_values)
+{
+    typedef packed_vector<uint64_t, 6> V;
+    ASSERT_EQ((1llu << 48) - 1, V::max_value);
+    check_boundary<V>();
+}
+
+TEST(packed_vector, uses_bytes_per_value)
+{
+    packed_vector<uint64_t, 5> v;
+    v.reserve(1000);
+    for(uint64_t n = 0; n < 1000; ++n) {
+	v.push_back(n << 30);
+    }
+    ASSERT_EQ(5000u, v.memory_usage());
+    ASSERT_EQ(999llu << 30, v.back());
+}
+
+TEST(packed_vector, behaves_like_a_vector)
+{
+    typedef packed_vector<uint64_t, 5> V;
+    V a = { 1, 2, 3 };
+    V b(a.begin(), a.end());
+    ASSERT_EQ(a, b);
+    const V c = { 4, 5 };
+    b.insert(b.end(), c.begin(), c.end());
+    ASSERT_EQ(V({ 1, 2, 3, 4, 5 }), b);
+    ASSERT_NE(a, b);
+
+    // iterator arithmetic
+    V::const_iterator i = b.begin();
+    ASSERT_EQ(1u, *i++);
+    ASSERT_EQ(2u, *i);
+    i += 2;
+    ASSERT_EQ(4u, *i);
+    ASSERT_EQ(3u, *--i);
+    ASSERT_EQ(5u, i[2]);
+    ASSERT_EQ(5, b.end() - b.begin());
+    ASSERT_TRUE(b.begin() < b.end());
+
+    V d;
+    std::set_intersection(a.begin(), a.end(), b.begin() + 2, b.end(), std::back_inserter(d));
+    ASSERT_EQ(V({ 3 }), d);
+
+    a.swap(d);
+    ASSERT_EQ(1u, a.size());
+    a.clear();
+    ASSERT_TRUE(a.empty());
+}
@@ -0,0 +1,88 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "prefetcher.h"
+#include "memorymap.h"
+
+namespace {
+    /// number of bytes the thread maps at once.
+    const uint64_t prefetch_step = 2*1024*1024;
+}
+
+prefetcher::prefetcher(const char* beg, const char* end, const uint64_t distance) :
+    end_(end),
+    distance_(distance),
+    prefetched_(beg),
+    pos_(beg),
+    advised_(beg),
+    stop_(false)
+{
+    if (distance_ > 0 && beg < end) {
+	thread_ = std::thread(&prefetcher::run, this);
+	advance(beg);
+    }
+}
+
+prefetcher::~prefetcher()
+{
+    if (thread_.joinable()) {
+	{
+	    std::lock_guard<std::mutex> lock(mutex_);
+	    stop_ = true;
+	}
+	cond_.notify_one();
+	thread_.join();
+    }
+}
+
+void
+prefetcher::advance(const char* pos)
+{
+    if (! thread_.joinable()) {
+	return;
+    }
+    const char* beg;
+    const char* end;
+    {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (pos < pos_) {
+	    return;
+	}
+	pos_ = pos;
+	// the operating system reads the pages up to twice the distance, the thread maps the first half
+	beg = (advised_ > pos_) ? advised_ : pos_;
+	end = (static_cast<uint64_t>(end_ - pos_) > 2 * distance_) ? pos_ + 2 * distance_ : end_;
+	if (end > beg) {
+	    advised_ = end;
+	}
+    }
+    cond_.notify_one();
+    if (end > beg) {
+	doj::memoryprefetch(beg, end - beg, false);
+    }
+}
+
+void
+prefetcher::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true) {
+	cond_.wait(lock, [this]() {
+		return stop_ || (prefetched_ < end_ && (prefetched_ <= pos_ || static_cast<uint64_t>(prefetched_ - pos_) < distance_));
+	    });
+	if (stop_) {
+	    return;
+	}
+	// the scan passed the mapped pages, continue at the scan position
+	if (prefetched_ < pos_) {
+	    prefetched_ = pos_;
+	}
+	const char* beg = prefetched_;
+	const char* end = (static_cast<uint64_t>(end_ - beg) > prefetch_step) ? beg + prefetch_step : end_;
+	prefetched_ = end;
+	lock.unlock();
+	doj::memoryprefetch(beg, end - beg, true);
+	lock.lock();
+    }
+}
@@ -0,0 +1,55 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * a background thread, which reads a memory mapped file ahead of a scan.
+ * The scanning threads report their position with advance(). The thread keeps the pages
+ * up to distance bytes past the position mapped, so the scan does not wait for page faults.
+ * The operating system is advised to read the following distance bytes in the background.
+ */
+class prefetcher
+{
+    const char* const end_;
+    const uint64_t distance_;
+
+    /// the pages before prefetched_ are mapped.
+    const char* prefetched_;
+    /// position of the scan.
+    const char* pos_;
+    /// the operating system was advised to read the pages before advised_.
+    const char* advised_;
+    bool stop_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::thread thread_;
+
+    /// the function of the background thread.
+    void run();
+
+public:
+    /**
+     * start the background thread.
+     * @param beg first byte of the scan.
+     * @param end one past the last byte of the scan.
+     * @param distance number of bytes to read ahead of the scan. If 0 no thread is started.
+     */
+    prefetcher(const char* beg, const char* end, const uint64_t distance);
+
+    /// stop the background thread.
+    ~prefetcher();
+
+    /// the scan has reached pos. A position before a previous position is ignored.
+    void advance(const char* pos);
+
+private:
+    prefetcher(const prefetcher&);
+    prefetcher& operator=(const prefetcher&);
+};
@@ -0,0 +1,100 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "prefetcher.h"
+#include "memorymap.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#if defined(__unix__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+    /// @return number of page faults of the calling thread.
+    uint64_t page_faults()
+    {
+#if defined(RUSAGE_THREAD)
+	struct rusage r;
+	if (getrusage(RUSAGE_THREAD, &r) == 0) {
+	    return r.ru_minflt + r.ru_majflt;
+	}
+#endif
+	return 0;
+    }
+
+    /// count the lines of [beg, end) and report the position to pf every step bytes.
+    uint64_t count_lines(const char* beg, const char* const end, prefetcher* pf)
+    {
+	const uint64_t step = 1024*1024;
+	uint64_t lines = 0;
+	while(beg < end) {
+	    if (pf) {
+		pf->advance(beg);
+	    }
+	    const char* const e = (static_cast<uint64_t>(end - beg) > step) ? beg + step : end;
+	    lines += std::count(beg, e, '\n');
+	    beg = e;
+	}
+	return lines;
+    }
+}
+
+TEST(prefetcher, reads_ahead_of_the_scan)
+{
+    std::string s;
+    for(unsigned i = 0; i < 100000; ++i) {
+	s += "line " + std::to_string(i) + "\n";
+    }
+    for(uint64_t distance : { 0, 4096, 1024*1024, 1024*1024*1024 }) {
+	prefetcher pf(s.data(), s.data() + s.size(), distance);
+	ASSERT_EQ(100000u, count_lines(s.data(), s.data() + s.size(), &pf));
+	// an earlier position is ignored
+	pf.advance(s.data());
+    }
+    // an empty range does not start a thread
+    prefetcher pf(s.data(), s.data(), 4096);
+    pf.advance(s.data());
+}
+
+TEST(prefetcher, page_fault_benchmark)
+{
+    TemporaryFile tmp;
+    const std::string fn = to_utf8(tmp.filename());
+    const unsigned num_lines = 2000000;
+    {
+	std::ofstream os(fn, std::ios::binary);
+	for(unsigned i = 0; i < num_lines; ++i) {
+	    os << "2016-02-01 12:00:00 INFO request " << i << " handled\n";
+	}
+    }
+
+    // the file is in the page cache, so the benchmark counts the minor faults of mapping the pages
+    for(int mode = 0; mode < 3; ++mode) {
+	const auto start = std::chrono::steady_clock::now();
+	const uint64_t faults = page_faults();
+	doj::memorymap_ptr<char> m(fn, true, 0, mode == 1);
+	ASSERT_FALSE(!m);
+	std::unique_ptr<prefetcher> pf;
+	if (mode == 2) {
+	    pf.reset(new prefetcher(m.begin(), m.end(), 64*1024*1024));
+	}
+	const uint64_t map_faults = page_faults() - faults;
+	ASSERT_EQ(num_lines, count_lines(m.begin(), m.end(), pf.get()));
+	const uint64_t scan_faults = page_faults() - faults - map_faults;
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	const char* name[] = { "plain mmap", "MAP_POPULATE", "prefetch thread" };
+	std::clog << "page fault benchmark: " << name[mode] << ": " << m.size() / (1024*1024) << " MB, "
+		  << map_faults << " page faults while mapping, " << scan_faults << " page faults while scanning, "
+		  << ms << " ms" << std::endl;
+	if (mode == 1 && page_faults() > 0) {
+	    ASSERT_LT(scan_faults, map_faults);
+	}
+    }
+}
@@ -20,7 +20,7 @@ CursesProgressFunctor::~CursesProgressFunctor()
 }
 
 void
-CursesProgressFunctor::progress(unsigned num, unsigned perc)
+CursesProgressFunctor::progress(line_number_t num, unsigned perc)
 {
     std::string s = desc_ + std::to_string(num) + ' ' + std::to_string(perc) + "% ";
     if (verbose) {
@@ -39,7 +39,7 @@ CursesProgressFunctor::progress(unsigned num, unsigned perc)
 OStreamProgressFunctor::~OStreamProgressFunctor() { os_ << std::endl; }
 
 void
-OStreamProgressFunctor::progress(unsigned num, unsigned perc)
+OStreamProgressFunctor::progress(line_number_t num, unsigned perc)
 {
     os_ << "\r" << desc_ << num << ' ' << perc << "%";
     if (verbose) {
@@ -3,6 +3,7 @@
  * :indentSize=4:tabSize=8:
  */
 #pragma once
+#include "types.h"
 #include <iostream>
 #include <string>
 
@@ -16,7 +17,7 @@ public:
      * @param num a number.
      * @param perc a percentage value, should be between [0..100].
      */
-    virtual void progress(unsigned num, unsigned perc) = 0;
+    virtual void progress(line_number_t num, unsigned perc) = 0;
 };
 
 class OStreamProgressFunctor : public ProgressFunctor
@@ -26,7 +27,7 @@ class OStreamProgressFunctor : public ProgressFunctor
 public:
     OStreamProgressFunctor(std::ostream& os, std::string desc) : os_(os), desc_(desc) {}
     ~OStreamProgressFunctor();
-    virtual void progress(unsigned num, unsigned perc);
+    virtual void progress(line_number_t num, unsigned perc);
 };
 
 class CursesProgressFunctor : public ProgressFunctor
@@ -40,5 +41,5 @@ public:
 	y_(y), x_(x), attr_(attr), desc_(desc), max_len_(0)
     {}
     ~CursesProgressFunctor();
-    virtual void progress(unsigned num, unsigned perc);
+    virtual void progress(line_number_t num, unsigned perc);
 };
@@ -27,7 +27,10 @@
 #endif
 
 #include "file_index.h"
+#include "file_watcher.h"
+#include "index_cache.h"
 #include "regex_index.h"
+#include "filter_intersection.h"
 #include "error.h"
 #include "display_info.h"
 #include "normalize_regex.h"
@@ -36,9 +39,13 @@
 #include "foreach.h"
 #include "getRSS.h"
 #include "to_wide.h"
+#include "utf8_columns.h"
+#include "render_cache.h"
 #include "event.h"
-#include "intersect.h"
 #include "search.h"
+#include "decompress.h"
+#include "seek_index.h"
+#include "stream_reader.h"
 #include "temporary_file.h"
 #include "console.h"
 #include "errno_str.h"
@@ -90,6 +97,9 @@ namespace {
     /// minimum screen width
     const unsigned min_screen_width = 16;
 
+    /// number of lines indexed before the screen is shown, more than a terminal displays.
+    const line_number_t first_screen_lines = 1000;
+
     /// width of screen in characters
 #define screen_width static_cast<unsigned>(COLS)
     /// height of screen in characters
@@ -100,26 +110,44 @@ namespace {
 
     /// current search regular expression string
     std::string search_str;
-    /// compiled search regular expression
-    std::wregex search_rgx;
+    /// compiled search regular expression, it searches the UTF-8 bytes of a line; nullptr if no valid search regular expression is set.
+    std::shared_ptr<const regex_engine> search_rgx;
     /// error string if search regular expression could not be compiled
     std::string search_err;
     /// the y position of the search window
     unsigned search_y;
+    /// id of the running background search, see search_in_background(); 0 if no search runs.
+    unsigned search_id = 0;
+    /// direction of the running background search.
+    search_direction search_dir = search_forward;
+    /// regular expression index of the background job, which matches the search hit index.
+    const unsigned search_index_idx = max_regex_num;
+    /// the search hit index, the lines matching the search regular expression; nullptr until it was matched.
+    std::shared_ptr<regex_index> search_index;
+    /// the search hit index, which is matched by a background job; nullptr if no job runs.
+    std::shared_ptr<regex_index> search_index_matching;
+    /// the hits of search_index among the displayed lines.
+    search_hits search_index_hits;
 
     /// regular expression to match links
-    std::wregex link_rgx(L"(ht|f)tps?://[a-zA-Z0-9/~&=%_.-]+", std::regex::ECMAScript | std::regex::optimize | std::regex::icase);
+    const std::unique_ptr<regex_engine> link_rgx = make_regex_engine("(ht|f)tps?://[a-zA-Z0-9/~&=%_.-]+", std::regex::ECMAScript | std::regex::optimize | std::regex::icase);
     typedef std::pair<unsigned, unsigned> coordinate_t;
     std::map<coordinate_t, std::wstring> link;
 
     /// regular expression to match emails
     /// see http://www.regular-expressions.info/email.html
-    std::wregex email_rgx(L"\\b[a-z0-9._%+-]+\\@[a-z0-9.-]+\\.[a-z]{2,4}\\b", std::regex::ECMAScript | std::regex::optimize | std::regex::icase);
+    const std::unique_ptr<regex_engine> email_rgx = make_regex_engine("\\b[a-z0-9._%+-]+\\@[a-z0-9.-]+\\.[a-z]{2,4}\\b", std::regex::ECMAScript | std::regex::optimize | std::regex::icase);
     std::map<coordinate_t, std::wstring> email;
 
     /// the file that is displayed
     file_index::ptr_t f_idx;
 
+    /// true if lines appended to the file are shown, see follow_file().
+    bool follow_mode = false;
+
+    /// watches the followed file.
+    std::unique_ptr<file_watcher> watcher;
+
     /// object to manage displayed lines
     DisplayInfo::ptr_t display_info;
 
@@ -142,6 +170,9 @@ namespace {
 	/// object used for lines filter
 	std::shared_ptr<regex_index> ri_;
 
+	/// object which is matched by a background thread and becomes ri_ when it is done.
+	std::shared_ptr<regex_index> matching_;
+
 	///@{
 
 	/// regex object used for replace display filter
@@ -153,8 +184,8 @@ namespace {
 
 	///@{
 
-	/// regex object used for the attribute display filter
-	std::shared_ptr<std::wregex> attribute_df_rgx_;
+	/// regex object used for the attribute display filter, it searches the UTF-8 bytes of a line
+	std::shared_ptr<regex_engine> attribute_df_rgx_;
 	/// attribute display filter curses attributes
 	curses_attr_t attribute_df_attr_;
 
@@ -183,6 +214,15 @@ namespace {
     /// the filter regex cache
     regex_cache_t filter_cache;
 
+    /// @return file name and number of lines for the info line.
+    std::string file_info()
+    {
+	return command_line_filename + " (" + std::to_string(f_idx->size()) + (f_idx->indexed() ? " lines)" : " lines indexed)");
+    }
+
+    /// intersection of the filter line sets of regex_vec
+    filter_intersection filter_sets;
+
     /// @return number of digits in i.
     int digits(uint64_t i)
     {
@@ -216,7 +256,7 @@ namespace {
 	}
     }
 
-    unsigned print_line_prefix(const unsigned y, const unsigned line_num, const unsigned line_len, const unsigned line_num_width)
+    unsigned print_line_prefix(const unsigned y, const line_number_t line_num, const unsigned line_len, const unsigned line_num_width)
     {
 	unsigned x = 0;
 
@@ -237,7 +277,7 @@ namespace {
 	    mvaddch(y, x, ' ');
 	}
 
-	mvprintw(y, x, "%u ", line_num);
+	mvprintw(y, x, "%s ", std::to_string(line_num).c_str());
 	x += line_num_w;
 
 	return x;
@@ -261,12 +301,117 @@ namespace {
 	mvprintw(w_lines_height - 1, screen_width - info.size(), "%s", info.c_str());
     }
 
+    /// generation of the display filters and the search regular expression, see render_cache.
+    unsigned display_generation = 0;
+
+    /// the rendered lines of the last screens.
+    render_cache lines_cache;
+
+    /// the rendered lines on the screen, their words are used for completion, see update_word_set().
+    std::vector<std::shared_ptr<const rendered_line>> screen_lines;
+
+    /// render the lines again, call this if the display filters, the search regular expression or the file changed.
+    void display_changed()
+    {
+	++display_generation;
+    }
+
+    /// fill the word set with the words of the lines on the screen.
+    void update_word_set()
+    {
+	clear_word_set();
+	for(auto& r : screen_lines) {
+	    add_to_word_set(r->text_);
+	}
+    }
+
+    /**
+     * apply the display filters, the search and link highlighting to a line.
+     * @param line a line of the file.
+     * @return the rendered line.
+     */
+    std::shared_ptr<const rendered_line> render_line(line_t line)
+    {
+	auto r = std::make_shared<rendered_line>();
+	r->file_size_ = line.end_ - line.beg_;
+
+	// apply Replace Display Filters
+	r->text_ = line.to_string();
+	for (auto df : regex_vec) {
+	    if (df->replace_df_rgx_) {
+		r->text_ = std::regex_replace(r->text_, *(df->replace_df_rgx_), df->replace_df_text_);
+	    }
+	}
+	const char* beg = r->text_.data();
+	const char* end = beg + r->text_.size();
+
+	// the regular expressions search the UTF-8 bytes of the line, their matches are mapped to the decoded characters.
+	// The buffers are reused for every line.
+	static utf8_columns wline;
+	wline.assign(beg, end);
+	static std::vector<regex_engine::match_t> matches;
+	r->chars_ = wline.chars();
+
+	// curses attribute of each character
+	r->attr_.assign(wline.size(), 0);
+	auto set_attr = [&](const regex_engine& rgx, const curses_attr_t attr) {
+	    rgx.find_all(beg, end, matches);
+	    for(auto& m : matches) {
+		// set character attribute for all matched characters
+		for(size_t i = wline.column(m.first), e = wline.end_column(m.first + m.second); i < e; ++i) {
+		    r->attr_[i] &= ~A_COLOR; // clear any previous color
+		    r->attr_[i] |= attr; // set new attribute and color
+		}
+	    }
+	};
+
+	// apply Attribute Display Filters
+	for(auto df : regex_vec) {
+	    if (df->attribute_df_rgx_) {
+		set_attr(*df->attribute_df_rgx_, df->attribute_df_attr_);
+	    }
+	}
+
+	// apply search?
+	if (search_rgx && search_err.empty()) {
+	    set_attr(*search_rgx, use_color() ? (color(COLOR_GREEN, COLOR_BLACK) | A_BOLD) : A_REVERSE);
+	}
+
+	// look for links and emails
+	r->link_.assign(wline.size(), -1);
+	auto find_links = [&](const regex_engine& rgx) {
+	    rgx.find_all(beg, end, matches);
+	    for(auto& m : matches) {
+		const size_t b = wline.column(m.first);
+		const size_t e = wline.end_column(m.first + m.second);
+		r->links_.push_back(r->chars_.substr(b, e - b));
+		// set character attribute for all matched characters
+		for(size_t i = b; i < e; ++i) {
+		    r->attr_[i] |= A_UNDERLINE;
+		    r->link_[i] = r->links_.size() - 1;
+		}
+	    }
+	};
+	find_links(*link_rgx);
+	r->num_links_ = r->links_.size();
+	find_links(*email_rgx);
+
+	return r;
+    }
+
+    void reopen_file();
+
     void refresh_lines_window()
     {
 	assert(tab_width > 0);
+	// reading the lines of a truncated file raises SIGBUS
+	if (f_idx->truncated()) {
+	    reopen_file();
+	}
 	link.clear();
 	email.clear();
-	clear_word_set();
+	screen_lines.clear();
+	lines_cache.next_screen();
 
 	middle_line_number = 0;
 	unsigned y = 0;
@@ -277,7 +422,7 @@ namespace {
 		    middle_line_number = current_line_num;
 		}
 
-		line_t line = f_idx->line(current_line_num);
+		const line_t line = f_idx->line(current_line_num);
 		assert(current_line_num == line.num_);
 
 		unsigned line_num_width = digits(current_line_num);
@@ -288,22 +433,17 @@ namespace {
 		    line_num_width = 8;
 		}
 
-		// apply Replace Display Filters
-		if (! line.empty()) {
-		    static std::string l;
-		    l = line.to_string();
-
-		    for (auto df : regex_vec) {
-			if (df->replace_df_rgx_) {
-			    l = std::regex_replace(l, *(df->replace_df_rgx_), df->replace_df_text_);
-			}
-		    }
-
-		    line.assign(l);
+		// only render the lines which were not on the last screens
+		auto r = lines_cache.find(current_line_num, display_generation);
+		if (! r || r->file_size_ != static_cast<size_t>(line.end_ - line.beg_)) {
+		    r = render_line(line);
+		    lines_cache.insert(current_line_num, display_generation, r);
 		}
+		screen_lines.push_back(r);
+		const std::wstring& chars = r->chars_;
 
 		// handle empty line
-		if (line.empty()) {
+		if (chars.empty()) {
 		    unsigned x = print_line_prefix(y, line.num_, 0, line_num_width);
 		    fill(y, x);
 
@@ -321,80 +461,16 @@ namespace {
 		    }
 		}
 
-		add_to_word_set(line.to_string());
-		auto wline = to_wide(line.to_string());
-
-		// map of pointers into the line and a corresponding curses attribute for the character
-		std::map<std::wstring::iterator, curses_attr_t> character_attr;
-
-		// apply Attribute Display Filters
-		for(auto df : regex_vec) {
-		    if (df->attribute_df_rgx_) {
-			for(auto it = std::wsregex_iterator(wline.begin(), wline.end(), *(df->attribute_df_rgx_)), it_end = std::wsregex_iterator(); it != it_end; ++it) {
-			    std::wstring::iterator b = wline.begin() + it->position();
-			    std::wstring::iterator e = b + it->length();
-			    assert(b <= e);
-			    // set character attribute for all matched characters
-			    for (std::wstring::iterator i = b; i != e; ++i) {
-				character_attr[i] &= ~A_COLOR; // clear any previous color
-				character_attr[i] |= df->attribute_df_attr_; // set new attribute and color
-			    }
-			}
-		    }
-		}
-
-		// apply search?
-		if (search_err.empty()) {
-		    // apply search regex to line
-		    for (auto it = std::wsregex_iterator(wline.begin(), wline.end(), search_rgx); it != std::wsregex_iterator(); ++it) {
-			std::wstring::iterator b = wline.begin() + it->position();
-			std::wstring::iterator e = b + it->length();
-			assert(b <= e);
-			// set character attribute for all matched characters
-			for (std::wstring::iterator i = b; i != e; ++i) {
-			    character_attr[i] &= ~A_COLOR; // clear any previous color
-			    character_attr[i] |= (use_color() ? (color(COLOR_GREEN, COLOR_BLACK) | A_BOLD) : A_REVERSE);
-			}
-		    }
-		}
-
-		// look for links
-		std::map<std::wstring::iterator, std::wstring> iterator2link;
-		for (auto it = std::wsregex_iterator(wline.begin(), wline.end(), link_rgx); it != std::wsregex_iterator(); ++it) {
-		    std::wstring::iterator b = wline.begin() + it->position();
-		    std::wstring::iterator e = b + it->length();
-		    assert(b <= e);
-		    std::wstring l(b, e);
-		    // set character attribute for all matched characters
-		    for (std::wstring::iterator i = b; i != e; ++i) {
-			character_attr[i] |= A_UNDERLINE;
-			iterator2link[i] = l;
-		    }
-		}
-		// look for emails
-		std::map<std::wstring::iterator, std::wstring> iterator2email;
-		for (auto it = std::wsregex_iterator(wline.begin(), wline.end(), email_rgx); it != std::wsregex_iterator(); ++it) {
-		    std::wstring::iterator b = wline.begin() + it->position();
-		    std::wstring::iterator e = b + it->length();
-		    assert(b <= e);
-		    std::wstring l(b, e);
-		    // set character attribute for all matched characters
-		    for (std::wstring::iterator i = b; i != e; ++i) {
-			character_attr[i] |= A_UNDERLINE;
-			iterator2email[i] = l;
-		    }
-		}
-
 		// print the current line
-		auto it = wline.begin();
-		while (it != wline.end() && y < w_lines_height) {
+		size_t it = 0;
+		while (it != chars.size() && y < w_lines_height) {
 		    unsigned x = 0;
 		    // block to print left info column
 		    {
 			// are we at the start of the line?
-			if (it == wline.begin()) {
+			if (it == 0) {
 			    // print line number
-			    x += print_line_prefix(y, line.num_, wline.size(), line_num_width);
+			    x += print_line_prefix(y, line.num_, chars.size(), line_num_width);
 			}
 			else {
 			    // print empty space
@@ -411,19 +487,14 @@ namespace {
 		    }
 		    // print line in chunks of screen width
 		    curses_attr a(gray_on_black);
-		    for (; it != wline.end() && x < screen_width; ++it) {
-			// check for link
-			auto i = iterator2link.find(it);
-			if (i != iterator2link.end()) {
-			    link.emplace(std::make_pair(x, y), i->second);
-			}
-			// check for email
-			i = iterator2email.find(it);
-			if (i != iterator2email.end()) {
-			    email.emplace(std::make_pair(x, y), i->second);
+		    for (; it != chars.size() && x < screen_width; ++it) {
+			// check for link or email
+			const int l = r->link_[it];
+			if (l >= 0) {
+			    (static_cast<size_t>(l) < r->num_links_ ? link : email).emplace(std::make_pair(x, y), r->links_[l]);
 			}
 
-			auto c = *it;
+			auto c = chars[it];
 			// handle tab character
 			if (c == '\t') {
 			    do {
@@ -433,7 +504,7 @@ namespace {
 			else {
 			    // replace non printable characters with a space
 			    if (iswprint(c)) {
-				curses_attr a(character_attr[it]);
+				curses_attr a(r->attr_[it]);
 				mvaddwch(y, x, c);
 			    }
 			    else {
@@ -451,7 +522,7 @@ namespace {
 		}
 
 		// did we display the full line?
-		if (it == wline.end()) {
+		if (it == chars.size()) {
 		    // do we have another line to display?
 		    if (display_info->next()) {
 			continue; // there is a next line to display
@@ -544,7 +615,12 @@ namespace {
 		    if (num != 1) {
 			s += "es";
 		    }
-		    s += ", " + std::to_string(num * 100llu / f_idx->size()) + "%)";
+		    // the file is empty while a slow producer did not write the first line yet
+		    const uint64_t lines = f_idx->size();
+		    if (lines > 0) {
+			s += ", " + std::to_string(num * 100llu / lines) + "%";
+		    }
+		    s += ")";
 
 		    X += print_string(y, X, s);
 		}
@@ -731,26 +807,37 @@ namespace {
 	refresh();
     }
 
+    /// scroll the display, so the last line is at the bottom of the lines window.
+    void go_to_bottom()
+    {
+	const line_number_t lastLineNum = display_info->lastLineNum();
+	display_info->go_to(lastLineNum);
+	// scroll up until we don't print the last line any more
+	while (!display_info->isFirstLineDisplayed()) {
+	    display_info->up();
+	    refresh_lines_window();
+	    if (display_info->bottomLineNum() != lastLineNum) {
+		// now scroll down again one line, so we see the last line
+		display_info->down();
+		break;
+	    }
+	}
+    }
+
+    bool follow_file();
+
     // position display on bottom line
     void key_G()
     {
+	if (follow_mode) {
+	    follow_file();
+	}
 	if (! display_info->start()) {
 	    info = "nothing to display";
 	} else if (display_info->isLastLineDisplayed()) {
 	    info = "moved to bottom";
 	} else {
-	    const line_number_t lastLineNum = display_info->lastLineNum();
-	    display_info->go_to(lastLineNum);
-	    // scroll up until we don't print the last line any more
-	    while (!display_info->isFirstLineDisplayed()) {
-		display_info->up();
-		refresh_lines_window();
-		if (display_info->bottomLineNum() != lastLineNum) {
-		    break;
-		}
-	    }
-	    // now scroll down again one line, so we see the last line
-	    display_info->down();
+	    go_to_bottom();
 	}
 	refresh_lines_window();
 	refresh();
@@ -780,37 +867,74 @@ namespace {
 	refresh();
     }
 
-    // \todo maybe background search?
-    void key_n()
+    /**
+     * start a background search from the top line.
+     * The result is handled by process_event_queue(), a key press cancels the search.
+     */
+    void start_search(const search_direction dir)
     {
-	info = "searching...";
-	refresh_lines_window();
-	refresh_info();
-	refresh();
-	if (! search_next(search_rgx, display_info, f_idx)) {
-	    info = "did not find any next search match";
-	} else {
-	    info = "next match found";
+	if (! display_info->start()) {
+	    info = "no lines to search";
+	    return;
 	}
-	refresh_lines_window();
+	search_dir = dir;
+	search_id = search_in_background(search_rgx, display_info->snapshot(), f_idx, display_info->topLineNum(), dir);
+	info = "searching... press any key to cancel";
 	refresh_info();
 	refresh();
     }
 
+    /**
+     * go to the next or previous search hit.
+     * If the search hit index was not matched yet, a background search is started.
+     */
+    void go_to_search_hit(const search_direction dir)
+    {
+	if (! search_rgx) {
+	    info = "invalid search regex";
+	    return;
+	}
+	if (! search_index) {
+	    start_search(dir);
+	    return;
+	}
+	if (! display_info->start()) {
+	    info = "no lines to search";
+	    return;
+	}
+	const search_hit h = search_index_hits.find(display_info->snapshot(), display_info->topLineNum(), dir);
+	if (h.line_ == 0) {
+	    info = std::string("did not find any ") + ((dir == search_forward) ? "next" : "previous") + " search match (" + std::to_string(h.total_) + " hits)";
+	    return;
+	}
+	display_info->go_to_approx(h.line_);
+	info = "hit " + std::to_string(h.num_) + " of " + std::to_string(h.total_);
+    }
+
+    void key_n()
+    {
+	go_to_search_hit(search_forward);
+    }
+
     void key_N()
     {
-	info = "searching...";
-	refresh_lines_window();
-	refresh_info();
-	refresh();
-	if (! search_prev(search_rgx, display_info, f_idx)) {
-	    info = "did not find any next search match";
-	} else {
-	    info = "prev match found";
+	go_to_search_hit(search_backward);
+    }
+
+    /// go to the line found by the background search.
+    void search_finished(const line_number_t line_num)
+    {
+	search_id = 0;
+	const char* dir = (search_dir == search_forward) ? "next" : "previous";
+	if (line_num == 0) {
+	    info = std::string("did not find any ") + dir + " search match";
+	    return;
 	}
-	refresh_lines_window();
-	refresh_info();
-	refresh();
+	// the displayed lines could have changed while searching
+	if (! display_info->go_to(line_num)) {
+	    display_info->go_to_approx(line_num);
+	}
+	info = std::string(dir) + " match found";
     }
 
     void key_h()
@@ -875,27 +999,22 @@ namespace {
      */
     void intersect_regex(ProgressFunctor *func)
     {
-	// set up a vector regex_index lineNum_vector iterator pairs
-	std::shared_ptr<regex_index> ri;
-	lineNum_vector_intersect_vector_t v;
-	for(auto c : regex_vec) {
-	    if (c->ri_) {
-		ri = c->ri_;
-		const auto& s = ri->lineNum_vector();
-		v.push_back(std::make_pair(s.begin(), s.end()));
+	// update the line number sets of the changed filters
+	for(unsigned i = 0; i < filter_sets.size() || i < regex_vec.size(); ++i) {
+	    std::shared_ptr<regex_index> ri;
+	    if (i < regex_vec.size()) {
+		ri = regex_vec[i]->ri_;
 	    }
+	    filter_sets.set(i, ri ? filter_intersection::set_ptr(ri, &ri->lines()) : nullptr);
 	}
 
-	lineNum_vector_t s;
-
 	// if there are no regex_index objects found, show the complete file
-	if (v.empty()) {
-	    s = f_idx->lineNum_vector();
-	} else if (v.size() == 1) {
-	    // if there is only a single regex_index object, use that one
-	    s = ri->lineNum_vector();
-	} else {
-	    multiple_set_intersect(v.begin(), v.end(), std::back_insert_iterator<lineNum_vector_t>(s));
+	const auto r = filter_sets.result();
+	line_bitmap s;
+	if (r) {
+	    s = *r;
+	} else if (f_idx->size() > 0) {
+	    s.add_range(1, f_idx->size());
 	}
 
 	display_info->assign(std::move(s));
@@ -1209,6 +1328,34 @@ namespace {
 	}
     }
 
+    /**
+     * match all lines in fi with the search hit index ri.
+     * when done, add an event.
+     * This function will be executed in a background thread.
+     */
+    void parse_search_index(std::shared_ptr<file_index> fi, std::shared_ptr<regex_index> ri)
+    {
+	if (fi->parse_all_in_background(ri, search_index_idx, 0, "search index")) {
+	    eventAdd(event(ri, search_index_idx));
+	}
+    }
+
+    /// regex_index objects and their index into the regex vector.
+    typedef std::vector<std::pair<std::shared_ptr<regex_index>, unsigned>> regex_match_vec_t;
+
+    /// match several regex_index objects in one pass over the file, after it has been indexed.
+    void parse_regex_vec(std::shared_ptr<file_index> fi, regex_match_vec_t v)
+    {
+	file_index::regex_index_vec_t ri;
+	for(auto& p : v) {
+	    ri.push_back(p.first);
+	}
+	fi->parse_all(ri);
+	for(auto& p : v) {
+	    eventAdd(event(p.first, p.second));
+	}
+    }
+
     /// return values of the add_regex() function
     enum add_regex_status {
 	foundInCache,
@@ -1217,7 +1364,11 @@ namespace {
 	regexError,
     };
 
-    add_regex_status add_regex(const unsigned regex_num, std::string rgx, ProgressFunctor *func)
+    /**
+     * set a regular expression of the regex vector.
+     * @param deferred if not nullptr, a filter which has to be matched is added to deferred instead of being matched by a background thread.
+     */
+    add_regex_status add_regex(const unsigned regex_num, std::string rgx, ProgressFunctor *func, regex_match_vec_t* deferred = nullptr)
     {
 	assert(regex_num < max_regex_num);
 	assert(! rgx.empty());
@@ -1231,6 +1382,7 @@ namespace {
 	assert(rgx[0] == '/' || rgx[0] == '|');
 
 	regex_vec_resize(regex_num + 1);
+	display_changed();
 
 	// do we have the regex container already in the cache?
 	const bool isFilterRgx = is_filter_regex(rgx);
@@ -1239,6 +1391,8 @@ namespace {
 	    if (it != filter_cache.end()) {
 		// check that cache key really matches the value rgx_
 		assert(it->first == it->second->rgx_);
+		// match the lines that were appended to a followed file meanwhile
+		f_idx->match_new_lines(*it->second->ri_);
 		regex_vec[regex_num] = it->second;
 		info = "found regex in cache";
 		return foundInCache;
@@ -1257,13 +1411,24 @@ namespace {
 	    if (isFilterRgx) {
 		// Lines Filter
 		auto ri = std::make_shared<regex_index>(rgx);
-		std::thread t(parse_regex, f_idx, ri, regex_num);
-		t.detach();
+		if (f_idx->load_cache(*ri)) {
+		    c->ri_ = ri;
+		    filter_cache[rgx] = c;
+		    info = "found regex in index cache";
+		    return foundInCache;
+		}
+		c->matching_ = ri;
+		if (deferred) {
+		    deferred->push_back(std::make_pair(ri, regex_num));
+		} else {
+		    std::thread t(parse_regex, f_idx, ri, regex_num);
+		    t.detach();
+		}
 		info = "matching...";
 		return startedBackgroundMatch;
 	    } else if (is_attr_df(rgx, df_attr, df_fg, df_bg)) {
 		// Attribute Display Filter
-		c->attribute_df_rgx_ = std::make_shared<std::wregex>(to_wide(get_regex_str(rgx)));
+		c->attribute_df_rgx_ = make_regex_engine(get_regex_str(rgx), std::regex::ECMAScript);
 		c->attribute_df_attr_ = df_attr | color(df_fg, df_bg);
 		info = "created new attribute display filter";
 		return createdDisplayFilter;
@@ -1327,12 +1492,14 @@ namespace {
 	std::string rgx;
 	{
 	    curses_attr a(A_REVERSE);
+	    update_word_set();
 	    rgx = line_edit(y + regex_num, 8, c->rgx_, screen_width - 8, complete_word_set);
 	    rgx = normalize_regex(rgx);
 	}
 
 	bool should_intersect = true;
 	if (rgx.empty()) {
+	    display_changed();
 	    regex_vec[regex_num] = std::make_shared<regex_container_t>(); // overwrite with new/empty container object
 	    // pop regular expression container from vector if they're empty
 	    while(regex_vec.size() > 0 && regex_vec[regex_vec.size()-1]->rgx_.empty()) {
@@ -1367,7 +1534,7 @@ namespace {
 	int64_t l_n = atoll(line_num.c_str());
 	if (l_n < 1) {
 	    info = "invalid line number: " + line_num;
-	} else if (l_n > static_cast<int64_t>(std::numeric_limits<line_number_t>::max())) {
+	} else if (static_cast<uint64_t>(l_n) > max_line_number) {
 	    info = "line number too big: " + line_num;
 	} else if (! display_info->go_to(static_cast<line_number_t>(l_n))) {
 	    info = "line number " + line_num + " not currently displayed";
@@ -1399,7 +1566,7 @@ namespace {
      * @param[out] regex compiled regular expression if function returns empty string.
      * @return empty string upon success; error string otherwise.
      */
-    std::string compile_regex(std::string str, std::wregex& regex)
+    std::string compile_regex(std::string str, std::shared_ptr<const regex_engine>& regex)
     {
 	if (str.empty()) {
 	    return str;
@@ -1413,8 +1580,7 @@ namespace {
 	convert(flags, fl, positiveMatch);
 	std::string err;
 	try {
-	    std::wregex r(to_wide(rgx), fl);
-	    regex = r;
+	    regex = make_regex_engine(rgx, fl);
 	} catch (std::regex_error& e) {
 	    err << e.code();
 	} catch (std::runtime_error& e) {
@@ -1425,13 +1591,57 @@ namespace {
 	return err;
     }
 
+    /**
+     * match the search regular expression with all lines in a background job.
+     * Until the search hit index is matched, n and N search in the background.
+     */
+    void start_search_index()
+    {
+	file_index::abort_background_parse(search_index_idx);
+	search_index = nullptr;
+	search_index_matching = nullptr;
+	search_index_hits.reset();
+	if (search_str.empty() || ! search_err.empty()) {
+	    return;
+	}
+
+	// a search finds the matching lines, so the '!' flag is not used
+	const std::string flags = get_regex_flags(search_str);
+	std::string rgx = search_str.substr(0, search_str.size() - flags.size());
+	for(const char c : flags) {
+	    if (c != '!') {
+		rgx += c;
+	    }
+	}
+	std::shared_ptr<regex_index> ri;
+	try {
+	    ri = std::make_shared<regex_index>(rgx);
+	} catch (const std::exception&) {
+	    // the regular expression engine does not support the search regular expression
+	    return;
+	}
+	if (f_idx->load_cache(*ri)) {
+	    search_index = ri;
+	    search_index_hits.reset(ri);
+	    return;
+	}
+	search_index_matching = ri;
+	std::thread t(parse_search_index, f_idx, ri);
+	t.detach();
+    }
+
     void compile_search_regex(const std::string& str)
     {
 	search_str = normalize_regex(str);
+	search_rgx = nullptr;
+	display_changed();
 	search_err = compile_regex(str, search_rgx);
 	if (! search_err.empty()) {
 	    search_err = ": " + search_err;
 	}
+	if (f_idx) {
+	    start_search_index();
+	}
     }
 
     void edit_search()
@@ -1440,6 +1650,7 @@ namespace {
 	    curses_attr a(A_BOLD);
 	    const std::string title = "Search: ";
 	    mvprintw(search_y, 0, "%s", title.c_str());
+	    update_word_set();
 	    compile_search_regex( line_edit(search_y, title.size(), search_str, screen_width - title.size(), complete_word_set) );
 	}
 	create_windows();
@@ -1474,33 +1685,195 @@ namespace {
 #endif
     }
 
+    /**
+     * open the followed file again after it was rotated or truncated.
+     * The file is indexed again and the filters are matched again.
+     */
+    void reopen_file()
+    {
+	file_index::abort_background_parse();
+	cancel_search();
+	search_id = 0;
+	try {
+	    f_idx = std::make_shared<file_index>(real_filename, true);
+	} catch (const std::exception& e) {
+	    info = e.what();
+	    return;
+	}
+	f_idx->index_in_background(first_screen_lines);
+	// the lines of the new file have to be rendered
+	display_changed();
+
+	// the cached filters matched the old file
+	filter_cache.clear();
+	regex_match_vec_t deferred;
+	for(unsigned u = 0; u < regex_vec.size(); ++u) {
+	    const std::string rgx = regex_vec[u]->rgx_;
+	    if (! rgx.empty() && is_filter_regex(rgx)) {
+		add_regex(u, rgx, nullptr, &deferred);
+	    }
+	}
+	if (! deferred.empty()) {
+	    std::thread t(parse_regex_vec, f_idx, deferred);
+	    t.detach();
+	}
+	start_search_index();
+	intersect_regex_curses();
+	info = "opened " + command_line_filename + " again";
+    }
+
+    /**
+     * index the lines that were appended to the followed file.
+     * Only the new lines are matched with the filters and added to the displayed lines.
+     * If the last line was displayed, the display scrolls to the new last line.
+     * @return true if the displayed lines changed.
+     */
+    bool follow_file()
+    {
+	const bool at_bottom = display_info->size() == 0 || display_info->isLastLineDisplayed();
+	switch(f_idx->follow()) {
+	case file_index::file_unchanged:
+	    return false;
+	case file_index::file_replaced:
+	    reopen_file();
+	    return true;
+	case file_index::file_grew:
+	    break;
+	}
+
+	// match the new lines with the filters and intersect only the new lines
+	std::vector<filter_intersection::set_ptr> added;
+	for(auto c : regex_vec) {
+	    if (c->ri_) {
+		added.push_back(std::make_shared<const line_bitmap>(f_idx->match_new_lines(*c->ri_)));
+	    } else {
+		added.push_back(nullptr);
+	    }
+	}
+	if (search_index) {
+	    f_idx->match_new_lines(*search_index);
+	}
+	const auto r = filter_sets.grow(added);
+	if (r) {
+	    display_info->append(*r);
+	} else {
+	    display_info->append_range(display_info->lastLineNum() + 1, f_idx->size());
+	}
+
+	if (at_bottom && display_info->start()) {
+	    go_to_bottom();
+	}
+	info = file_info();
+	return true;
+    }
+
+    /// send an event when the followed file changes.
+    void watch_file()
+    {
+	watcher.reset(new file_watcher(real_filename, []() { eventAdd(event(event::file_changed_t())); }));
+    }
+
+    /// start or stop following the file.
+    void key_F()
+    {
+	if (follow_mode) {
+	    follow_mode = false;
+	    watcher.reset();
+	    info = "stopped following " + command_line_filename;
+	    return;
+	}
+
+	follow_mode = true;
+	if (! f_idx->following()) {
+	    // the file has to be mapped with reserved address space
+	    reopen_file();
+	}
+	watch_file();
+	follow_file();
+	if (display_info->start()) {
+	    go_to_bottom();
+	}
+	refresh_windows();
+	info = "following " + command_line_filename;
+    }
+
     void process_event_queue()
     {
 	bool do_refresh_windows = false;
 	bool do_intersect = false;
+	bool do_follow = false;
+	std::string event_info;
 
 	while(eventPending()) {
 	    event e = eventGet();
+	    if (e.ri_ && e.ri_idx_ == search_index_idx) {
+		// ignore the search hit index of a search regular expression that was replaced meanwhile
+		if (e.ri_ == search_index_matching) {
+		    // match the lines that were appended to a followed file meanwhile
+		    f_idx->match_new_lines(*e.ri_);
+		    search_index = e.ri_;
+		    search_index_matching = nullptr;
+		    search_index_hits.reset(search_index);
+		}
+		continue;
+	    }
 	    if (e.ri_) {
 		assert(e.ri_idx_ < regex_vec.size());
 
-		// get the regex_container_t
+		// get the regex_container_t, ignore results of filters that were replaced meanwhile
 		auto c = regex_vec[e.ri_idx_];
+		if (c->matching_ != e.ri_) {
+		    continue;
+		}
+		// match the lines that were appended to a followed file meanwhile
+		f_idx->match_new_lines(*e.ri_);
 		c->ri_ = e.ri_;
+		c->matching_ = nullptr;
 		filter_cache[c->rgx_] = c;
 
 		do_intersect = true;
 		do_refresh_windows = true;
 		info.erase();
 	    }
+	    if (e.indexed_ > 0 && ! filter_sets.result()) {
+		// show the new lines of the background indexing job, if no filter is used.
+		// The event can be from a file that was opened again meanwhile.
+		const line_number_t last = display_info->lastLineNum();
+		const line_number_t indexed = std::min(e.indexed_, f_idx->size());
+		if (indexed > last) {
+		    display_info->append_range(last + 1, indexed);
+		    do_refresh_windows = true;
+		}
+	    }
+	    if (e.file_changed_) {
+		do_follow = true;
+	    }
+	    if (e.search_id_ != 0) {
+		// ignore the events of a cancelled search
+		if (e.search_id_ != search_id) {
+		    continue;
+		}
+		if (e.info_.empty()) {
+		    search_finished(e.search_line_);
+		    event_info.clear();
+		    do_refresh_windows = true;
+		    continue;
+		}
+	    }
 	    if (! e.info_.empty()) {
-		info = e.info_;
+		event_info = e.info_;
 	    }
 	}
 
 	if (do_intersect) {
 	    intersect_regex_curses();
 	}
+	if (do_follow && follow_file()) {
+	    do_refresh_windows = true;
+	}
+	if (! event_info.empty()) {
+	    info = event_info;
+	}
 	if (do_refresh_windows) {
 	    refresh_windows();
 	}
@@ -1597,6 +1970,9 @@ int realmain_impl(int argc, char * const argv[])
 	opt_goto,
 	opt_help,
 	opt_color,
+	opt_no_cache,
+	opt_follow,
+	opt_temp_limit,
     };
     const struct option longopts[] = {
 	{ "tabwidth", required_argument, nullptr, opt_tabwidth },
@@ -1605,11 +1981,17 @@ int realmain_impl(int argc, char * const argv[])
 	{ "goto", required_argument, nullptr, opt_goto },
 	{ "help", no_argument, nullptr, opt_help },
 	{ "color", no_argument, nullptr, opt_color },
+	{ "no-cache", no_argument, nullptr, opt_no_cache },
+	{ "follow", no_argument, nullptr, opt_follow },
+	{ "temp-limit", required_argument, nullptr, opt_temp_limit },
 	{ nullptr, 0, nullptr, 0 }
     };
 
     line_number_t topLine = 0;
     std::vector<std::string> command_line_filter_regex;
+    bool use_cache = true;
+    // maximum size of the temporary file for STDIN or a compressed file
+    uint64_t temp_limit = UINT64_MAX;
     int key;
     while((key = getopt_long(argc, argv, "vh?", longopts, nullptr)) > 0) {
 	switch(key) {
@@ -1627,6 +2009,14 @@ int realmain_impl(int argc, char * const argv[])
 	    use_color(true);
 	    break;
 
+	case opt_no_cache:
+	    use_cache = false;
+	    break;
+
+	case opt_follow:
+	    follow_mode = true;
+	    break;
+
 	case opt_regex:
 	    if (command_line_filter_regex.size() >= max_regex_num) {
 		std::cerr << "can only add up to " << max_regex_num << " regular expressions with the --regex argument" << std::endl;
@@ -1644,6 +2034,17 @@ int realmain_impl(int argc, char * const argv[])
 	    compile_search_regex(optarg);
 	    break;
 
+	case opt_temp_limit:
+	    {
+		const uint64_t mb = strtoull(optarg, nullptr, 10);
+		if (mb < 1 || mb > UINT64_MAX / 1024 / 1024) {
+		    std::cerr << "--temp-limit size in MB is invalid: " << optarg << std::endl;
+		    return EX_USAGE;
+		}
+		temp_limit = mb * 1024 * 1024;
+	    }
+	    break;
+
 	case opt_tabwidth:
 	    tab_width = atoi(optarg);
 	    if (tab_width > 80) {
@@ -1657,10 +2058,13 @@ int realmain_impl(int argc, char * const argv[])
 	    break;
 
 	case opt_goto:
-	    topLine = atoi(optarg);
-	    if (topLine < 1) {
-		std::cerr << "--goto line number is invalid: " << optarg << std::endl;
-		return EX_USAGE;
+	    {
+		const uint64_t l = strtoull(optarg, nullptr, 10);
+		if (l < 1 || l > max_line_number) {
+		    std::cerr << "--goto line number is invalid: " << optarg << std::endl;
+		    return EX_USAGE;
+		}
+		topLine = l;
 	    }
 	    break;
 	}
@@ -1670,78 +2074,106 @@ int realmain_impl(int argc, char * const argv[])
 	command_line_filename = argv[optind];
     }
 
-    // if we should read from STDIN, create a temporary file
+    // a temporary file is followed, so its line index is not cached, see file_index.
+    // The seek index of a compressed file is cached.
+    if (use_cache) {
+	index_cache_setup(default_cache_dir());
+    }
+
+    // if we should read from STDIN or a compressed file, create a temporary file.
+    // The data is appended to it in the background and the file is followed while it grows.
     real_filename = command_line_filename;
-    std::shared_ptr<TemporaryFile> stdin_tmpfile;
+    std::shared_ptr<TemporaryFile> temporary_file;
     if (command_line_filename == "-") {
-	stdin_tmpfile = std::make_shared<TemporaryFile>();
-	real_filename = to_utf8(stdin_tmpfile->filename());
-	FILE *f = stdin_tmpfile->file();
-	if (!f) {
-	    std::cerr << "could not open temporary file " << real_filename << " for writing: " << errno_str() << std::endl;
-	    return EX_CANTCREAT;
-	}
+	temporary_file = std::make_shared<TemporaryFile>();
+	real_filename = to_utf8(temporary_file->filename());
 	if (verbose) {
 	    std::clog << "read STDIN into " << real_filename << std::endl;
 	}
-	while(!feof(stdin)) {
-	    char buf[65536];
-	    int r = fread(buf, 1, sizeof(buf), stdin);
-	    if (r > 0) {
-		int w = fwrite(buf, 1, r, f);
-		if (w != r) {
-		    std::cerr << "could not write STDIN into temporary file: " << errno_str() << std::endl;
-		    return EX_IOERR;
-		}
-	    } else if (r == 0) {
-		break;
-	    } else {
-		std::cerr << "could not read from STDIN: " << errno_str() << std::endl;
-		return EX_IOERR;
-	    }
+	if (! read_stream_in_background(stdin, real_filename,
+					[]() { eventAdd(event(event::file_changed_t())); },
+					[](const std::string& msg) { eventAdd(event(msg)); }, temp_limit)) {
+	    std::cerr << "could not open temporary file " << real_filename << " for writing: " << errno_str() << std::endl;
+	    return EX_CANTCREAT;
 	}
-	stdin_tmpfile->close();
-	clearerr(stdin);
 
 	if (! open_tty_as_stdin()) {
 	    std::cerr << "could not open console directly." << std::endl;
 	    return EX_IOERR;
 	}
+    } else {
+	// a compressed file is decompressed into a temporary file like STDIN
+	const compression_t c = detect_compression(command_line_filename);
+	if (c != compression_none) {
+	    // the seek index is built when the file is decompressed the first time.
+	    // With the cached seek index the file is decompressed in parallel.
+	    file_identity id;
+	    std::shared_ptr<seek_index> index;
+	    if (seek_index::supported(c) && get_file_identity(command_line_filename, id)) {
+		index = std::make_shared<seek_index>(c);
+		index->load_cache(id);
+	    }
+	    const bool cached_index = index && index->complete();
+	    stream_read_t decompressor;
+	    try {
+		decompressor = open_decompressor(command_line_filename, c, index);
+	    } catch (const std::exception& e) {
+		std::cerr << command_line_filename << ": " << e.what() << std::endl;
+		return EX_DATAERR;
+	    }
+	    temporary_file = std::make_shared<TemporaryFile>();
+	    real_filename = to_utf8(temporary_file->filename());
+	    if (verbose) {
+		std::clog << "decompress " << compression_name(c) << " file " << command_line_filename << " into " << real_filename << std::endl;
+		if (cached_index) {
+		    std::clog << "loaded seek index with " << index->windows() << " windows from the index cache" << std::endl;
+		}
+	    }
+	    if (! read_in_background(decompressor, command_line_filename, real_filename,
+				     []() { eventAdd(event(event::file_changed_t())); },
+				     [index, id, cached_index](const std::string& msg) {
+					 // the index is complete if the whole file was decompressed
+					 if (index && ! cached_index) {
+					     index->save_cache(id);
+					 }
+					 eventAdd(event(msg));
+				     }, temp_limit)) {
+		std::cerr << "could not open temporary file " << real_filename << " for writing: " << errno_str() << std::endl;
+		return EX_CANTCREAT;
+	    }
+	}
     }
 
     setlocale(LC_ALL, "");
     display_info = std::make_shared<DisplayInfo>();
 
-    f_idx = std::make_shared<file_index>(real_filename);
+    f_idx = std::make_shared<file_index>(real_filename, follow_mode || temporary_file);
+    if (verbose && f_idx->loaded_from_cache()) {
+	std::clog << "loaded line index of " << real_filename << " from the index cache" << std::endl;
+    }
+
+    // index the first screens, the remaining lines are indexed in the background
+    f_idx->index_in_background(topLine + first_screen_lines);
+
+    // filters which are not in the index cache are matched in one pass after the file is indexed
     {
-	file_index::regex_index_vec_t v;
-	for(auto rgx_ : command_line_filter_regex) {
-	    auto rgx = normalize_regex(rgx_);
-	    if (filter_cache.count(rgx) > 0) {
-		std::clog << "--regex '" << rgx << "' seen more than once." << std::endl;
-		continue;
+	regex_match_vec_t deferred;
+	for(unsigned u = 0; u != command_line_filter_regex.size(); ++u) {
+	    const add_regex_status s = add_regex(u, command_line_filter_regex[u], nullptr, &deferred);
+	    if (s == regexError) {
+		std::cerr << "invalid --regex '" << command_line_filter_regex[u] << "': " << info << " " << regex_vec[u]->err_ << std::endl;
+		return EX_USAGE;
+	    }
+	    if (s == foundInCache && verbose) {
+		std::clog << "loaded --regex '" << command_line_filter_regex[u] << "' from the index cache" << std::endl;
 	    }
-	    auto ri = std::make_shared<regex_index>(rgx);
-	    v.push_back(ri);
-
-	    auto c = std::make_shared<regex_container_t>();
-	    c->rgx_ = rgx;
-	    c->ri_ = ri;
-	    filter_cache[rgx] = c;
-	}
-	OStreamProgressFunctor func(std::clog, "parsing line: ");
-	f_idx->parse_all(v, &func);
-    }
-    for(unsigned u = 0; u != command_line_filter_regex.size(); ++u) {
-	const add_regex_status s = add_regex(u, command_line_filter_regex[u], nullptr);
-	if (s == createdDisplayFilter) {
-	    continue;
 	}
-	if (s != foundInCache) {
-	    std::cerr << "did not find cached regex '" << command_line_filter_regex[u] << "'" << std::endl;
-	    return EX_SOFTWARE;
+	if (! deferred.empty()) {
+	    std::thread t(parse_regex_vec, f_idx, deferred);
+	    t.detach();
 	}
     }
+    start_search_index();
     {
 	std::shared_ptr<OStreamProgressFunctor> func;
 	if (command_line_filter_regex.size() > 0 && verbose) {
@@ -1750,8 +2182,11 @@ int realmain_impl(int argc, char * const argv[])
 	intersect_regex(func.get());
     }
 
-    const std::string stdinfo = command_line_filename + " (" + std::to_string(f_idx->size()) + " lines)";
-    info = stdinfo;
+    info = file_info();
+
+    if (follow_mode) {
+	watch_file();
+    }
 
     line_edit_history = std::make_shared<History>(line_edit_history_rc);
 
@@ -1781,13 +2216,21 @@ int realmain_impl(int argc, char * const argv[])
 	    process_event_queue();
 	} while(key == ERR);
 
+	// any key cancels the background search
+	if (search_id != 0) {
+	    cancel_search();
+	    search_id = 0;
+	    info = "search cancelled";
+	    continue;
+	}
+
 	if (verbose) {
-	    info= stdinfo + " "
+	    info= file_info() + " "
 		+ std::to_string(f_idx->perc(display_info->topLineNum())) + "%"
 		+ " use " + std::to_string(getCurrentRSS()/1024/1024) + " MB"
 		;
 	} else {
-	    info = stdinfo;
+	    info = file_info();
 	}
 #if defined(__unix__)
 	check_for_zombies();
@@ -1888,6 +2331,10 @@ int realmain_impl(int argc, char * const argv[])
 	    key_A();
 	    break;
 
+	case 'F':
+	    key_F();
+	    break;
+
 	case '1':
 	case '2':
 	case '3':
@@ -1958,6 +2405,12 @@ int realmain_impl(int argc, char * const argv[])
     if (use_color()) {
 	std::cout << " --color";
     }
+    if (! use_cache) {
+	std::cout << " --no-cache";
+    }
+    if (follow_mode) {
+	std::cout << " --follow";
+    }
     std::cout << " '" << command_line_filename << "'" << std::endl;
 
     // print comment line for ack
@@ -2025,6 +2478,7 @@ int realmain(int argc, char * const argv[])
 	std::cerr << std::endl << exit_msg << std::endl;
     }
 
+    watcher.reset();
     f_idx = nullptr;
     return exit_status;
 }
@@ -0,0 +1,101 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "regex_engine.h"
+#include <stdexcept>
+
+#if defined(USE_RE2)
+std::unique_ptr<regex_engine> make_re2_engine(const std::string& rgx, std::regex_constants::syntax_option_type fl);
+std::unique_ptr<regex_engine_set> make_re2_engine_set(const std::vector<regex_with_flags_t>& rgx);
+#endif
+
+namespace {
+    /// regular expression engine of the C++ standard library.
+    class std_regex_engine : public regex_engine
+    {
+	std::regex rgx_;
+
+    public:
+	explicit std_regex_engine(std::regex&& rgx) : rgx_(std::move(rgx)) {}
+
+	virtual bool search(const char* beg, const char* end) const
+	{
+	    return std::regex_search(beg, end, rgx_);
+	}
+
+	virtual void find_all(const char* beg, const char* end, std::vector<match_t>& matches) const
+	{
+	    matches.clear();
+	    for(std::cregex_iterator it(beg, end, rgx_), it_end; it != it_end; ++it) {
+		if (it->length() > 0) {
+		    matches.push_back(match_t(it->position(), it->length()));
+		}
+	    }
+	}
+
+	virtual const char* name() const { return "std"; }
+    };
+}
+
+std::unique_ptr<regex_engine>
+make_regex_engine(const std::string& rgx, std::regex_constants::syntax_option_type fl, const char* engine)
+{
+    if (! engine) {
+	engine = regex_engine_default();
+    }
+    const std::string e = engine;
+
+    // check the syntax, this throws std::regex_error for invalid patterns.
+    std::regex r(rgx, fl);
+
+#if defined(USE_RE2)
+    if (e == "re2") {
+	auto p = make_re2_engine(rgx, fl);
+	if (p) {
+	    return p;
+	}
+    } else
+#endif
+    if (e != "std") {
+	throw std::runtime_error("unknown regular expression engine: " + e);
+    }
+
+    return std::unique_ptr<regex_engine>(new std_regex_engine(std::move(r)));
+}
+
+std::unique_ptr<regex_engine_set>
+make_regex_engine_set(const std::vector<regex_with_flags_t>& rgx, const char* engine)
+{
+    if (! engine) {
+	engine = regex_engine_default();
+    }
+#if defined(USE_RE2)
+    if (std::string(engine) == "re2") {
+	return make_re2_engine_set(rgx);
+    }
+#endif
+    // std::regex can not combine regular expressions
+    (void)rgx;
+    return nullptr;
+}
+
+std::vector<std::string>
+regex_engine_names()
+{
+    std::vector<std::string> v = { "std" };
+#if defined(USE_RE2)
+    v.push_back("re2");
+#endif
+    return v;
+}
+
+const char*
+regex_engine_default()
+{
+#if defined(USE_RE2)
+    return "re2";
+#else
+    return "std";
+#endif
+}
@@ -0,0 +1,85 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+/**
+ * interface of a regular expression engine that searches lines.
+ * A regex_engine object can be used by multiple threads at the same time.
+ */
+class regex_engine
+{
+public:
+    virtual ~regex_engine() {}
+
+    /// @return true if the regular expression matches a part of [beg, end).
+    virtual bool search(const char* beg, const char* end) const = 0;
+
+    /// offset and length in bytes of a match.
+    typedef std::pair<size_t, size_t> match_t;
+
+    /**
+     * find all matches of the regular expression in [beg, end).
+     * The search continues after the end of each match. Empty matches are not reported.
+     * @param[out] matches the matches in ascending order, the offsets are relative to beg.
+     *             The vector is cleared first, so it can be reused without allocating memory.
+     */
+    virtual void find_all(const char* beg, const char* end, std::vector<match_t>& matches) const = 0;
+
+    /// @return name of the engine.
+    virtual const char* name() const = 0;
+};
+
+/**
+ * compile a regular expression.
+ * The pattern is always checked with std::regex first, so an invalid pattern throws the same
+ * std::regex_error with every engine. If the selected engine can not handle the pattern,
+ * e.g. because it uses back references, the std::regex engine is used.
+ *
+ * @param rgx regular expression string in ECMAScript syntax without slashes and flags.
+ * @param fl std::regex flags, see convert(). Only std::regex::icase is used by other engines.
+ * @param engine name of the engine; if nullptr use regex_engine_default().
+ * @throws std::regex_error if rgx is not a valid regular expression.
+ * @throws std::runtime_error if the engine is unknown.
+ */
+std::unique_ptr<regex_engine> make_regex_engine(const std::string& rgx, std::regex_constants::syntax_option_type fl, const char* engine = nullptr);
+
+/// @return names of the engines that were compiled into the program.
+std::vector<std::string> regex_engine_names();
+
+/// @return name of the engine that is used by default. It is selected at build time, see the Makefile.
+const char* regex_engine_default();
+
+/**
+ * interface of a regular expression engine that searches several regular expressions in one pass.
+ * A regex_engine_set object can be used by multiple threads at the same time.
+ */
+class regex_engine_set
+{
+public:
+    virtual ~regex_engine_set() {}
+
+    /**
+     * search all regular expressions.
+     * @param[out] found the indexes of the regular expressions that match a part of [beg, end).
+     * @return false if the engine failed, e.g. because it ran out of memory. Then found is not valid
+     *         and the regular expressions have to be searched one by one.
+     */
+    virtual bool search(const char* beg, const char* end, std::vector<int>& found) const = 0;
+};
+
+/// regular expression and its std::regex flags.
+typedef std::pair<std::string, std::regex_constants::syntax_option_type> regex_with_flags_t;
+
+/**
+ * combine regular expressions into a single automaton.
+ * @param rgx regular expressions, the index in rgx is reported by regex_engine_set::search().
+ * @param engine name of the engine; if nullptr use regex_engine_default().
+ * @return nullptr if the engine can not combine regular expressions or does not support one of them.
+ */
+std::unique_ptr<regex_engine_set> make_regex_engine_set(const std::vector<regex_with_flags_t>& rgx, const char* engine = nullptr);
@@ -0,0 +1,159 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "regex_engine.h"
+#include "regex_index.h"
+#include "file_index.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <chrono>
+#include <cstring>
+
+namespace {
+    const std::vector<std::string> lines = {
+	"",
+	"2016-02-01 12:00:01 INFO user_id=42 login",
+	"2016-02-01 12:00:02 ERROR disk full",
+	"2016-02-01 12:00:03 error: retry",
+	"abcabc",
+	"tab\tseparated\tvalues",
+	"caf\xc3\xa9 UTF-8",
+	"[brackets] (parens) {braces}",
+    };
+
+    const std::vector<std::string> patterns = {
+	"ERROR",
+	"error",
+	"user_id=\\d+",
+	"^2016.*INFO",
+	"full$",
+	"\\bretry\\b",
+	"[[:digit:]]{2}:[0-9]{2}",
+	"(abc){2}",
+	"(abc)\\1",
+	"a(?=b)",
+	"\\t",
+	"caf\xc3\xa9",
+	"\\[\\w+\\]",
+	"^$",
+	"x|y|z",
+    };
+
+    /// @return the results of rgx for all lines.
+    std::vector<bool> search_all(const regex_engine& rgx)
+    {
+	std::vector<bool> v;
+	for(auto& l : lines) {
+	    v.push_back(rgx.search(l.data(), l.data() + l.size()));
+	}
+	return v;
+    }
+}
+
+TEST(regex_engine, std_engine_is_always_available)
+{
+    const auto v = regex_engine_names();
+    ASSERT_FALSE(v.empty());
+    ASSERT_EQ(std::string("std"), v[0]);
+    ASSERT_EQ(std::string("std"), make_regex_engine("abc", std::regex::ECMAScript, "std")->name());
+}
+
+TEST(regex_engine, throws_for_unknown_engine)
+{
+    ASSERT_THROW(make_regex_engine("abc", std::regex::ECMAScript, "unknown engine"), std::runtime_error);
+}
+
+TEST(regex_engine, throws_regex_error_for_invalid_pattern)
+{
+    for(auto& e : regex_engine_names()) {
+	ASSERT_THROW(make_regex_engine("(abc", std::regex::ECMAScript, e.c_str()), std::regex_error);
+    }
+}
+
+TEST(regex_engine, all_engines_return_identical_results)
+{
+    for(auto& p : patterns) {
+	for(auto icase : { false, true }) {
+	    std::regex_constants::syntax_option_type fl = std::regex::ECMAScript;
+	    if (icase) {
+		fl |= std::regex::icase;
+	    }
+	    auto expected = search_all(*make_regex_engine(p, fl, "std"));
+	    for(auto& e : regex_engine_names()) {
+		auto rgx = make_regex_engine(p, fl, e.c_str());
+		ASSERT_EQ(expected, search_all(*rgx)) << "pattern " << p << " engine " << rgx->name();
+	    }
+	}
+    }
+}
+
+TEST(regex_engine, find_all_returns_identical_matches)
+{
+    std::vector<regex_engine::match_t> expected, found;
+    for(auto& p : patterns) {
+	auto std_rgx = make_regex_engine(p, std::regex::ECMAScript, "std");
+	for(auto& e : regex_engine_names()) {
+	    auto rgx = make_regex_engine(p, std::regex::ECMAScript, e.c_str());
+	    for(auto& l : lines) {
+		std_rgx->find_all(l.data(), l.data() + l.size(), expected);
+		rgx->find_all(l.data(), l.data() + l.size(), found);
+		ASSERT_EQ(expected, found) << "pattern " << p << " engine " << rgx->name() << " line " << l;
+	    }
+	}
+    }
+}
+
+TEST(regex_engine, find_all_reports_offsets_in_bytes)
+{
+    const std::string l = "caf\xc3\xa9 abc caf\xc3\xa9" "abc";
+    std::vector<regex_engine::match_t> m;
+    for(auto& e : regex_engine_names()) {
+	make_regex_engine("abc", std::regex::ECMAScript, e.c_str())->find_all(l.data(), l.data() + l.size(), m);
+	ASSERT_EQ(2u, m.size()) << e;
+	ASSERT_EQ(regex_engine::match_t(6, 3), m[0]) << e;
+	ASSERT_EQ(regex_engine::match_t(15, 3), m[1]) << e;
+	// the buffer is cleared, empty matches are not reported
+	make_regex_engine("x*", std::regex::ECMAScript, e.c_str())->find_all(l.data(), l.data() + l.size(), m);
+	ASSERT_TRUE(m.empty()) << e;
+	// a match at the start of the line is only found at the start
+	make_regex_engine("^caf", std::regex::ECMAScript, e.c_str())->find_all(l.data(), l.data() + l.size(), m);
+	ASSERT_EQ(1u, m.size()) << e;
+    }
+}
+
+TEST(regex_engine, benchmark)
+{
+    TemporaryFile tmp;
+    {
+	std::string s;
+	for(unsigned i = 0; i < 200000; ++i) {
+	    s += "2016-02-01 12:" + std::to_string(i % 60) + ":" + std::to_string(i % 59) + " ";
+	    s += (i % 100) ? "INFO request handled" : "ERROR request failed";
+	    s += " user_id=" + std::to_string(i * 7919u % 100000u) + " path=/api/v1/items/" + std::to_string(i) + "\n";
+	}
+	FILE *f = tmp.file();
+	ASSERT_TRUE(f != nullptr);
+	ASSERT_EQ(s.size(), fwrite(s.data(), 1, s.size(), f));
+	ASSERT_TRUE(tmp.close());
+    }
+
+    auto f_idx = std::make_shared<file_index>(to_utf8(tmp.filename()));
+    f_idx->parse_all();
+    for(auto p : { "/ERROR/", "/user_id=\\d+5 /", "/(info|error) request (handled|failed)/i" }) {
+	lineNum_vector_t expected;
+	for(auto& e : regex_engine_names()) {
+	    auto ri = std::make_shared<regex_index>(p, e.c_str());
+	    const auto start = std::chrono::steady_clock::now();
+	    f_idx->parse_all(ri);
+	    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	    std::clog << "regex engine benchmark: " << ri->engine() << " " << p << " matched " << ri->size()
+		      << " of " << f_idx->size() << " lines in " << ms << " ms" << std::endl;
+	    if (expected.empty()) {
+		expected = ri->lineNum_vector();
+	    }
+	    ASSERT_EQ(expected, ri->lineNum_vector());
+	}
+    }
+}
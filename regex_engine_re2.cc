@@ -0,0 +1,117 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#if defined(USE_RE2)
+#include "regex_engine.h"
+#include <re2/re2.h>
+#include <re2/set.h>
+
+namespace {
+    /**
+     * regular expression engine using the RE2 library.
+     * RE2 matches with a DFA in linear time, but does not support back references and look ahead.
+     */
+    class re2_engine : public regex_engine
+    {
+	RE2 rgx_;
+
+    public:
+	re2_engine(const std::string& rgx, const RE2::Options& opt) : rgx_(rgx, opt) {}
+
+	bool ok() const { return rgx_.ok(); }
+
+	virtual bool search(const char* beg, const char* end) const
+	{
+	    return RE2::PartialMatch(re2::StringPiece(beg, end - beg), rgx_);
+	}
+
+	virtual void find_all(const char* beg, const char* end, std::vector<match_t>& matches) const
+	{
+	    matches.clear();
+	    // the text is passed as a whole, so ^ and \b see the bytes before pos
+	    const re2::StringPiece text(beg, end - beg);
+	    re2::StringPiece m;
+	    size_t pos = 0;
+	    while(pos <= text.size() && rgx_.Match(text, pos, text.size(), RE2::UNANCHORED, &m, 1)) {
+		const size_t first = m.data() - beg;
+		if (m.size() > 0) {
+		    matches.push_back(match_t(first, m.size()));
+		    pos = first + m.size();
+		} else {
+		    pos = first + 1;
+		}
+	    }
+	}
+
+	virtual const char* name() const { return "re2"; }
+    };
+
+    /// combined DFA of several regular expressions using RE2::Set.
+    class re2_engine_set : public regex_engine_set
+    {
+	RE2::Set set_;
+
+    public:
+	explicit re2_engine_set(const RE2::Options& opt) : set_(opt, RE2::UNANCHORED) {}
+
+	bool add(const std::string& rgx)
+	{
+	    return set_.Add(rgx, nullptr) >= 0;
+	}
+
+	bool compile() { return set_.Compile(); }
+
+	virtual bool search(const char* beg, const char* end, std::vector<int>& found) const
+	{
+	    found.clear();
+	    RE2::Set::ErrorInfo err;
+	    err.kind = RE2::Set::kNoError;
+	    set_.Match(re2::StringPiece(beg, end - beg), &found, &err);
+	    return err.kind == RE2::Set::kNoError;
+	}
+    };
+
+    /// @return the RE2 options that match the behavior of std::regex.
+    RE2::Options options(const bool case_sensitive)
+    {
+	RE2::Options opt;
+	// std::regex works on bytes, not on UTF-8 characters
+	opt.set_encoding(RE2::Options::EncodingLatin1);
+	opt.set_case_sensitive(case_sensitive);
+	opt.set_log_errors(false);
+	// allow large DFAs for complex filters
+	opt.set_max_mem(64 << 20);
+	return opt;
+    }
+}
+
+/// @return a RE2 engine object; nullptr if RE2 does not support rgx.
+std::unique_ptr<regex_engine>
+make_re2_engine(const std::string& rgx, std::regex_constants::syntax_option_type fl)
+{
+    std::unique_ptr<re2_engine> e(new re2_engine(rgx, options(! (fl & std::regex::icase))));
+    if (! e->ok()) {
+	return nullptr;
+    }
+    return std::move(e);
+}
+
+/// @return a RE2::Set engine object; nullptr if RE2 does not support one of the regular expressions.
+std::unique_ptr<regex_engine_set>
+make_re2_engine_set(const std::vector<regex_with_flags_t>& rgx)
+{
+    std::unique_ptr<re2_engine_set> e(new re2_engine_set(options(true)));
+    for(auto& r : rgx) {
+	// the case sensitivity is set per regular expression
+	const bool icase = r.second & std::regex::icase;
+	if (! e->add(icase ? "(?i:" + r.first + ")" : r.first)) {
+	    return nullptr;
+	}
+    }
+    if (! e->compile()) {
+	return nullptr;
+    }
+    return std::move(e);
+}
+#endif
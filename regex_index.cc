@@ -4,7 +4,9 @@
  */
 #include "regex_index.h"
 #include "normalize_regex.h"
+#include "index_cache.h"
 #include <iostream>
+#include <cassert>
 
 void convert(const std::string& flags, std::regex_constants::syntax_option_type& fl, bool& positiveMatch)
 {
@@ -25,26 +27,87 @@ void convert(const std::string& flags, std::regex_constants::syntax_option_type&
     fl = flg;
 }
 
-regex_index::regex_index(std::string rgx) :
+regex_index::regex_index(std::string rgx, const char* engine) :
+    matched_(0),
     positive_match_(true)
 {
     rgx = normalize_regex(std::move(rgx));
+    rgx_str_ = rgx;
     const std::string flags = get_regex_flags(rgx);
     rgx = get_regex_str(std::move(rgx));
     std::regex_constants::syntax_option_type fl;
     convert(flags, fl, positive_match_);
-    rgx_.assign(std::move(rgx), fl);
+    rgx_ = make_regex_engine(rgx, fl, engine);
+    prefilter_ = literal_prefilter(rgx, (fl & std::regex::icase) != 0);
+    rgx_flags_ = regex_with_flags_t(std::move(rgx), fl);
+}
+
+bool
+regex_index::matches(const line_t& line) const
+{
+    bool res = prefilter_.may_match(line.beg_, line.end_);
+    if (res && !prefilter_.pure()) {
+	res = rgx_->search(line.beg_, line.end_);
+    }
+    return positive_match_ == res;
 }
 
 void
 regex_index::match(const line_t& line)
 {
     //std::clog << line.num_ << ":" << line.to_string();
-    const bool res = std::regex_search(line.beg_, line.end_, rgx_);
-    if (( positive_match_ &&  res) ||
-	(!positive_match_ && !res)) {
-	lineNum_vector_.push_back(line.num_);
+    if (matches(line)) {
+	lines_.add(line.num_);
 	//std::clog << " !match!";
     }
     //std::clog << std::endl;
 }
+
+std::string
+regex_index::cache_id() const
+{
+    // the engines match the UTF-8 bytes of a line, not its characters
+    std::string s = "few regex bitmap\n" + rgx_str_ + '\n' + engine() + " bytes";
+    if (rgx_flags_.second & std::regex::icase) {
+	s += " icase";
+    }
+    return s + '\n';
+}
+
+std::string
+regex_index::cache_name(const file_identity& id) const
+{
+    return cache_id() + id.path_;
+}
+
+std::string
+regex_index::cache_key(const file_identity& id) const
+{
+    return cache_id() + id.key();
+}
+
+bool
+regex_index::load_cache(const file_identity& id)
+{
+    if (! index_cache_enabled(id)) {
+	return false;
+    }
+    index_cache_file c(cache_name(id), cache_key(id), ".regex");
+    if (! c.valid()) {
+	return false;
+    }
+    return lines_.deserialize(c.data(), c.size());
+}
+
+void
+regex_index::save_cache(const file_identity& id) const
+{
+    if (! index_cache_enabled(id)) {
+	return;
+    }
+    const std::string s = lines_.serialize();
+    index_cache_writer w(cache_name(id), cache_key(id), ".regex", s.size());
+    if (w.write(s.data(), s.size())) {
+	w.commit();
+    }
+}
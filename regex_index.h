@@ -4,6 +4,10 @@
  */
 #pragma once
 #include "line.h"
+#include "file_identity.h"
+#include "regex_engine.h"
+#include "literal_prefilter.h"
+#include "line_bitmap.h"
 #include <memory>
 #include <regex>
 
@@ -19,22 +23,110 @@ void convert(const std::string& flags, std::regex_constants::syntax_option_type&
 
 class regex_index
 {
-    lineNum_vector_t lineNum_vector_;
-    std::regex rgx_;
+    /// the matching line numbers.
+    line_bitmap lines_;
+    /// number of lines that have been matched.
+    line_number_t matched_;
+    std::unique_ptr<regex_engine> rgx_;
+    /// lines without the required literal are not searched with rgx_.
+    literal_prefilter prefilter_;
     bool positive_match_;
+    /// the normalized regular expression string with flags.
+    std::string rgx_str_;
+    /// the regular expression string without slashes and flags and its std::regex flags.
+    regex_with_flags_t rgx_flags_;
+
+    /// @return the regular expression, its engine and the flags, which identify the cached line numbers.
+    std::string cache_id() const;
+
+    /// @return key of the cached line numbers for the file id.
+    std::string cache_key(const file_identity& id) const;
 
 public:
     /**
      * create regular expression index object.
      * @param rgx a (normalized) regular expression string.
+     * @param engine name of the regular expression engine, see make_regex_engine().
      * @throws std::runtime_error if regular expression could not be parsed.
      */
-    explicit regex_index(std::string rgx);
+    explicit regex_index(std::string rgx, const char* engine = nullptr);
+
+    /// @return the normalized regular expression string with flags.
+    const std::string& str() const { return rgx_str_; }
+
+    /// @return name of the used regular expression engine.
+    const char* engine() const { return rgx_->name(); }
+
+    /// @return a new regex_index object with its own copy of the regular expression and no matched lines.
+    std::shared_ptr<regex_index> clone() const { return std::make_shared<regex_index>(rgx_str_, engine()); }
+
+    /// @return true if line should be added to the set, i.e. the regular expression matches and no '!' flag was used.
+    bool matches(const line_t& line) const;
 
     /// match line against the provisioned regular expression. If it matches add the line (number) to the set.
     void match(const line_t& line);
 
-    unsigned size() const { return lineNum_vector_.size(); }
+    /// @return true if the regular expression engine finds the regular expression in line. The prefilter and the '!' flag are not used.
+    bool search(const line_t& line) const { return rgx_->search(line.beg_, line.end_); }
+
+    /**
+     * add the line (number) to the set, if found is true and no '!' flag was used or if found is false and the '!' flag was used.
+     * Use this function if the line was searched with another engine than the one of this object.
+     * @param line the line, which has to follow the lines already in the set.
+     * @param found true if the regular expression was found in the line.
+     */
+    void add_result(const line_t& line, const bool found)
+    {
+	if (found == positive_match_) {
+	    lines_.add(line.num_);
+	}
+    }
+
+    /// @return false if the '!' flag was used.
+    bool positive_match() const { return positive_match_; }
+
+    /// @return the literal prefilter of the regular expression.
+    const literal_prefilter& prefilter() const { return prefilter_; }
 
-    const lineNum_vector_t& lineNum_vector() { return lineNum_vector_; }
+    /// @return the regular expression string without slashes and flags and its std::regex flags.
+    const regex_with_flags_t& regex_with_flags() const { return rgx_flags_; }
+
+    /**
+     * add line numbers to the set.
+     * @param v line numbers, which have to be greater than the line numbers already in the set.
+     */
+    void append(line_bitmap&& v) { lines_.append(std::move(v)); }
+
+    /// reduce the memory used by the set, call this after all lines were matched.
+    void optimize() { lines_.optimize(); }
+
+    line_number_t size() const { return lines_.cardinality(); }
+
+    /// @return number of lines of the file that have been matched; 0 if unknown, e.g. if the lines were loaded from the index cache.
+    line_number_t matched() const { return matched_; }
+
+    /// set the number of lines of the file that have been matched.
+    void set_matched(const line_number_t num) { matched_ = num; }
+
+    /// @return the set of matching line numbers.
+    const line_bitmap& lines() const { return lines_; }
+
+    /// @return the matching line numbers in a vector.
+    lineNum_vector_t lineNum_vector() const { return lines_.to_vector(); }
+
+    /// @return name of the cached line numbers for the file id, which is the same for all versions of the file.
+    std::string cache_name(const file_identity& id) const;
+
+    /**
+     * load the matching line numbers from the index cache.
+     * @param id identity of the file that is matched.
+     * @return true if the line numbers were found in the index cache.
+     */
+    bool load_cache(const file_identity& id);
+
+    /**
+     * write the matching line numbers to the index cache.
+     * Only call this function after all lines of the file id have been matched.
+     */
+    void save_cache(const file_identity& id) const;
 };
@@ -42,8 +42,9 @@ TEST(regex_index, intersect_works)
     auto b = std::make_shared<regex_index>("contains");
     fi->parse_all(b);
 
-    lineNum_vector_intersect_vector_t v = { std::make_pair(a->lineNum_vector().begin(), a->lineNum_vector().end()),
-					    std::make_pair(b->lineNum_vector().begin(), b->lineNum_vector().end()) };
+    const lineNum_vector_t av = a->lineNum_vector(), bv = b->lineNum_vector();
+    lineNum_vector_intersect_vector_t v = { std::make_pair(av.begin(), av.end()),
+					    std::make_pair(bv.begin(), bv.end()) };
     lineNum_vector_t s;
     ASSERT_EQ(1u, multiple_set_intersect(v.begin(), v.end(), std::back_insert_iterator<lineNum_vector_t>(s)));
     ASSERT_EQ(1u, s.size());
@@ -52,8 +53,12 @@ TEST(regex_index, intersect_works)
     fi->parse_all(c);
     ASSERT_EQ(0u, c->size());
 
-    v[1] = std::make_pair(c->lineNum_vector().begin(), c->lineNum_vector().end());
+    const lineNum_vector_t cv = c->lineNum_vector();
+    v[1] = std::make_pair(cv.begin(), cv.end());
     s.clear();
     ASSERT_EQ(0u, multiple_set_intersect(v.begin(), v.end(), std::back_insert_iterator<lineNum_vector_t>(s)));
     ASSERT_EQ(0u, s.size());
+
+    ASSERT_EQ(1u, line_bitmap::and_(a->lines(), b->lines()).cardinality());
+    ASSERT_TRUE(line_bitmap::and_(a->lines(), c->lines()).empty());
 }
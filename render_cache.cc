@@ -0,0 +1,45 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "render_cache.h"
+
+void
+render_cache::next_screen()
+{
+    previous_.swap(current_);
+    current_.clear();
+}
+
+std::shared_ptr<const rendered_line>
+render_cache::find(const line_number_t num, const unsigned generation)
+{
+    auto it = current_.find(num);
+    if (it != current_.end()) {
+	return (it->second.generation_ == generation) ? it->second.line_ : nullptr;
+    }
+    it = previous_.find(num);
+    if (it == previous_.end() || it->second.generation_ != generation) {
+	return nullptr;
+    }
+    // the line is used for the current screen
+    auto line = it->second.line_;
+    current_[num] = it->second;
+    previous_.erase(it);
+    return line;
+}
+
+void
+render_cache::insert(const line_number_t num, const unsigned generation, std::shared_ptr<const rendered_line> line)
+{
+    entry& e = current_[num];
+    e.generation_ = generation;
+    e.line_ = line;
+}
+
+void
+render_cache::clear()
+{
+    current_.clear();
+    previous_.clear();
+}
@@ -0,0 +1,77 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "types.h"
+#include "curses_attr.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * a line as it is displayed in the lines window: the decoded characters and their curses attributes.
+ * It does not depend on the screen size, the line is wrapped when it is printed.
+ */
+struct rendered_line
+{
+    /// number of bytes of the line in the file, a line which is still written can grow.
+    size_t file_size_ = 0;
+    /// the UTF-8 bytes of the line after the replace display filters were applied.
+    std::string text_;
+    /// the decoded characters.
+    std::wstring chars_;
+    /// curses attribute of each character.
+    std::vector<curses_attr_t> attr_;
+    /// index into links_ of the link or email of each character; -1 if the character is not part of one.
+    std::vector<int> link_;
+    /// the links followed by the emails of the line.
+    std::vector<std::wstring> links_;
+    /// number of links in links_.
+    size_t num_links_ = 0;
+};
+
+/**
+ * cache of the rendered lines of the last two screens, so scrolling only renders the lines that become visible.
+ * A line is rendered with the display filters and the search regular expression, which are identified by a
+ * generation number. A cached line of another generation is not used.
+ */
+class render_cache
+{
+    struct entry
+    {
+	unsigned generation_;
+	std::shared_ptr<const rendered_line> line_;
+    };
+    typedef std::unordered_map<line_number_t, entry> map_t;
+
+    /// the lines of the screen which is rendered.
+    map_t current_;
+    /// the lines of the previous screen.
+    map_t previous_;
+
+public:
+    /**
+     * start to render a screen.
+     * The lines of the screen before the previous screen are dropped.
+     */
+    void next_screen();
+
+    /**
+     * look up a rendered line and keep it for the current screen.
+     * @param num line number.
+     * @param generation generation of the display filters.
+     * @return the rendered line; nullptr if it is not cached.
+     */
+    std::shared_ptr<const rendered_line> find(const line_number_t num, const unsigned generation);
+
+    /// add the rendered line num of the display filter generation to the current screen.
+    void insert(const line_number_t num, const unsigned generation, std::shared_ptr<const rendered_line> line);
+
+    /// drop all lines.
+    void clear();
+
+    /// @return number of cached lines.
+    size_t size() const { return current_.size() + previous_.size(); }
+};
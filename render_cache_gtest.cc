@@ -0,0 +1,53 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "render_cache.h"
+
+TEST(render_cache, finds_lines_of_the_same_generation)
+{
+    render_cache c;
+    auto l = std::make_shared<const rendered_line>();
+    c.next_screen();
+    ASSERT_TRUE(c.find(1, 0) == nullptr);
+    c.insert(1, 0, l);
+    ASSERT_EQ(l, c.find(1, 0));
+    // the display filters changed
+    ASSERT_TRUE(c.find(1, 1) == nullptr);
+    c.next_screen();
+    ASSERT_TRUE(c.find(1, 1) == nullptr);
+    ASSERT_EQ(l, c.find(1, 0));
+    c.clear();
+    ASSERT_EQ(0u, c.size());
+    ASSERT_TRUE(c.find(1, 0) == nullptr);
+}
+
+TEST(render_cache, keeps_the_lines_of_the_last_two_screens)
+{
+    render_cache c;
+    // the first screen shows lines 1..3
+    c.next_screen();
+    for(line_number_t n = 1; n <= 3; ++n) {
+	c.insert(n, 7, std::make_shared<const rendered_line>());
+    }
+    // scrolling down by one line only renders line 4
+    c.next_screen();
+    unsigned rendered = 0;
+    for(line_number_t n = 2; n <= 4; ++n) {
+	if (! c.find(n, 7)) {
+	    c.insert(n, 7, std::make_shared<const rendered_line>());
+	    ++rendered;
+	}
+    }
+    ASSERT_EQ(1u, rendered);
+    ASSERT_EQ(4u, c.size());
+    // line 1 of the first screen is dropped when the third screen is rendered
+    c.next_screen();
+    ASSERT_TRUE(c.find(1, 7) == nullptr);
+    ASSERT_TRUE(c.find(2, 7) != nullptr);
+    ASSERT_EQ(3u, c.size());
+    c.next_screen();
+    c.next_screen();
+    ASSERT_EQ(0u, c.size());
+}
@@ -4,43 +4,153 @@
  */
 
 #include "search.h"
-#include "to_wide.h"
+#include "event.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <thread>
 
-bool
-search_next(std::wregex rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi)
+namespace {
+    /// id of the running background search; 0 if no search runs.
+    std::atomic<unsigned> active_search_id(0);
+
+    /// id of the last started background search.
+    std::atomic<unsigned> last_search_id(0);
+
+    /// number of lines a thread of the background search matches at once.
+    const uint64_t search_chunk_lines = 4096;
+
+    /**
+     * the background search job.
+     * @param first index into lines of the first line to match, see line_bitmap::select().
+     * @param num number of lines to match, starting at first in the search direction.
+     */
+    void search_job(std::shared_ptr<const regex_engine> rgx, std::shared_ptr<const line_bitmap> lines, file_index::ptr_t fi,
+		    const uint64_t first, const uint64_t num, const search_direction dir, const unsigned id, unsigned num_threads)
+    {
+	const uint64_t num_chunks = (num + search_chunk_lines - 1) / search_chunk_lines;
+	if (num_threads == 0) {
+	    num_threads = std::thread::hardware_concurrency();
+	}
+	if (num_threads > num_chunks) {
+	    num_threads = num_chunks;
+	}
+	if (num_threads < 1) {
+	    num_threads = 1;
+	}
+
+	// the threads take the next chunk until a chunk closer to start has a match
+	std::vector<line_number_t> chunk_match(num_chunks, 0);
+	std::atomic<uint64_t> next_chunk(0);
+	std::atomic<uint64_t> found_chunk(num_chunks);
+	std::atomic<uint64_t> searched_lines(0);
+	auto search_chunks = [&](const bool report_progress) {
+	    uint64_t c;
+	    while((c = next_chunk++) < found_chunk && c < num_chunks && active_search_id == id) {
+		const uint64_t end = std::min(num, (c + 1) * search_chunk_lines);
+		line_number_t line_num = 0;
+		for(uint64_t i = c * search_chunk_lines; i < end; ++i) {
+		    if (i == c * search_chunk_lines) {
+			line_num = lines->select((dir == search_forward) ? first + i : first - i);
+		    } else {
+			line_num = (dir == search_forward) ? lines->next(line_num) : lines->prev(line_num);
+		    }
+		    const line_t line = fi->line(line_num);
+		    if (rgx->search(line.beg_, line.end_)) {
+			chunk_match[c] = line_num;
+			uint64_t f = found_chunk;
+			while(c < f && ! found_chunk.compare_exchange_weak(f, c)) {
+			}
+			break;
+		    }
+		}
+		const uint64_t searched = searched_lines += end - c * search_chunk_lines;
+		if (report_progress && (c % 64) == 63) {
+		    eventAdd(event(event::search_t(), id, 0, "searching " + std::to_string(searched * 100 / num) + "%, press any key to cancel"));
+		}
+	    }
+	};
+
+	std::vector<std::thread> threads;
+	for(unsigned t = 1; t < num_threads; ++t) {
+	    threads.push_back(std::thread(search_chunks, false));
+	}
+	search_chunks(true);
+	for(auto& t : threads) {
+	    t.join();
+	}
+
+	// a cancelled search does not send a result
+	unsigned expected = id;
+	if (! active_search_id.compare_exchange_strong(expected, 0)) {
+	    return;
+	}
+	const uint64_t f = found_chunk;
+	eventAdd(event(event::search_t(), id, (f < num_chunks) ? chunk_match[f] : 0));
+    }
+}
+
+unsigned
+search_in_background(std::shared_ptr<const regex_engine> rgx, std::shared_ptr<const line_bitmap> lines, file_index::ptr_t fi,
+		     const line_number_t start, const search_direction dir, unsigned num_threads)
 {
-    if (! di->start()) {
-	return false;
+    unsigned id = ++last_search_id;
+    if (id == 0) {
+	id = ++last_search_id;
     }
-    while(di->next()) {
-	const line_number_t num = di->current();
-	const line_t line = fi->line(num);
-	std::wstring s = to_wide(line.to_string());
-	if (std::regex_search(s, rgx)) {
-	    const bool b = di->go_to(line.num_);
-	    assert(b);
-	    return true;
-	}
+    active_search_id = id;
+
+    // the lines to match, first is the closest line to start
+    uint64_t first, num;
+    if (dir == search_forward) {
+	first = lines->rank(start);
+	num = lines->cardinality() - first;
+    } else {
+	num = (start > 0) ? lines->rank(start - 1) : 0;
+	first = num - 1;
     }
-    return false;
+
+    std::thread t(search_job, rgx, lines, fi, first, num, dir, id, num_threads);
+    t.detach();
+    return id;
 }
 
-bool
-search_prev(std::wregex rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi)
+void
+cancel_search()
 {
-    if (! di->start()) {
-	return false;
+    active_search_id = 0;
+}
+
+void
+search_hits::reset(std::shared_ptr<const regex_index> index)
+{
+    index_ = index;
+    lines_.reset();
+    lines_max_ = 0;
+    index_size_ = 0;
+    hits_.clear();
+    total_ = 0;
+}
+
+search_hit
+search_hits::find(const std::shared_ptr<const line_bitmap>& lines, const line_number_t start, const search_direction dir)
+{
+    assert(index_);
+    if (lines_.lock() != lines || lines_max_ != lines->max() || index_size_ != index_->size()) {
+	hits_ = line_bitmap::and_(*lines, index_->lines());
+	total_ = hits_.cardinality();
+	lines_ = lines;
+	lines_max_ = lines->max();
+	index_size_ = index_->size();
     }
-    while(di->prev()) {
-	const line_number_t num = di->current();
-	const line_t line = fi->line(num);
-	std::wstring s = to_wide(line.to_string());
-	if (std::regex_search(s, rgx)) {
-	    const bool b = di->go_to(line.num_);
-	    assert(b);
-	    return true;
-	}
+
+    search_hit h;
+    h.total_ = total_;
+    const line_number_t n = (dir == search_forward) ? hits_.next(start) : hits_.prev(start);
+    if (n == 0) {
+	return h;
     }
-    return false;
+    h.line_ = n;
+    h.num_ = hits_.rank(n);
+    return h;
 }
@@ -5,16 +5,83 @@
 #pragma once
 #include "display_info.h"
 #include "file_index.h"
-#include <regex>
+#include "regex_index.h"
+#include "regex_engine.h"
+
+/// direction of a search.
+enum search_direction {
+    search_forward,
+    search_backward,
+};
 
 /**
- * search for the next occurance of the regular expression rgx in di using the lines from fi.
- * @return true if a match was found; false otherwise.
+ * search for the regular expression rgx in a background job.
+ * The regular expression searches the UTF-8 bytes of the lines, they are not converted to wide characters.
+ * The lines after the line number start (before start for search_backward) are split into chunks,
+ * which are matched by several threads. The chunks are matched in the order of their distance to start
+ * and chunks behind a found match are skipped, so the job finds the nearest match.
+ * The job sends events with its progress and an event with the found line number when it finishes, see event::search_id_.
+ * Starting a search cancels the running search.
+ * @param rgx regular expression, which is shared by the threads of the job.
+ * @param lines snapshot of the displayed lines, see DisplayInfo::snapshot().
+ * @param fi file index of the lines.
+ * @param start line number where the search starts, it is not matched.
+ * @param dir search direction.
+ * @param num_threads number of threads; if 0 use one thread per core.
+ * @return id of the search job, which is sent with its events.
  */
-bool search_next(std::wregex rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi);
+unsigned search_in_background(std::shared_ptr<const regex_engine> rgx, std::shared_ptr<const line_bitmap> lines, file_index::ptr_t fi,
+			      const line_number_t start, const search_direction dir, unsigned num_threads = 0);
+
+/// cancel the running background search. The search does not send the event with the found line number.
+void cancel_search();
+
+/// a search hit among the displayed lines, see search_hits::find().
+struct search_hit
+{
+    /// line number of the hit; 0 if no hit was found.
+    line_number_t line_ = 0;
+    /// number of the hit among the displayed hits, counted from 1; 0 if no hit was found.
+    uint64_t num_ = 0;
+    /// number of displayed hits.
+    uint64_t total_ = 0;
+};
 
 /**
- * search for the previous occurance of the regular expression rgx in di using the lines from fi.
- * @return true if a match was found; false otherwise.
+ * the hits of the search hit index among the displayed lines.
+ * The hit index is a regex_index of the search regular expression, which is matched with the entire file
+ * by a background job. The displayed lines are intersected with its lines when find() is called after the
+ * displayed lines or the hits changed, so the next and previous hit and their number are found in the compressed intersection.
  */
-bool search_prev(std::wregex rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi);
+class search_hits
+{
+    /// the hit index; nullptr until the background job finished.
+    std::shared_ptr<const regex_index> index_;
+    /// the displayed lines, which were intersected. A weak pointer does not cause DisplayInfo to copy its lines.
+    std::weak_ptr<const line_bitmap> lines_;
+    /// largest displayed line, which was intersected. The displayed lines are only appended to.
+    line_number_t lines_max_ = 0;
+    /// number of hits, which were intersected. The hits are only appended to.
+    line_number_t index_size_ = 0;
+    /// the intersection of the displayed lines and the hits.
+    line_bitmap hits_;
+    /// number of lines in hits_.
+    uint64_t total_ = 0;
+
+public:
+    /// set the hit index; nullptr if the hit index is not available.
+    void reset(std::shared_ptr<const regex_index> index = nullptr);
+
+    /// @return the hit index; nullptr if the hit index is not available.
+    std::shared_ptr<const regex_index> index() const { return index_; }
+
+    /**
+     * find the next or previous hit.
+     * This function can only be called if the hit index is available.
+     * @param lines the displayed lines, see DisplayInfo::snapshot().
+     * @param start line number where the search starts, it is not a hit.
+     * @param dir search direction.
+     * @return the hit.
+     */
+    search_hit find(const std::shared_ptr<const line_bitmap>& lines, const line_number_t start, const search_direction dir);
+};
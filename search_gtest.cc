@@ -0,0 +1,190 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "search.h"
+#include "event.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <chrono>
+#include <thread>
+
+namespace {
+    /// @return a file index of a file with num lines, every 1000th line contains "error".
+    file_index::ptr_t make_file(TemporaryFile& tmp, const unsigned num)
+    {
+	std::string s;
+	for(unsigned i = 1; i <= num; ++i) {
+	    s += "line " + std::to_string(i) + ((i % 1000) ? " info\n" : " error\n");
+	}
+	FILE *f = tmp.file();
+	fwrite(s.data(), 1, s.size(), f);
+	tmp.close();
+	auto fi = std::make_shared<file_index>(to_utf8(tmp.filename()));
+	fi->index_all();
+	return fi;
+    }
+
+    /**
+     * wait for the background search id to finish. The other events are dropped.
+     * @return the found line number; -1 if the search did not finish.
+     */
+    int64_t wait_for_search(const unsigned id)
+    {
+	for(int i = 0; i < 1000; ++i) {
+	    while(eventPending()) {
+		const event e = eventGet();
+		if (e.search_id_ == id && e.info_.empty()) {
+		    return e.search_line_;
+		}
+	    }
+	    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return -1;
+    }
+
+    std::shared_ptr<const regex_engine> make_rgx(const std::string& rgx)
+    {
+	return make_regex_engine(rgx, std::regex::ECMAScript);
+    }
+
+    /// @return the displayed lines v.
+    std::shared_ptr<const line_bitmap> make_lines(const lineNum_vector_t& v)
+    {
+	auto b = std::make_shared<line_bitmap>();
+	for(auto n : v) {
+	    b->add(n);
+	}
+	return b;
+    }
+
+    int64_t search(std::shared_ptr<const regex_engine> rgx, std::shared_ptr<const line_bitmap> lines, file_index::ptr_t fi,
+		   const line_number_t start, const search_direction dir, const unsigned num_threads)
+    {
+	return wait_for_search(search_in_background(rgx, lines, fi, start, dir, num_threads));
+    }
+}
+
+TEST(search, finds_the_nearest_match)
+{
+    TemporaryFile tmp;
+    auto fi = make_file(tmp, 100000);
+    auto lines = make_lines(fi->lineNum_vector());
+    const auto rgx = make_rgx("error");
+    for(unsigned t = 1; t <= 4; ++t) {
+	ASSERT_EQ(1000, search(rgx, lines, fi, 1, search_forward, t));
+	ASSERT_EQ(51000, search(rgx, lines, fi, 50000, search_forward, t));
+	// the start line is not matched
+	ASSERT_EQ(52000, search(rgx, lines, fi, 51000, search_forward, t));
+	ASSERT_EQ(100000, search(rgx, lines, fi, 99999, search_forward, t));
+	ASSERT_EQ(0, search(rgx, lines, fi, 100000, search_forward, t));
+
+	ASSERT_EQ(50000, search(rgx, lines, fi, 50999, search_backward, t));
+	ASSERT_EQ(50000, search(rgx, lines, fi, 51000, search_backward, t));
+	ASSERT_EQ(0, search(rgx, lines, fi, 999, search_backward, t));
+	ASSERT_EQ(0, search(rgx, lines, fi, 1, search_backward, t));
+    }
+    ASSERT_EQ(0, search(make_rgx("warning"), lines, fi, 1, search_forward, 4));
+    ASSERT_FALSE(eventPending());
+}
+
+TEST(search, searches_only_the_given_lines)
+{
+    TemporaryFile tmp;
+    auto fi = make_file(tmp, 10000);
+    // a start line which is not in the lines
+    auto lines = make_lines(lineNum_vector_t({ 5, 2000, 2001, 7000, 9000 }));
+    const auto rgx = make_rgx("error");
+    ASSERT_EQ(2000, search(rgx, lines, fi, 1, search_forward, 2));
+    ASSERT_EQ(7000, search(rgx, lines, fi, 2500, search_forward, 2));
+    ASSERT_EQ(2000, search(rgx, lines, fi, 6999, search_backward, 2));
+    ASSERT_EQ(0, search(rgx, make_lines(lineNum_vector_t()), fi, 1, search_forward, 2));
+    ASSERT_FALSE(eventPending());
+}
+
+TEST(search, new_search_cancels_the_running_search)
+{
+    TemporaryFile tmp;
+    auto fi = make_file(tmp, 100000);
+    auto lines = make_lines(fi->lineNum_vector());
+    const unsigned first = search_in_background(make_rgx("warning"), lines, fi, 1, search_forward, 1);
+    const unsigned second = search_in_background(make_rgx("error"), lines, fi, 1, search_forward, 1);
+    ASSERT_NE(first, second);
+    ASSERT_EQ(1000, wait_for_search(second));
+    // the first search either finished before the second search started or sends no result
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    while(eventPending()) {
+	const event e = eventGet();
+	ASSERT_TRUE(e.search_id_ != first || ! e.info_.empty() || e.search_line_ == 0);
+    }
+}
+
+TEST(search_hits, counts_the_displayed_hits)
+{
+    TemporaryFile tmp;
+    auto fi = make_file(tmp, 10000);
+    auto ri = std::make_shared<regex_index>("/error/");
+    fi->parse_all(ri);
+    ASSERT_EQ(10u, ri->size());
+
+    search_hits h;
+    h.reset(ri);
+    auto all = make_lines(fi->lineNum_vector());
+    search_hit s = h.find(all, 1, search_forward);
+    ASSERT_EQ(1000u, s.line_);
+    ASSERT_EQ(1u, s.num_);
+    ASSERT_EQ(10u, s.total_);
+    // the start line is not a hit
+    s = h.find(all, 3000, search_forward);
+    ASSERT_EQ(4000u, s.line_);
+    ASSERT_EQ(4u, s.num_);
+    s = h.find(all, 3000, search_backward);
+    ASSERT_EQ(2000u, s.line_);
+    ASSERT_EQ(2u, s.num_);
+    s = h.find(all, 10000, search_forward);
+    ASSERT_EQ(0u, s.line_);
+    ASSERT_EQ(0u, s.num_);
+    ASSERT_EQ(10u, s.total_);
+    s = h.find(all, 1000, search_backward);
+    ASSERT_EQ(0u, s.line_);
+
+    // only the displayed hits are counted
+    auto lines = make_lines(lineNum_vector_t({ 5, 2000, 2001, 7000, 9000 }));
+    s = h.find(lines, 1, search_forward);
+    ASSERT_EQ(2000u, s.line_);
+    ASSERT_EQ(1u, s.num_);
+    ASSERT_EQ(3u, s.total_);
+    // a start line which is not displayed
+    s = h.find(lines, 8000, search_backward);
+    ASSERT_EQ(7000u, s.line_);
+    ASSERT_EQ(2u, s.num_);
+    s = h.find(make_lines(lineNum_vector_t()), 1, search_forward);
+    ASSERT_EQ(0u, s.line_);
+    ASSERT_EQ(0u, s.total_);
+}
+
+TEST(search_hits, follows_appended_lines)
+{
+    TemporaryFile tmp;
+    auto fi = make_file(tmp, 3000);
+    auto ri = std::make_shared<regex_index>("/error/");
+    fi->parse_all(ri);
+
+    search_hits h;
+    h.reset(ri);
+    DisplayInfo di;
+    di.assign(fi->lineNum_vector());
+    ASSERT_EQ(3u, h.find(di.snapshot(), 1, search_forward).total_);
+
+    // lines and hits which are appended in place are intersected again
+    di.append_range(3001, 5000);
+    line_bitmap b;
+    b.add(4000);
+    b.add(5000);
+    ri->append(std::move(b));
+    const search_hit s = h.find(di.snapshot(), 3000, search_forward);
+    ASSERT_EQ(4000u, s.line_);
+    ASSERT_EQ(4u, s.num_);
+    ASSERT_EQ(5u, s.total_);
+}
@@ -0,0 +1,188 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "seek_index.h"
+#include "index_cache.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+    /// header of a serialized index, followed by the points.
+    struct serialized_index
+    {
+	uint64_t size;
+	uint32_t compression;
+	uint32_t points;
+    };
+
+    /// header of a serialized point, followed by the window, padded to 8 bytes.
+    struct serialized_point
+    {
+	uint64_t in;
+	uint64_t out;
+	uint32_t bits;
+	uint32_t window;
+    };
+
+    /// the deflate format refers to at most 32 KiB of previous data.
+    const uint32_t max_window = 32768;
+
+    inline uint64_t padded(const uint64_t bytes) { return (bytes + 7) & ~uint64_t(7); }
+
+    std::string cache_name(const file_identity& id)
+    {
+	return "few seek index\n" + id.path_;
+    }
+
+    std::string cache_key(const file_identity& id)
+    {
+	return "few seek index\n" + id.key();
+    }
+}
+
+seek_index::seek_index(const compression_t c, const uint64_t span) :
+    c_(c),
+    span_(span),
+    size_(0),
+    complete_(false)
+{
+}
+
+bool
+seek_index::supported(const compression_t c)
+{
+    return c == compression_gzip || c == compression_zstd;
+}
+
+void
+seek_index::add(seek_point&& p)
+{
+    assert(! complete_);
+    assert(points_.empty() || points_.back().out_ < p.out_);
+    assert(p.window_.size() <= max_window);
+    points_.push_back(std::move(p));
+}
+
+void
+seek_index::finish(const uint64_t size)
+{
+    // a point at the end of the file, e.g. after the last zstd frame, starts an empty window
+    while(points_.size() > 1 && points_.back().out_ >= size) {
+	points_.pop_back();
+    }
+    if (points_.empty()) {
+	// an empty file
+	points_.push_back(seek_point());
+    }
+    size_ = size;
+    complete_ = true;
+}
+
+size_t
+seek_index::find(const uint64_t offset) const
+{
+    if (offset >= size_) {
+	return points_.size();
+    }
+    const auto it = std::upper_bound(points_.begin(), points_.end(), offset, [](const uint64_t o, const seek_point& p) { return o < p.out_; });
+    return it - points_.begin() - 1;
+}
+
+std::string
+seek_index::serialize() const
+{
+    std::string s;
+    serialized_index h;
+    h.size = size_;
+    h.compression = c_;
+    h.points = static_cast<uint32_t>(points_.size());
+    s.append(reinterpret_cast<const char*>(&h), sizeof(h));
+    for(const auto& p : points_) {
+	serialized_point sp;
+	sp.in = p.in_;
+	sp.out = p.out_;
+	sp.bits = p.bits_;
+	sp.window = static_cast<uint32_t>(p.window_.size());
+	s.append(reinterpret_cast<const char*>(&sp), sizeof(sp));
+	s.append(p.window_);
+	s.append(padded(p.window_.size()) - p.window_.size(), '\0');
+    }
+    return s;
+}
+
+bool
+seek_index::deserialize(const void* data, const uint64_t size)
+{
+    points_.clear();
+    size_ = 0;
+    complete_ = false;
+
+    const char* p = static_cast<const char*>(data);
+    const char* end = p + size;
+    serialized_index h;
+    if (size < sizeof(h)) {
+	return false;
+    }
+    memcpy(&h, p, sizeof(h));
+    p += sizeof(h);
+    if (h.compression != uint32_t(c_) || h.points == 0) {
+	return false;
+    }
+    for(uint32_t i = 0; i < h.points; ++i) {
+	serialized_point sp;
+	if (uint64_t(end - p) < sizeof(sp)) {
+	    points_.clear();
+	    return false;
+	}
+	memcpy(&sp, p, sizeof(sp));
+	p += sizeof(sp);
+	// the points are in ascending order, the first point is at the start of the file
+	const bool ascending = points_.empty() ? sp.out == 0 : (sp.out > points_.back().out_ && sp.in >= points_.back().in_);
+	if (! ascending || sp.out > h.size || sp.bits > 7 || sp.window > max_window || uint64_t(end - p) < padded(sp.window)) {
+	    points_.clear();
+	    return false;
+	}
+	seek_point pt;
+	pt.in_ = sp.in;
+	pt.out_ = sp.out;
+	pt.bits_ = sp.bits;
+	pt.window_.assign(p, sp.window);
+	p += padded(sp.window);
+	points_.push_back(std::move(pt));
+    }
+    if (p != end) {
+	points_.clear();
+	return false;
+    }
+    size_ = h.size;
+    complete_ = true;
+    return true;
+}
+
+bool
+seek_index::load_cache(const file_identity& id)
+{
+    if (! index_cache_enabled(id)) {
+	return false;
+    }
+    index_cache_file c(cache_name(id), cache_key(id), ".seek");
+    if (! c.valid()) {
+	return false;
+    }
+    return deserialize(c.data(), c.size());
+}
+
+void
+seek_index::save_cache(const file_identity& id) const
+{
+    if (! complete_ || ! index_cache_enabled(id)) {
+	return;
+    }
+    const std::string s = serialize();
+    index_cache_writer w(cache_name(id), cache_key(id), ".seek", s.size());
+    if (w.write(s.data(), s.size())) {
+	w.commit();
+    }
+}
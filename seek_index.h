@@ -0,0 +1,106 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "decompress.h"
+#include "file_identity.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/// a position in a compressed file at which decompression can start.
+struct seek_point
+{
+    /// offset of the first compressed byte after the point.
+    uint64_t in_;
+    /// offset of the first decompressed byte after the point.
+    uint64_t out_;
+    /// gzip: number of bits of the byte before in_ which belong to the data after the point.
+    uint32_t bits_;
+    /// gzip: the decompressed data before the point, up to 32 KiB, which is the dictionary of the following data.
+    std::string window_;
+
+    seek_point() : in_(0), out_(0), bits_(0) {}
+};
+
+/// default distance of the seek points in decompressed bytes.
+const uint64_t seek_span = 8*1024*1024;
+
+/**
+ * seek points of a compressed file, which split the decompressed data into windows.
+ * A window is decompressed without the data before it, see decompress_window().
+ *
+ * gzip files get a seek point at a deflate block boundary about every span bytes, like zlib's zran
+ * example. zstd files get a seek point at the start of a frame, a file which consists of a single frame
+ * has a single window. xz files are not indexed.
+ *
+ * The index is built while the file is decompressed, see open_decompressor(), and stored in the index
+ * cache, so a file is decompressed in parallel when it is opened again.
+ */
+class seek_index
+{
+    compression_t c_;
+    uint64_t span_;
+    std::vector<seek_point> points_;
+    /// number of decompressed bytes.
+    uint64_t size_;
+    bool complete_;
+
+public:
+    explicit seek_index(const compression_t c, const uint64_t span = seek_span);
+
+    /// @return true if files with compression format c can be indexed.
+    static bool supported(const compression_t c);
+
+    /// @return compression format of the file.
+    compression_t compression() const { return c_; }
+
+    /// @return true if the decompressor should add a seek point at the decompressed offset out.
+    bool wants_point(const uint64_t out) const { return points_.empty() || out - points_.back().out_ >= span_; }
+
+    /// add a seek point while the file is decompressed. The points are added in ascending order.
+    void add(seek_point&& p);
+
+    /**
+     * complete the index at the end of the file.
+     * @param size number of decompressed bytes.
+     */
+    void finish(const uint64_t size);
+
+    /// @return true if the whole file was decompressed and indexed.
+    bool complete() const { return complete_; }
+
+    /// @return number of decompressed bytes, valid if complete() is true.
+    uint64_t size() const { return size_; }
+
+    /// @return number of windows.
+    size_t windows() const { return points_.size(); }
+
+    /// @return seek point at the start of window i.
+    const seek_point& point(const size_t i) const { return points_[i]; }
+
+    /// @return decompressed offset of the end of window i.
+    uint64_t window_end(const size_t i) const { return i + 1 < points_.size() ? points_[i + 1].out_ : size_; }
+
+    /// @return the window which contains the decompressed offset, windows() if offset is not in a window.
+    size_t find(const uint64_t offset) const;
+
+    /// @return the serialized index for the index cache.
+    std::string serialize() const;
+
+    /**
+     * replace the index with a serialized index.
+     * @return true upon success; false if data is not a valid serialized index, then the index is empty.
+     */
+    bool deserialize(const void* data, const uint64_t size);
+
+    /**
+     * load the index of the compressed file id from the index cache.
+     * @return true if a complete index was loaded.
+     */
+    bool load_cache(const file_identity& id);
+
+    /// store a complete index of the compressed file id in the index cache.
+    void save_cache(const file_identity& id) const;
+};
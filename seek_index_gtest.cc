@@ -0,0 +1,89 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "seek_index.h"
+
+namespace {
+    seek_point make_point(const uint64_t in, const uint64_t out, const uint32_t bits, const std::string& window)
+    {
+	seek_point p;
+	p.in_ = in;
+	p.out_ = out;
+	p.bits_ = bits;
+	p.window_ = window;
+	return p;
+    }
+}
+
+TEST(seek_index, adds_points_every_span_bytes)
+{
+    seek_index index(compression_gzip, 100);
+    ASSERT_TRUE(index.wants_point(0));
+    index.add(make_point(10, 0, 0, ""));
+    ASSERT_FALSE(index.wants_point(99));
+    ASSERT_TRUE(index.wants_point(100));
+    index.add(make_point(50, 120, 3, "abc"));
+    index.add(make_point(90, 300, 0, "def"));
+    ASSERT_FALSE(index.complete());
+
+    // a point at the end of the file is removed
+    index.finish(300);
+    ASSERT_TRUE(index.complete());
+    ASSERT_EQ(300u, index.size());
+    ASSERT_EQ(2u, index.windows());
+    ASSERT_EQ(120u, index.window_end(0));
+    ASSERT_EQ(300u, index.window_end(1));
+
+    ASSERT_EQ(0u, index.find(0));
+    ASSERT_EQ(0u, index.find(119));
+    ASSERT_EQ(1u, index.find(120));
+    ASSERT_EQ(1u, index.find(299));
+    ASSERT_EQ(2u, index.find(300));
+}
+
+TEST(seek_index, an_empty_file_has_an_empty_window)
+{
+    seek_index index(compression_zstd);
+    index.finish(0);
+    ASSERT_TRUE(index.complete());
+    ASSERT_EQ(1u, index.windows());
+    ASSERT_EQ(0u, index.window_end(0));
+    ASSERT_EQ(1u, index.find(0));
+}
+
+TEST(seek_index, serializes_the_points)
+{
+    seek_index index(compression_gzip, 100);
+    index.add(make_point(10, 0, 0, ""));
+    index.add(make_point(50, 120, 3, "abcdefghij"));
+    index.finish(500);
+    const std::string s = index.serialize();
+
+    seek_index copy(compression_gzip);
+    ASSERT_TRUE(copy.deserialize(s.data(), s.size()));
+    ASSERT_TRUE(copy.complete());
+    ASSERT_EQ(500u, copy.size());
+    ASSERT_EQ(2u, copy.windows());
+    ASSERT_EQ(50u, copy.point(1).in_);
+    ASSERT_EQ(120u, copy.point(1).out_);
+    ASSERT_EQ(3u, copy.point(1).bits_);
+    ASSERT_EQ("abcdefghij", copy.point(1).window_);
+    ASSERT_EQ(s, copy.serialize());
+
+    // the index of another compression format is rejected
+    seek_index zstd(compression_zstd);
+    ASSERT_FALSE(zstd.deserialize(s.data(), s.size()));
+
+    // truncated and corrupted data is rejected
+    for(size_t len = 0; len < s.size(); len += 7) {
+	ASSERT_FALSE(copy.deserialize(s.data(), len)) << len;
+	ASSERT_FALSE(copy.complete());
+	ASSERT_EQ(0u, copy.windows());
+    }
+    std::string corrupted = s;
+    // the out offset of the second point
+    corrupted[16 + 24 + 8] = 0;
+    ASSERT_FALSE(copy.deserialize(corrupted.data(), corrupted.size()));
+}
@@ -0,0 +1,125 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "stream_reader.h"
+#include "errno_str.h"
+#include "temporary_file.h"
+#include <cerrno>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup _dup
+#define read _read
+#define close _close
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    /// the free disk space is checked after this many bytes were appended.
+    const uint64_t free_disk_space_interval = 16*1024*1024;
+
+    std::string mb(const uint64_t bytes)
+    {
+	return std::to_string(bytes / 1024 / 1024) + " MB";
+    }
+
+    void append_stream(stream_read_t read_func, const std::string& name, const std::string& filename, FILE* out, std::function<void()> appended, std::function<void(const std::string&)> finished, const uint64_t max_size)
+    {
+	char buf[65536];
+	char last = '\n';
+	uint64_t bytes = 0;
+	uint64_t check_free_space = 0;
+	std::string msg;
+	while(true) {
+	    if (bytes >= check_free_space) {
+		if (free_disk_space(filename) < min_free_disk_space) {
+		    msg = "stopped reading " + name + " after " + mb(bytes) + ": less than " + mb(min_free_disk_space) + " free disk space for the temporary file";
+		    break;
+		}
+		check_free_space = bytes + free_disk_space_interval;
+	    }
+	    size_t r;
+	    try {
+		r = read_func(buf, sizeof(buf));
+	    } catch (std::exception& e) {
+		msg = "could not read from " + name + ": " + e.what();
+		break;
+	    }
+	    if (r == 0) {
+		break;
+	    }
+	    if (r > max_size - bytes) {
+		r = max_size - bytes;
+		msg = "stopped reading " + name + " after " + mb(max_size) + ": the temporary file reached its size limit";
+	    }
+	    if (fwrite(buf, 1, r, out) != r || fflush(out) != 0) {
+		msg = "could not write " + name + " into temporary file: " + errno_str();
+		break;
+	    }
+	    if (r > 0) {
+		last = buf[r - 1];
+		bytes += r;
+		appended();
+	    }
+	    if (! msg.empty()) {
+		break;
+	    }
+	}
+	if (last != '\n' && fputc('\n', out) != EOF && fflush(out) == 0) {
+	    appended();
+	}
+	fclose(out);
+	finished(msg.empty() ? "read " + std::to_string(bytes) + " bytes from " + name : msg);
+    }
+
+    /// closes the file descriptor when the last copy of the read function is destroyed.
+    class fd_reader
+    {
+	const int fd_;
+    public:
+	explicit fd_reader(const int fd) : fd_(fd) {}
+	~fd_reader() { close(fd_); }
+
+	size_t read(char* buf, const size_t len)
+	{
+	    // read() returns the available data, so slow producers are shown immediately.
+	    // A signal like SIGWINCH interrupts a blocked read, which is retried.
+	    decltype(::read(fd_, buf, len)) r;
+	    do {
+		r = ::read(fd_, buf, len);
+	    } while (r < 0 && errno == EINTR);
+	    if (r < 0) {
+		throw std::runtime_error(errno_str());
+	    }
+	    return r;
+	}
+    };
+}
+
+bool read_in_background(stream_read_t read_func, const std::string& name, const std::string& filename, std::function<void()> appended, std::function<void(const std::string&)> finished, const uint64_t max_size)
+{
+    FILE* out = fopen(filename.c_str(), "ab");
+    if (! out) {
+	return false;
+    }
+    // the thread reads until the end of the stream, it may outlive the program's main loop
+    std::thread t(append_stream, read_func, name, filename, out, appended, finished, max_size);
+    t.detach();
+    return true;
+}
+
+bool read_stream_in_background(FILE* in, const std::string& filename, std::function<void()> appended, std::function<void(const std::string&)> finished, const uint64_t max_size)
+{
+    const int fd = dup(fileno(in));
+    if (fd < 0) {
+	return false;
+    }
+    auto reader = std::make_shared<fd_reader>(fd);
+    return read_in_background([reader](char* buf, const size_t len) { return reader->read(buf, len); },
+			      "STDIN", filename, appended, finished, max_size);
+}
@@ -0,0 +1,51 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <stdint.h>
+
+/**
+ * function which reads the next data of a stream.
+ * The function returns the available data, it does not have to fill buf.
+ * @param buf buffer to read into.
+ * @param len size of buf in bytes.
+ * @return number of bytes read; 0 at the end of the stream.
+ * @throws std::runtime_error if the stream could not be read.
+ */
+typedef std::function<size_t(char* buf, size_t len)> stream_read_t;
+
+/// number of bytes that read_in_background() leaves free on the file system of the file it appends to.
+const uint64_t min_free_disk_space = 256*1024*1024;
+
+/**
+ * append the data of a stream to a file in a background thread.
+ * The data is written to the file as soon as it is read, so the file can be followed with
+ * file_index::follow() while the stream is read. A missing newline character at the end of
+ * the stream is added, so the last line is indexed.
+ * Reading stops when the file reached max_size bytes or when less than min_free_disk_space bytes
+ * are left on its file system, so a huge stream does not fill the disk.
+ * @param read function which reads the stream, it is called by the background thread.
+ * @param name name of the stream for the messages passed to finished.
+ * @param filename file to append to.
+ * @param appended called by the background thread after data was appended to the file.
+ * @param finished called by the background thread at the end of the stream with a message.
+ * @param max_size maximum number of bytes appended to the file.
+ * @return true if the thread was started; false if filename could not be opened.
+ */
+bool read_in_background(stream_read_t read, const std::string& name, const std::string& filename, std::function<void()> appended, std::function<void(const std::string&)> finished, const uint64_t max_size = UINT64_MAX);
+
+/**
+ * append the data of a stream to a file in a background thread, see read_in_background().
+ * A duplicate of the file descriptor of in is read, so in can be replaced, e.g. by open_tty_as_stdin().
+ * @param in input stream.
+ * @param filename file to append to.
+ * @param appended called by the background thread after data was appended to the file.
+ * @param finished called by the background thread at the end of the stream with a message.
+ * @param max_size maximum number of bytes appended to the file.
+ * @return true if the thread was started; false if in could not be duplicated or filename could not be opened.
+ */
+bool read_stream_in_background(FILE* in, const std::string& filename, std::function<void()> appended, std::function<void(const std::string&)> finished, const uint64_t max_size = UINT64_MAX);
@@ -0,0 +1,167 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "stream_reader.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+TEST(stream_reader, appends_the_stream_to_a_file)
+{
+    TemporaryFile in_file, out_file;
+    const std::string s = "first line\nsecond line without newline";
+    FILE* in = in_file.file();
+    ASSERT_TRUE(in != nullptr);
+    ASSERT_EQ(s.size(), fwrite(s.data(), 1, s.size(), in));
+    ASSERT_EQ(0, fflush(in));
+    rewind(in);
+    const std::string out_fn = to_utf8(out_file.filename());
+
+    std::atomic_int appended(0);
+    std::atomic_bool finished(false);
+    std::mutex m;
+    std::string msg;
+    ASSERT_TRUE(read_stream_in_background(in, out_fn, [&]() { ++appended; }, [&](const std::string& str) {
+		std::lock_guard<std::mutex> _(m);
+		msg = str;
+		finished = true;
+	    }));
+    for(int i = 0; i < 500 && ! finished; ++i) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(finished);
+    ASSERT_TRUE(in_file.close());
+
+    // the missing newline is added
+    ASSERT_GE(appended, 1);
+    {
+	std::lock_guard<std::mutex> _(m);
+	ASSERT_EQ("read " + std::to_string(s.size()) + " bytes from STDIN", msg);
+    }
+    std::ifstream is(out_fn, std::ios::binary);
+    std::stringstream ss;
+    ss << is.rdbuf();
+    ASSERT_EQ(s + "\n", ss.str());
+}
+
+TEST(stream_reader, stops_at_the_size_limit)
+{
+    TemporaryFile out_file;
+    const std::string out_fn = to_utf8(out_file.filename());
+    // an endless stream of lines
+    const std::string line = "0123456789\n";
+    stream_read_t read = [line](char* buf, const size_t len) {
+	const size_t n = std::min(len, line.size());
+	memcpy(buf, line.data(), n);
+	return n;
+    };
+
+    std::atomic_bool finished(false);
+    std::mutex m;
+    std::string msg;
+    ASSERT_TRUE(read_in_background(read, "endless", out_fn, []() {}, [&](const std::string& str) {
+		std::lock_guard<std::mutex> _(m);
+		msg = str;
+		finished = true;
+	    }, 1000));
+    for(int i = 0; i < 500 && ! finished; ++i) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(finished);
+    {
+	std::lock_guard<std::mutex> _(m);
+	ASSERT_NE(std::string::npos, msg.find("size limit")) << msg;
+    }
+    // the incomplete last line is terminated
+    std::ifstream is(out_fn, std::ios::binary);
+    std::stringstream ss;
+    ss << is.rdbuf();
+    ASSERT_EQ(1001u, ss.str().size());
+    ASSERT_EQ('\n', ss.str().back());
+}
+
+#if !defined(_WIN32)
+namespace {
+    std::atomic_int interrupts(0);
+    void count_interrupt(int) { ++interrupts; }
+}
+
+TEST(stream_reader, retries_a_read_interrupted_by_a_signal)
+{
+    TemporaryFile out_file;
+    const std::string out_fn = to_utf8(out_file.filename());
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    FILE* in = fdopen(fds[0], "rb");
+    ASSERT_TRUE(in != nullptr);
+
+    // without SA_RESTART a blocked read fails with EINTR
+    struct sigaction sa, old_sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = count_interrupt;
+    sigemptyset(&sa.sa_mask);
+    ASSERT_EQ(0, sigaction(SIGUSR1, &sa, &old_sa));
+
+    std::atomic_bool has_reader(false);
+    pthread_t reader;
+    std::atomic_bool finished(false);
+    std::mutex m;
+    std::string msg;
+    ASSERT_TRUE(read_stream_in_background(in, out_fn, [&]() {
+		if (! has_reader) {
+		    reader = pthread_self();
+		    has_reader = true;
+		}
+	    }, [&](const std::string& str) {
+		std::lock_guard<std::mutex> _(m);
+		msg = str;
+		finished = true;
+	    }));
+    fclose(in);
+
+    const std::string first = "first line\n", second = "second line\n";
+    ASSERT_EQ(ssize_t(first.size()), write(fds[1], first.data(), first.size()));
+    for(int i = 0; i < 500 && ! has_reader; ++i) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(has_reader);
+    // the reader thread now blocks in read()
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(0, pthread_kill(reader, SIGUSR1));
+    for(int i = 0; i < 500 && interrupts == 0; ++i) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(1, interrupts);
+    ASSERT_FALSE(finished);
+
+    ASSERT_EQ(ssize_t(second.size()), write(fds[1], second.data(), second.size()));
+    close(fds[1]);
+    for(int i = 0; i < 500 && ! finished; ++i) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(0, sigaction(SIGUSR1, &old_sa, nullptr));
+    ASSERT_TRUE(finished);
+    {
+	std::lock_guard<std::mutex> _(m);
+	ASSERT_EQ("read " + std::to_string(first.size() + second.size()) + " bytes from STDIN", msg);
+    }
+    std::ifstream is(out_fn, std::ios::binary);
+    std::stringstream ss;
+    ss << is.rdbuf();
+    ASSERT_EQ(first + second, ss.str());
+}
+#endif
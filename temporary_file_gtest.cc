@@ -34,3 +34,12 @@ TEST(TemporaryFile, can_create_a_file)
     fclose(f);
     ASSERT_STREQ(expected, buf);
 }
+
+TEST(TemporaryFile, free_disk_space)
+{
+    TemporaryFile tmp;
+    const uint64_t s = free_disk_space(to_utf8(tmp.filename()));
+    ASSERT_GT(s, 0u);
+    ASSERT_NE(UINT64_MAX, s);
+    ASSERT_EQ(UINT64_MAX, free_disk_space(to_utf8(tmp.filename()) + ".does_not_exist/file"));
+}
@@ -5,6 +5,16 @@
 #pragma once
 #include <string>
 std::wstring to_wide(const std::string& s);
+/**
+ * convert [beg, end) to wide characters, without allocating memory if out is large enough.
+ * On Unix the bytes are decoded as UTF-8, see utf8_decode().
+ * @param[out] out the wide characters; the previous contents are replaced.
+ */
+void to_wide(const char* beg, const char* end, std::wstring& out);
 inline std::wstring to_wide(const std::wstring& s) { return s; }
+/**
+ * convert wide characters to a string.
+ * On Unix the characters are encoded as UTF-8, see utf8_encode().
+ */
 std::string to_utf8(const std::wstring& s);
 inline std::string to_utf8(const std::string& s) { return s; }
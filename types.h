@@ -6,8 +6,20 @@
 #include <stdint.h>
 #include <vector>
 
+#ifdef LINE_NUMBER_64
+#include "packed_vector.h"
+/// 64bit line numbers for files with more than 2^32-1 lines, build with LINE_NUMBER_64=1.
+typedef uint64_t line_number_t;
+/// the line numbers are stored in 5 bytes, so a line number vector uses 25% more memory than with 32bit line numbers, not 100%.
+typedef packed_vector<line_number_t, 5> lineNum_vector_t;
+/// the largest line number, the lines after it are not indexed.
+const line_number_t max_line_number = lineNum_vector_t::max_value;
+#else
 typedef uint32_t line_number_t;
 typedef std::vector<line_number_t> lineNum_vector_t;
+/// the largest line number, the lines after it are not indexed.
+const line_number_t max_line_number = UINT32_MAX;
+#endif
 typedef std::vector<std::pair<lineNum_vector_t::const_iterator, lineNum_vector_t::const_iterator>> lineNum_vector_intersect_vector_t;
 
 #if defined(_WIN32)
@@ -0,0 +1,75 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "file_identity.h"
+#include "getenv_str.h"
+#include <cstdlib>
+#include <errno.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool
+get_file_identity(const std::string& filename, file_identity& id)
+{
+    struct stat buf;
+    if (stat(filename.c_str(), &buf) < 0) {
+	return false;
+    }
+    if (! S_ISREG(buf.st_mode)) {
+	return false;
+    }
+
+    char *path = realpath(filename.c_str(), nullptr);
+    if (! path) {
+	return false;
+    }
+    id.path_ = path;
+    free(path);
+
+    id.inode_ = buf.st_ino;
+    id.size_ = buf.st_size;
+#if defined(__APPLE__)
+    id.mtime_ = static_cast<uint64_t>(buf.st_mtimespec.tv_sec) * 1000000000llu + buf.st_mtimespec.tv_nsec;
+#else
+    id.mtime_ = static_cast<uint64_t>(buf.st_mtim.tv_sec) * 1000000000llu + buf.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+bool
+create_directories(const std::string& dir)
+{
+    if (dir.empty()) {
+	return false;
+    }
+    struct stat buf;
+    if (stat(dir.c_str(), &buf) == 0) {
+	return S_ISDIR(buf.st_mode);
+    }
+
+    // create the parent directory first
+    auto pos = dir.rfind('/');
+    if (pos != std::string::npos && pos > 0) {
+	if (! create_directories(dir.substr(0, pos))) {
+	    return false;
+	}
+    }
+
+    return mkdir(dir.c_str(), S_IRWXU) == 0 || errno == EEXIST;
+}
+
+std::string
+default_cache_dir()
+{
+    std::string dir;
+    if (getenv_str("XDG_CACHE_HOME", dir) && !dir.empty()) {
+	return dir + "/few";
+    }
+    if (getenv_str("HOME", dir) && !dir.empty()) {
+	return dir + "/.cache/few";
+    }
+    return "";
+}
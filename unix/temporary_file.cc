@@ -11,6 +11,7 @@
 #if defined(__unix__) || defined(__APPLE__)
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/statvfs.h>
 #include <fcntl.h>
 #include <unistd.h>
 namespace {
@@ -107,3 +108,13 @@ TemporaryFile::close()
     f_ = nullptr;
     return ret == 0;
 }
+
+uint64_t
+free_disk_space(const std::string& filename)
+{
+    struct statvfs s;
+    if (statvfs(filename.c_str(), &s) < 0) {
+	return UINT64_MAX;
+    }
+    return static_cast<uint64_t>(s.f_bavail) * s.f_frsize;
+}
@@ -3,53 +3,25 @@
  * :indentSize=4:tabSize=8:
  */
 #include "to_wide.h"
-#include <cassert>
-#include <cstring>
-#include <cstdlib>
-#include <errno.h>
+#include "utf8_decode.h"
 
 std::wstring to_wide(const std::string& s)
 {
     std::wstring out;
-    if (s.empty()) {
-	return out;
-    }
-
-    auto src = s.c_str();
-    while(true) {
-	std::wstring wline(s.size(), L'\0');
-	mbstate_t ps; memset(&ps, 0, sizeof(ps));
-	auto w_line_size = mbsrtowcs(const_cast<wchar_t*>(wline.c_str()), &src, wline.size(), &ps);
-	if (w_line_size == (size_t) -1) {
-	    assert(errno == EILSEQ);
-
-	    // find how many wide characters seem valid
-	    int i;
-	    for(i = wline.size()-1; i >= 0 && wline[i] == 0; --i) { }
-	    if (i >= 0) {
-		wline.erase(i + 1);
-		out += wline;
-	    }
-
-	    out += L'\uFFFD';
-	    ++src;
-	} else {
-	    wline.resize(w_line_size);
-	    out += wline;
-	    break;
-	}
-    }
+    to_wide(s.data(), s.data() + s.size(), out);
     return out;
 }
 
+void to_wide(const char* beg, const char* end, std::wstring& out)
+{
+    out.clear();
+    utf8_decode(beg, end, out);
+}
+
 std::string to_utf8(const std::wstring& s)
 {
-    auto len = wcstombs(nullptr, s.c_str(), 0);
-    if (len == (size_t)-1) {
-	return "";
-    }
-    std::string utf8(len, ' ');
-    auto l = wcstombs(const_cast<char*>(utf8.data()), s.c_str(), utf8.size()+1);
-    assert(l == len);
-    return utf8;
+    // encode UTF-8 like to_wide() decodes it, independent of the locale
+    std::string out;
+    utf8_encode(s.data(), s.data() + s.size(), out);
+    return out;
 }
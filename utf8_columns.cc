@@ -0,0 +1,34 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "utf8_columns.h"
+#include "utf8_decode.h"
+
+void
+utf8_columns::assign(const char* beg, const char* end)
+{
+    chars_.clear();
+    column_.clear();
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(beg);
+    const unsigned char* e = reinterpret_cast<const unsigned char*>(end);
+    while(p < e) {
+	// every ASCII byte is a character
+	const size_t n = utf8_ascii_prefix(reinterpret_cast<const char*>(p), end);
+	for(size_t i = 0; i < n; ++i) {
+	    column_.push_back(static_cast<uint32_t>(chars_.size() + i));
+	}
+	chars_.append(p, p + n);
+	p += n;
+	if (p == e) {
+	    break;
+	}
+
+	uint32_t c;
+	const size_t len = utf8_decode_char(p, e, c);
+	column_.insert(column_.end(), len, static_cast<uint32_t>(chars_.size()));
+	chars_.push_back(static_cast<wchar_t>(c));
+	p += len;
+    }
+    column_.push_back(static_cast<uint32_t>(chars_.size()));
+}
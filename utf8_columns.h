@@ -0,0 +1,47 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * a line of UTF-8 bytes decoded into characters and a table, which maps each byte to the column of its character.
+ * Regular expressions search the bytes of a line, the table maps their matches to the displayed characters.
+ * The object is meant to be reused for every displayed line, assign() does not allocate memory once
+ * the buffers are large enough.
+ */
+class utf8_columns
+{
+    /// the decoded characters.
+    std::wstring chars_;
+    /// index into chars_ of the character of each byte, followed by chars_.size().
+    std::vector<uint32_t> column_;
+
+public:
+    /**
+     * decode the UTF-8 bytes [beg, end), see utf8_decode().
+     * Each byte of an invalid or incomplete sequence is decoded as U+FFFD.
+     */
+    void assign(const char* beg, const char* end);
+
+    /// @return the decoded characters.
+    const std::wstring& chars() const { return chars_; }
+
+    /// @return the number of decoded characters.
+    size_t size() const { return chars_.size(); }
+
+    /**
+     * @param offset byte offset, which may be the number of bytes.
+     * @return index of the character that contains the byte at offset; size() if offset is the number of bytes.
+     */
+    size_t column(const size_t offset) const { return column_[offset]; }
+
+    /**
+     * @param offset byte offset one past the last byte of a match.
+     * @return index one past the character that contains the last byte of the match.
+     */
+    size_t end_column(const size_t offset) const { return (offset == 0) ? 0 : column_[offset - 1] + 1; }
+};
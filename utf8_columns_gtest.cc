@@ -0,0 +1,60 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "utf8_columns.h"
+
+namespace {
+    void assign(utf8_columns& u, const std::string& s)
+    {
+	u.assign(s.data(), s.data() + s.size());
+    }
+}
+
+TEST(utf8_columns, handles_empty_line)
+{
+    utf8_columns u;
+    assign(u, "");
+    ASSERT_EQ(0u, u.size());
+    ASSERT_EQ(0u, u.column(0));
+    ASSERT_EQ(0u, u.end_column(0));
+}
+
+TEST(utf8_columns, maps_bytes_to_characters)
+{
+    utf8_columns u;
+    // 1, 2, 3 and 4 byte characters
+    assign(u, "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80z");
+    if (sizeof(wchar_t) >= 4) {
+	ASSERT_EQ(std::wstring(L"a\u00E9\u20AC\U0001F600z"), u.chars());
+    }
+    ASSERT_EQ(5u, u.size());
+    const size_t expected[] = { 0, 1, 1, 2, 2, 2, 3, 3, 3, 3, 4, 5 };
+    for(size_t i = 0; i < sizeof(expected)/sizeof(expected[0]); ++i) {
+	ASSERT_EQ(expected[i], u.column(i)) << i;
+    }
+    // a match of the bytes of the euro sign
+    ASSERT_EQ(2u, u.column(3));
+    ASSERT_EQ(3u, u.end_column(6));
+    // a match which ends within a character includes the character
+    ASSERT_EQ(2u, u.end_column(2));
+}
+
+TEST(utf8_columns, resyncs_on_invalid_sequences)
+{
+    utf8_columns u;
+    // overlong sequence
+    assign(u, "\xe2\x82\xac" "\xf0\x82\x82\xac" "\xc2\xa2");
+    ASSERT_EQ(std::wstring(L"\u20AC\uFFFD\uFFFD\uFFFD\uFFFD\u00A2"), u.chars());
+    // incomplete sequence
+    assign(u, "Dirk\xf4Writes");
+    ASSERT_EQ(std::wstring(L"Dirk\uFFFDWrites"), u.chars());
+    ASSERT_EQ(5u, u.column(5));
+    // surrogates and characters beyond U+10FFFF
+    assign(u, "\xed\xa0\x80\xf4\x90\x80\x80");
+    ASSERT_EQ(7u, u.size());
+    // truncated at the end of the line
+    assign(u, "ab\xe2\x82");
+    ASSERT_EQ(std::wstring(L"ab\uFFFD\uFFFD"), u.chars());
+}
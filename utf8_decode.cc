@@ -0,0 +1,121 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "utf8_decode.h"
+#include <cstring>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTF8_DECODE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+    /// @return index of the least significant set bit of m, which must not be 0.
+    inline unsigned first_bit(const unsigned m)
+    {
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward(&i, m);
+	return i;
+#else
+	return __builtin_ctz(m);
+#endif
+    }
+}
+
+size_t
+utf8_ascii_prefix(const char* beg, const char* end)
+{
+    const char* p = beg;
+#if defined(__AVX2__)
+    while(end - p >= 32) {
+	// the mask has a bit set for every byte with its most significant bit set
+	const unsigned m = _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+	if (m) {
+	    return (p - beg) + first_bit(m);
+	}
+	p += 32;
+    }
+#elif defined(UTF8_DECODE_SSE2)
+    while(end - p >= 16) {
+	const unsigned m = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+	if (m) {
+	    return (p - beg) + first_bit(m);
+	}
+	p += 16;
+    }
+#else
+    while(end - p >= 8) {
+	uint64_t w;
+	memcpy(&w, p, sizeof(w));
+	if (w & 0x8080808080808080llu) {
+	    break;
+	}
+	p += 8;
+    }
+#endif
+    while(p < end && static_cast<unsigned char>(*p) < 0x80) {
+	++p;
+    }
+    return p - beg;
+}
+
+void
+utf8_decode(const char* beg, const char* end, std::wstring& out)
+{
+    // a string has at most as many characters as bytes
+    out.reserve(out.size() + (end - beg));
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(beg);
+    const unsigned char* e = reinterpret_cast<const unsigned char*>(end);
+    while(p < e) {
+	const size_t n = utf8_ascii_prefix(reinterpret_cast<const char*>(p), end);
+	if (n > 0) {
+	    // widen the ASCII bytes in a loop, which the compiler vectorizes
+	    const size_t old = out.size();
+	    out.resize(old + n);
+	    wchar_t* w = &out[old];
+	    for(size_t i = 0; i < n; ++i) {
+		w[i] = p[i];
+	    }
+	    p += n;
+	}
+	if (p == e) {
+	    break;
+	}
+	uint32_t c;
+	p += utf8_decode_char(p, e, c);
+	out.push_back(static_cast<wchar_t>(c));
+    }
+}
+
+void
+utf8_encode(const wchar_t* beg, const wchar_t* end, std::string& out)
+{
+    out.reserve(out.size() + (end - beg));
+    for(const wchar_t* p = beg; p < end; ++p) {
+	uint32_t c = static_cast<uint32_t>(*p);
+	if (c < 0x80) {
+	    out.push_back(static_cast<char>(c));
+	    continue;
+	}
+	if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+	    c = 0xFFFD;
+	}
+	if (c < 0x800) {
+	    out.push_back(static_cast<char>(0xC0 | (c >> 6)));
+	} else if (c < 0x10000) {
+	    out.push_back(static_cast<char>(0xE0 | (c >> 12)));
+	    out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+	} else {
+	    out.push_back(static_cast<char>(0xF0 | (c >> 18)));
+	    out.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+	    out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+	}
+	out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+    }
+}
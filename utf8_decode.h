@@ -0,0 +1,77 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/**
+ * @return number of ASCII bytes (below 0x80) at the beginning of [beg, end).
+ * The bytes are checked 16 bytes at a time with SSE2 or 32 bytes at a time with AVX2, if the compiler targets them.
+ */
+size_t utf8_ascii_prefix(const char* beg, const char* end);
+
+namespace utf8_detail {
+    /// @return true if c is a continuation byte of a UTF-8 sequence.
+    inline bool continuation(const unsigned char c) { return (c & 0xC0) == 0x80; }
+}
+
+/**
+ * decode one UTF-8 sequence. Overlong sequences, surrogates and characters beyond U+10FFFF are invalid.
+ * If wchar_t has 16 bits, characters beyond U+FFFF are decoded as U+FFFD, because they need two wchar_t.
+ * @param[in] p first byte of the sequence, has to be before end.
+ * @param[in] end end of the bytes.
+ * @param[out] c the character; U+FFFD if the sequence is invalid or incomplete.
+ * @return number of bytes of the sequence; 1 if the sequence is invalid or incomplete.
+ */
+inline size_t utf8_decode_char(const unsigned char* p, const unsigned char* end, uint32_t& c)
+{
+    using utf8_detail::continuation;
+    const unsigned char b = p[0];
+    if (b < 0x80) {
+	c = b;
+	return 1;
+    }
+    c = 0xFFFD;
+    const size_t left = end - p;
+    if (b >= 0xC2 && b <= 0xDF) {
+	if (left >= 2 && continuation(p[1])) {
+	    c = ((b & 0x1F) << 6) | (p[1] & 0x3F);
+	    return 2;
+	}
+    } else if (b >= 0xE0 && b <= 0xEF) {
+	// reject overlong sequences and surrogates
+	const unsigned char lo = (b == 0xE0) ? 0xA0 : 0x80;
+	const unsigned char hi = (b == 0xED) ? 0x9F : 0xBF;
+	if (left >= 3 && p[1] >= lo && p[1] <= hi && continuation(p[2])) {
+	    c = ((b & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+	    return 3;
+	}
+    } else if (b >= 0xF0 && b <= 0xF4) {
+	// reject overlong sequences and characters beyond U+10FFFF
+	const unsigned char lo = (b == 0xF0) ? 0x90 : 0x80;
+	const unsigned char hi = (b == 0xF4) ? 0x8F : 0xBF;
+	if (left >= 4 && p[1] >= lo && p[1] <= hi && continuation(p[2]) && continuation(p[3])) {
+	    c = (sizeof(wchar_t) < 4) ? 0xFFFD : ((b & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+	    return 4;
+	}
+    }
+    return 1;
+}
+
+/**
+ * decode the UTF-8 bytes [beg, end) in a single pass and append the characters to out.
+ * Each byte of an invalid or incomplete sequence is decoded as U+FFFD and decoding continues with the next byte.
+ * Runs of ASCII bytes are copied without decoding, see utf8_ascii_prefix().
+ * out is not cleared, so a buffer can be reused without allocating memory for every string.
+ */
+void utf8_decode(const char* beg, const char* end, std::wstring& out);
+
+/**
+ * encode the characters [beg, end) as UTF-8 and append them to out.
+ * Surrogates and characters beyond U+10FFFF are encoded as U+FFFD. Like utf8_decode() the
+ * encoding does not depend on the locale.
+ */
+void utf8_encode(const wchar_t* beg, const wchar_t* end, std::string& out);
@@ -0,0 +1,149 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "utf8_decode.h"
+#include "to_wide.h"
+#include <chrono>
+#include <clocale>
+#include <iostream>
+
+namespace {
+    std::wstring decode(const std::string& s)
+    {
+	std::wstring w;
+	utf8_decode(s.data(), s.data() + s.size(), w);
+	return w;
+    }
+
+    /// decode s one character at a time, without the ASCII fast path.
+    std::wstring decode_slow(const std::string& s)
+    {
+	std::wstring w;
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+	const unsigned char* e = p + s.size();
+	while(p < e) {
+	    uint32_t c;
+	    p += utf8_decode_char(p, e, c);
+	    w.push_back(static_cast<wchar_t>(c));
+	}
+	return w;
+    }
+}
+
+TEST(utf8_decode, finds_ascii_prefix)
+{
+    const std::string a(100, 'a');
+    ASSERT_EQ(0u, utf8_ascii_prefix(a.data(), a.data()));
+    ASSERT_EQ(100u, utf8_ascii_prefix(a.data(), a.data() + a.size()));
+    // a non ASCII byte at every position of the SIMD blocks and the tail
+    for(size_t i = 0; i < a.size(); ++i) {
+	std::string s = a;
+	s[i] = '\xc3';
+	ASSERT_EQ(i, utf8_ascii_prefix(s.data(), s.data() + s.size())) << i;
+    }
+}
+
+TEST(utf8_decode, decodes_utf8)
+{
+    ASSERT_EQ(std::wstring(), decode(""));
+    ASSERT_EQ(std::wstring(L"abc"), decode("abc"));
+    ASSERT_EQ(std::wstring(L"\u20AC"), decode("\xe2\x82\xac"));
+    if (sizeof(wchar_t) >= 4) {
+	ASSERT_EQ(std::wstring(L"a\u00E9\u20AC\U0001F600z"), decode("a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80z"));
+    }
+    // the characters are appended
+    std::wstring w = L"x";
+    utf8_decode("y", "y" + 1, w);
+    ASSERT_EQ(std::wstring(L"xy"), w);
+}
+
+TEST(utf8_decode, emits_replacement_character_for_invalid_bytes)
+{
+    ASSERT_EQ(std::wstring(L"\u20AC\uFFFD\uFFFD\uFFFD\uFFFD\u00A2"), decode("\xe2\x82\xac" "\xf0\x82\x82\xac" "\xc2\xa2"));
+    ASSERT_EQ(std::wstring(L"Dirk\u20ACJagdmann\uFFFDWrites\u00A2Fewer"), decode("Dirk\xe2\x82\xacJagdmann" "\xf4" "Writes\xc2\xa2" "Fewer"));
+    // surrogates, characters beyond U+10FFFF, a lone continuation byte and a truncated sequence
+    ASSERT_EQ(std::wstring(L"\uFFFD\uFFFD\uFFFD"), decode("\xed\xa0\x80"));
+    ASSERT_EQ(std::wstring(L"\uFFFD\uFFFD\uFFFD\uFFFD"), decode("\xf4\x90\x80\x80"));
+    ASSERT_EQ(std::wstring(L"a\uFFFDb"), decode("a\x80" "b"));
+    ASSERT_EQ(std::wstring(L"ab\uFFFD\uFFFD"), decode("ab\xe2\x82"));
+}
+
+TEST(utf8_decode, fast_path_is_identical_to_slow_path)
+{
+    std::string s;
+    for(unsigned i = 0; i < 5000; ++i) {
+	s += std::string(i % 37, 'x');
+	s += (i % 3) ? "\xc3\xa9" : "\xff";
+    }
+    ASSERT_EQ(decode_slow(s), decode(s));
+#if !defined(_WIN32)
+    // on Windows to_wide() uses the code page of the locale
+    ASSERT_EQ(decode_slow(s), to_wide(s));
+    std::wstring w = L"old contents";
+    to_wide(s.data(), s.data() + s.size(), w);
+    ASSERT_EQ(decode_slow(s), w);
+#endif
+}
+
+TEST(utf8_decode, encodes_utf8)
+{
+    auto encode = [](const std::wstring& w) {
+	std::string s;
+	utf8_encode(w.data(), w.data() + w.size(), s);
+	return s;
+    };
+    ASSERT_EQ(std::string(), encode(L""));
+    ASSERT_EQ(std::string("abc"), encode(L"abc"));
+    ASSERT_EQ(std::string("\xc3\xa9\xe2\x82\xac\xef\xbf\xbd"), encode(L"\u00E9\u20AC\uFFFD"));
+    if (sizeof(wchar_t) >= 4) {
+	ASSERT_EQ(std::string("\xf0\x9f\x98\x80"), encode(L"\U0001F600"));
+	// surrogates and characters beyond U+10FFFF
+	const std::wstring invalid = { wchar_t(0xD800), wchar_t(0x110000) };
+	ASSERT_EQ(std::string("\xef\xbf\xbd\xef\xbf\xbd"), encode(invalid));
+    }
+    // encoding the decoded characters yields the valid UTF-8 input
+    const std::string s = "Dirk\xe2\x82\xacJagdmann caf\xc3\xa9 \xf0\x9f\x98\x80";
+    ASSERT_EQ(s, encode(decode(s)));
+}
+
+#if !defined(_WIN32)
+TEST(utf8_decode, to_utf8_does_not_depend_on_the_locale)
+{
+    // to_wide() decodes UTF-8 in every locale, to_utf8() has to encode it in every locale
+    const std::string old = setlocale(LC_ALL, nullptr);
+    ASSERT_TRUE(setlocale(LC_ALL, "C") != nullptr);
+    const std::string s = "a\xc3\xa9\xe2\x82\xac";
+    const std::string u = to_utf8(to_wide(s));
+    setlocale(LC_ALL, old.c_str());
+    ASSERT_EQ(s, u);
+}
+#endif
+
+TEST(utf8_decode, benchmark)
+{
+    // a log line and a binary line, in which every other byte is invalid
+    std::string text, binary;
+    while(text.size() < 16*1024*1024) {
+	text += "2016-02-01 12:00:01 INFO request handled user_id=42 path=/api/v1/items/1234\n";
+    }
+    for(unsigned i = 0; i < 4*1024*1024; ++i) {
+	binary += (i & 1) ? '\xff' : 'a';
+    }
+
+    std::wstring w;
+    for(auto p : { std::make_pair("text", &text), std::make_pair("binary", &binary) }) {
+	const std::string& s = *p.second;
+	auto start = std::chrono::steady_clock::now();
+	const std::wstring slow = decode_slow(s);
+	const auto slow_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	start = std::chrono::steady_clock::now();
+	w.clear();
+	utf8_decode(s.data(), s.data() + s.size(), w);
+	const auto fast_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::clog << "utf8 decode benchmark: " << p.first << " " << s.size() / 1024 / 1024 << " MB: "
+		  << "one character at a time " << slow_ms << " ms, with ASCII fast path " << fast_ms << " ms" << std::endl;
+	ASSERT_EQ(slow, w);
+    }
+}
@@ -0,0 +1,58 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+* vi: set shiftwidth=4 tabstop=8:
+* :indentSize=4:tabSize=8:
+*/
+#include "../file_identity.h"
+#include "../to_wide.h"
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <Shlobj.h>
+
+bool
+get_file_identity(const std::string& filename, file_identity& id)
+{
+    const std::wstring fn = to_wide(filename);
+    HANDLE h = CreateFile(fn.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (h == INVALID_HANDLE_VALUE) {
+	return false;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    const BOOL ok = GetFileInformationByHandle(h, &info);
+    CloseHandle(h);
+    if (!ok || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+	return false;
+    }
+
+    wchar_t path[MAX_PATH];
+    if (GetFullPathName(fn.c_str(), MAX_PATH, path, nullptr) == 0) {
+	return false;
+    }
+    id.path_ = to_utf8(path);
+    id.inode_ = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    id.size_ = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    // FILETIME counts 100 nanosecond intervals
+    id.mtime_ = ((static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime) * 100u;
+    return true;
+}
+
+bool
+create_directories(const std::string& dir)
+{
+    if (dir.empty()) {
+	return false;
+    }
+    const int res = SHCreateDirectoryEx(nullptr, to_wide(dir).c_str(), nullptr);
+    return res == ERROR_SUCCESS || res == ERROR_ALREADY_EXISTS;
+}
+
+std::string
+default_cache_dir()
+{
+    wchar_t *dir;
+    if (SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_DEFAULT_PATH | KF_FLAG_CREATE, nullptr, &dir) != S_OK) {
+	return "";
+    }
+    std::string d = to_utf8(std::wstring(dir)) + "\\few\\cache";
+    CoTaskMemFree(dir);
+    return d;
+}
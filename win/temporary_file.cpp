@@ -3,6 +3,7 @@
  * :indentSize=4:tabSize=8:
  */
 #include "temporary_file.h"
+#include "to_wide.h"
 #include <cstdlib>
 #include <stdexcept>
 #include <atomic>
@@ -68,3 +69,19 @@ TemporaryFile::close()
     f_ = nullptr;
     return ret == 0;
 }
+
+uint64_t
+free_disk_space(const std::string& filename)
+{
+    // the free space is queried for the directory of the file
+    std::wstring dir = to_wide(filename);
+    const size_t slash = dir.find_last_of(L"\\/");
+    if (slash != std::wstring::npos) {
+	dir.resize(slash + 1);
+    }
+    ULARGE_INTEGER avail;
+    if (! GetDiskFreeSpaceExW(dir.c_str(), &avail, nullptr, nullptr)) {
+	return UINT64_MAX;
+    }
+    return avail.QuadPart;
+}
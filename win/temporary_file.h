@@ -5,6 +5,7 @@
 #pragma once
 #include <string>
 #include <cstdio>
+#include <stdint.h>
 
 /**
  * a class to manage a temporary file.
@@ -35,3 +36,9 @@ public:
      */
     bool close();
 };
+
+/**
+ * @param filename name of a file.
+ * @return number of bytes which can still be written to the file system of the file; UINT64_MAX if it is unknown.
+ */
+uint64_t free_disk_space(const std::string& filename);
@@ -47,6 +47,12 @@ std::wstring to_wide(const std::string& s)
     return out;
 }
 
+void to_wide(const char* beg, const char* end, std::wstring& out)
+{
+    // the bytes are converted with the code page of the locale
+    out = to_wide(std::string(beg, end));
+}
+
 std::string to_utf8(const std::wstring& s)
 {
     // first get size of target UTF-8 string